@@ -0,0 +1,70 @@
+/**
+ * @file CoreBenchmark.cxx
+ * @author Thomas Lindemeier
+ * @brief Per sample color and Kubelka-Munk kernels.
+ * @date 2020-11-13
+ *
+ */
+#include "SyntheticInputs.hxx"
+#include "painty/core/Color.hxx"
+#include "painty/core/KubelkaMunk.hxx"
+
+namespace {
+constexpr auto SampleCount = 512 * 512;
+
+void BM_ComputeReflectance(benchmark::State& state) {
+  const auto K  = painty::bench::RandomMat3d(1, SampleCount, 0.0, 2.0);
+  const auto S  = painty::bench::RandomMat3d(1, SampleCount, 0.0, 1.0);
+  const auto R0 = painty::bench::RandomMat3d(1, SampleCount, 0.0, 1.0);
+  const auto d  = painty::bench::RandomMat1d(1, SampleCount, 0.0, 1.0);
+  for (auto _ : state) {
+    for (auto i = 0; i < SampleCount; i++) {
+      benchmark::DoNotOptimize(
+        painty::ComputeReflectance(K(i), S(i), R0(i), d(i)));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * SampleCount);
+}
+BENCHMARK(BM_ComputeReflectance);
+
+void BM_ColorConverter(benchmark::State& state) {
+  const auto conversion =
+    static_cast<painty::ColorConverter<double>::Conversion>(state.range(0));
+  const auto input = painty::bench::RandomMat3d(1, SampleCount, 0.0, 1.0);
+  const painty::ColorConverter<double> converter;
+  painty::vec3 output;
+  for (auto _ : state) {
+    for (auto i = 0; i < SampleCount; i++) {
+      converter.convert(input(i), output, conversion);
+      benchmark::DoNotOptimize(output);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * SampleCount);
+}
+BENCHMARK(BM_ColorConverter)
+  ->Arg(static_cast<int64_t>(
+    painty::ColorConverter<double>::Conversion::srgb_2_CIELab))
+  ->Arg(static_cast<int64_t>(
+    painty::ColorConverter<double>::Conversion::CIELab_2_srgb))
+  ->Arg(static_cast<int64_t>(
+    painty::ColorConverter<double>::Conversion::rgb_2_CIELab))
+  ->Arg(static_cast<int64_t>(
+    painty::ColorConverter<double>::Conversion::CIELab_2_rgb));
+
+void BM_CIEDE2000(benchmark::State& state) {
+  const auto a = painty::convertColor(
+    painty::bench::RandomMat3d(1, SampleCount, 0.0, 1.0),
+    painty::ColorConverter<double>::Conversion::srgb_2_CIELab);
+  const auto b = painty::convertColor(
+    painty::bench::RandomMat3d(1, SampleCount, 0.2, 0.8),
+    painty::ColorConverter<double>::Conversion::srgb_2_CIELab);
+  for (auto _ : state) {
+    for (auto i = 0; i < SampleCount; i++) {
+      benchmark::DoNotOptimize(
+        painty::ColorConverter<double>::ColorDifferenceCIEDE2000(a(i), b(i)));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * SampleCount);
+}
+BENCHMARK(BM_CIEDE2000);
+}  // namespace
@@ -0,0 +1,135 @@
+/**
+ * @file ImageBenchmark.cxx
+ * @author Thomas Lindemeier
+ * @brief Image filters, flow fields and segmentation.
+ * @date 2020-11-13
+ *
+ */
+#include <map>
+
+#include "SyntheticInputs.hxx"
+#include "painty/image/Convolution.hxx"
+#include "painty/image/EdgeTangentFlow.hxx"
+#include "painty/image/Mat.hxx"
+#include "painty/image/RecursiveGaussian.hxx"
+#include "painty/image/Superpixel.hxx"
+
+namespace {
+void BM_Interpolate(benchmark::State& state) {
+  constexpr auto SampleCount = 512 * 512;
+  const auto size            = static_cast<int32_t>(state.range(0));
+  const auto image = painty::bench::RandomMat3d(size, size, 0.0, 1.0);
+  const auto positions =
+    painty::bench::RandomMat3d(1, SampleCount, -1.0, size + 1.0);
+  for (auto _ : state) {
+    for (auto i = 0; i < SampleCount; i++) {
+      benchmark::DoNotOptimize(painty::Interpolate(
+        image, painty::vec2(positions(i)[0U], positions(i)[1U])));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * SampleCount);
+}
+BENCHMARK(BM_Interpolate)->Apply(painty::bench::ImageSizes);
+
+void BM_ConvertColorImage(benchmark::State& state) {
+  const auto size  = static_cast<int32_t>(state.range(0));
+  const auto image = painty::bench::SyntheticSrgb(size, size);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(painty::convertColor(
+      image, painty::ColorConverter<double>::Conversion::srgb_2_CIELab));
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_ConvertColorImage)->Apply(painty::bench::ImageSizes);
+
+void BM_SmoothOABF(benchmark::State& state) {
+  const auto size = static_cast<int32_t>(state.range(0));
+  const auto lab  = painty::bench::SyntheticLab(size, size);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(painty::smoothOABF(lab));
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_SmoothOABF)->Apply(painty::bench::ImageSizes);
+
+void BM_SmoothBilateralGrid(benchmark::State& state) {
+  const auto size = static_cast<int32_t>(state.range(0));
+  const auto lab  = painty::bench::SyntheticLab(size, size);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      painty::smoothOABF(lab, painty::Mat1d(), 3.0, 4.25, 3.0, 5U,
+                         painty::SmoothingFilter::BilateralGrid));
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_SmoothBilateralGrid)->Apply(painty::bench::ImageSizes);
+
+void BM_ComputeTensors(benchmark::State& state) {
+  const auto size = static_cast<int32_t>(state.range(0));
+  const auto lab  = painty::bench::SyntheticLab(size, size);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      painty::tensor::ComputeTensors(lab, painty::Mat1d(), 0.0, 1.0));
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_ComputeTensors)->Apply(painty::bench::ImageSizes);
+
+void BM_ComputeTensorsFused(benchmark::State& state) {
+  const auto size = static_cast<int32_t>(state.range(0));
+  const auto lab  = painty::bench::SyntheticLab(size, size);
+  painty::Mat<painty::vec2f> etf;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(painty::tensor::ComputeTensorsFused(
+      lab, painty::Mat1d(), 0.0, 1.0, &etf));
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_ComputeTensorsFused)->Apply(painty::bench::ImageSizes);
+
+/**
+ * @brief Outer blur of the gradient products for the largest brushes.
+ *
+ */
+constexpr auto LargeSigma = 30.0;
+
+void BM_GaussianBlurLargeSigma(benchmark::State& state) {
+  const auto size  = static_cast<int32_t>(state.range(0));
+  const auto image = painty::bench::RandomMat3d(size, size, 0.0, 1.0);
+  painty::Mat3d blurred;
+  for (auto _ : state) {
+    cv::GaussianBlur(image, blurred, cv::Size(-1, -1), LargeSigma, 0.0,
+                     cv::BORDER_REFLECT);
+    benchmark::DoNotOptimize(blurred.data);
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_GaussianBlurLargeSigma)->Apply(painty::bench::ImageSizes);
+
+void BM_RecursiveGaussianBlurLargeSigma(benchmark::State& state) {
+  const auto size  = static_cast<int32_t>(state.range(0));
+  const auto image = painty::bench::RandomMat3d(size, size, 0.0, 1.0);
+  painty::Mat3d blurred;
+  for (auto _ : state) {
+    painty::recursiveGaussianBlur(image, blurred, LargeSigma);
+    benchmark::DoNotOptimize(blurred.data);
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_RecursiveGaussianBlurLargeSigma)
+  ->Apply(painty::bench::ImageSizes);
+
+void BM_SuperpixelExtractWithDiff(benchmark::State& state) {
+  const auto size       = static_cast<int32_t>(state.range(0));
+  const auto lab        = painty::bench::SyntheticLab(size, size);
+  const auto difference = painty::bench::RandomMat1d(size, size, 0.0, 1.0);
+  for (auto _ : state) {
+    painty::SuperpixelSegmentation seg;
+    seg.extractWithDiff(lab, difference, painty::Mat1d(), size / 32);
+    std::map<int32_t, painty::ImageRegion> regions;
+    benchmark::DoNotOptimize(seg.getRegions(regions));
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_SuperpixelExtractWithDiff)->Apply(painty::bench::ImageSizes);
+}  // namespace
@@ -0,0 +1,72 @@
+/**
+ * @file MixerBenchmark.cxx
+ * @author Thomas Lindemeier
+ * @brief Paint mixing solves.
+ * @date 2020-11-13
+ *
+ */
+#include "SyntheticInputs.hxx"
+#include "painty/core/Color.hxx"
+#include "painty/mixer/PaintMixer.hxx"
+#include "painty/mixer/PaletteReflectanceLut.hxx"
+
+namespace {
+constexpr auto BasePaintCount = 12UL;
+
+void BM_PaintMixerReflectanceWeights(benchmark::State& state) {
+  const painty::PaintMixer mixer(
+    painty::bench::SyntheticPalette(BasePaintCount));
+  const auto targets = painty::bench::RandomMat3d(1, 64, 0.05, 0.95);
+  const painty::vec3 R0(0.9, 0.9, 0.85);
+  auto i = 0;
+  for (auto _ : state) {
+    auto d = 0.0;
+    benchmark::DoNotOptimize(
+      mixer.getMixtureWeightsForReflectance(targets(i), R0, d));
+    i = (i + 1) % targets.cols;
+  }
+}
+BENCHMARK(BM_PaintMixerReflectanceWeights)->Unit(benchmark::kMicrosecond);
+
+void BM_PaintMixerTargetPaintWeights(benchmark::State& state) {
+  const painty::PaintMixer mixer(
+    painty::bench::SyntheticPalette(BasePaintCount));
+  const auto targets = painty::bench::SyntheticPalette(64UL);
+  auto i             = 0UL;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mixer.getWeightsForMixingTargetPaint(targets[i]));
+    i = (i + 1UL) % targets.size();
+  }
+}
+BENCHMARK(BM_PaintMixerTargetPaintWeights)->Unit(benchmark::kMicrosecond);
+
+void BM_PaintMixerFromPicture(benchmark::State& state) {
+  const painty::PaintMixer mixer(
+    painty::bench::SyntheticPalette(BasePaintCount));
+  const auto size  = static_cast<int32_t>(state.range(0));
+  const auto image = painty::bench::SyntheticSrgb(size, size);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mixer.mixFromInputPicture(image, 6U));
+  }
+}
+BENCHMARK(BM_PaintMixerFromPicture)->Apply(painty::bench::ImageSizes);
+
+void BM_PaletteReflectanceLutBestPaint(benchmark::State& state) {
+  const painty::PaletteReflectanceLut lut(
+    painty::bench::SyntheticPalette(BasePaintCount), 1.0);
+  const auto substrates = painty::bench::RandomMat3d(1, 64, 0.0, 1.0);
+  const auto targets    = painty::bench::RandomMat3d(1, 64, -50.0, 50.0);
+  painty::Mat3d substratesLab(substrates.size());
+  painty::ColorConverter<double> converter;
+  for (auto j = 0; j < substrates.cols; j++) {
+    converter.rgb2lab(substrates(j), substratesLab(j));
+  }
+  auto i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      lut.findBestPaintIndex(targets(i), substrates(i), substratesLab(i)));
+    i = (i + 1) % targets.cols;
+  }
+}
+BENCHMARK(BM_PaletteReflectanceLutBestPaint);
+}  // namespace
@@ -0,0 +1,167 @@
+/**
+ * @file RendererBenchmark.cxx
+ * @author Thomas Lindemeier
+ * @brief Brushes, smudging and canvas composition.
+ * @date 2020-11-13
+ *
+ */
+#include "SyntheticInputs.hxx"
+#include "painty/core/Spline.hxx"
+#include "painty/renderer/Canvas.hxx"
+#include "painty/renderer/FootprintBrush.hxx"
+#include "painty/renderer/Renderer.hxx"
+#include "painty/renderer/Smudge.hxx"
+#include "painty/renderer/TextureBrush.hxx"
+
+namespace {
+/**
+ * @brief The cost of the brush kernels depends on the brush size, not on the
+ * canvas size, they are run on a canvas of fixed size.
+ *
+ */
+constexpr auto BrushCanvasSize = 1024;
+
+const std::array<painty::vec3, 2UL> Paint = {painty::vec3{0.2, 0.3, 0.4},
+                                             painty::vec3{0.1, 0.23, 0.14}};
+
+void BrushRadii(benchmark::internal::Benchmark* b) {
+  b->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+}
+
+/**
+ * @brief A curved stroke across the canvas.
+ *
+ */
+auto StrokePath() -> std::vector<painty::vec2> {
+  std::vector<painty::vec2> path;
+  for (auto i = 0; i <= 10; i++) {
+    const auto u = static_cast<double>(i) / 10.0;
+    path.emplace_back(BrushCanvasSize * (0.15 + 0.7 * u),
+                      BrushCanvasSize * (0.5 + 0.2 * std::sin(6.0 * u)));
+  }
+  return path;
+}
+
+/**
+ * @brief A canvas covered with wet paint to pick up.
+ *
+ */
+auto WetCanvas() -> painty::Canvas<painty::vec3> {
+  painty::Canvas<painty::vec3> canvas(BrushCanvasSize, BrushCanvasSize);
+  canvas.clear();
+  const auto K =
+    painty::bench::RandomMat3d(BrushCanvasSize, BrushCanvasSize, 0.0, 2.0);
+  const auto S =
+    painty::bench::RandomMat3d(BrushCanvasSize, BrushCanvasSize, 0.0, 1.0);
+  const auto V =
+    painty::bench::RandomMat1d(BrushCanvasSize, BrushCanvasSize, 0.0, 1.0);
+  for (auto y = 0; y < BrushCanvasSize; y++) {
+    for (auto x = 0; x < BrushCanvasSize; x++) {
+      canvas.getPaintLayer().set(y, x, K(y, x), S(y, x), V(y, x));
+    }
+  }
+  return canvas;
+}
+
+void BM_FootprintBrushImprint(benchmark::State& state) {
+  auto canvas = WetCanvas();
+  painty::FootprintBrush<painty::vec3> brush(
+    static_cast<double>(state.range(0)));
+  brush.dip(Paint);
+  const painty::vec2 center(BrushCanvasSize / 2.0, BrushCanvasSize / 2.0);
+  auto theta = 0.0;
+  for (auto _ : state) {
+    brush.imprint(center, theta, canvas);
+    theta += 0.1;
+  }
+}
+BENCHMARK(BM_FootprintBrushImprint)->Apply(BrushRadii);
+
+void BM_TextureBrushPaintStroke(benchmark::State& state) {
+  auto canvas = WetCanvas();
+  painty::TextureBrush<painty::vec3> brush("data/sample_0");
+  brush.enableSmudge(state.range(1) != 0);
+  brush.setRadius(static_cast<double>(state.range(0)));
+  brush.dip(Paint);
+  const auto path = StrokePath();
+  for (auto _ : state) {
+    brush.paintStroke(path, canvas);
+  }
+}
+BENCHMARK(BM_TextureBrushPaintStroke)
+  ->Apply([](benchmark::internal::Benchmark* b) {
+    for (const auto smudge : {0, 1}) {
+      for (const auto radius : {8, 32, 128}) {
+        b->Args({radius, smudge});
+      }
+    }
+    b->Unit(benchmark::kMillisecond);
+  });
+
+void BM_Smudge(benchmark::State& state) {
+  auto canvas       = WetCanvas();
+  const auto radius = static_cast<double>(state.range(0));
+  painty::Smudge<painty::vec3> smudge(static_cast<int32_t>(2.0 * radius));
+
+  const auto path = StrokePath();
+  auto length     = 0.0;
+  auto boundMin   = path.front();
+  auto boundMax   = path.front();
+  for (auto i = 1UL; i < path.size(); i++) {
+    length += (path[i] - path[i - 1UL]).norm();
+    boundMin = boundMin.cwiseMin(path[i]);
+    boundMax = boundMax.cwiseMax(path[i]);
+  }
+  boundMin -= painty::vec2(radius, radius);
+  boundMax += painty::vec2(radius, radius);
+  const painty::Mat1d thicknessMap = painty::bench::RandomMat1d(
+    static_cast<int32_t>(boundMax[1U] - boundMin[1U] + 1.0),
+    static_cast<int32_t>(boundMax[0U] - boundMin[0U] + 1.0), 0.0, 1.0);
+  painty::SplineEval<std::vector<painty::vec2>::const_iterator> spine(
+    path.cbegin(), path.cend());
+
+  for (auto _ : state) {
+    smudge.smudge(canvas, boundMin, spine, length, thicknessMap);
+  }
+}
+BENCHMARK(BM_Smudge)->Apply(BrushRadii);
+
+void BM_RendererCompose(benchmark::State& state) {
+  const auto size = static_cast<int32_t>(state.range(0));
+  painty::PaintLayer<painty::vec3> layer(size, size);
+  const auto K  = painty::bench::RandomMat3d(size, size, 0.0, 2.0);
+  const auto S  = painty::bench::RandomMat3d(size, size, 0.0, 1.0);
+  const auto V  = painty::bench::RandomMat1d(size, size, 0.0, 1.0);
+  const auto R0 = painty::bench::RandomMat3d(size, size, 0.0, 1.0);
+  for (auto y = 0; y < size; y++) {
+    for (auto x = 0; x < size; x++) {
+      layer.set(y, x, K(y, x), S(y, x), V(y, x));
+    }
+  }
+  painty::Renderer<painty::vec3> renderer;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(renderer.compose(layer, R0));
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_RendererCompose)->Apply(painty::bench::ImageSizes);
+
+void BM_RendererRender(benchmark::State& state) {
+  const auto size = static_cast<int32_t>(state.range(0));
+  painty::Canvas<painty::vec3> canvas(size, size);
+  canvas.clear();
+  canvas.get_h() = painty::bench::RandomMat1d(size, size, 0.0, 1.0);
+  const auto V   = painty::bench::RandomMat1d(size, size, 0.0, 1.0);
+  for (auto y = 0; y < size; y++) {
+    for (auto x = 0; x < size; x++) {
+      canvas.getPaintLayer().set(y, x, Paint[0U], Paint[1U], V(y, x));
+    }
+  }
+  painty::Renderer<painty::vec3> renderer;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(renderer.render(canvas));
+  }
+  state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_RendererRender)->Apply(painty::bench::ImageSizes);
+}  // namespace
@@ -0,0 +1,68 @@
+/**
+ * @file SbrBenchmark.cxx
+ * @author Thomas Lindemeier
+ * @brief Stroke path tracing.
+ * @date 2020-11-13
+ *
+ */
+#include <vector>
+
+#include "SyntheticInputs.hxx"
+#include "painty/image/EdgeTangentFlow.hxx"
+#include "painty/sbr/PathTracer.hxx"
+
+namespace {
+void BM_PathTracerTrace(benchmark::State& state) {
+  constexpr auto SeedCount = 1024;
+  const auto size          = static_cast<int32_t>(state.range(0));
+  const auto tensors       = painty::tensor::ComputeTensors(
+    painty::bench::SyntheticLab(size, size), painty::Mat1d(), 0.0, 1.0);
+  const auto seeds =
+    painty::bench::RandomMat3d(1, SeedCount, 0.0, static_cast<double>(size));
+
+  painty::PathTracer tracer(tensors);
+  tracer.setMinLen(5U);
+  tracer.setMaxLen(12U);
+  tracer.setStep(static_cast<double>(size) / 256.0);
+  tracer.setFc(1.0);
+  for (auto _ : state) {
+    for (auto i = 0; i < SeedCount; i++) {
+      benchmark::DoNotOptimize(
+        tracer.trace(painty::vec2(seeds(i)[0U], seeds(i)[1U])));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * SeedCount);
+}
+BENCHMARK(BM_PathTracerTrace)->Apply(painty::bench::ImageSizes);
+
+void BM_PathTracerTraceBatch(benchmark::State& state) {
+  constexpr auto SeedCount = 1024;
+  const auto size          = static_cast<int32_t>(state.range(0));
+  const auto tensors       = painty::tensor::ComputeTensors(
+    painty::bench::SyntheticLab(size, size), painty::Mat1d(), 0.0, 1.0);
+  const auto points =
+    painty::bench::RandomMat3d(1, SeedCount, 0.0, static_cast<double>(size));
+  std::vector<painty::vec2> seeds;
+  for (auto i = 0; i < SeedCount; i++) {
+    seeds.emplace_back(points(i)[0U], points(i)[1U]);
+  }
+
+  painty::PathTracer tracer(painty::ComputeMinorEigenvectorField(tensors));
+  tracer.setMinLen(5U);
+  tracer.setMaxLen(12U);
+  tracer.setStep(static_cast<double>(size) / 256.0);
+  tracer.setFc(1.0);
+  const auto extent = static_cast<double>(size);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tracer.traceBatch(
+      seeds, [extent](size_t, const painty::vec2& p) {
+        return ((p[0U] >= 0.0) && (p[1U] >= 0.0) && (p[0U] < extent) &&
+                (p[1U] < extent))
+                 ? painty::PathTracer::NextAction::PATH_CONTINUE
+                 : painty::PathTracer::NextAction::PATH_STOP_NOW;
+      }));
+  }
+  state.SetItemsProcessed(state.iterations() * SeedCount);
+}
+BENCHMARK(BM_PathTracerTraceBatch)->Apply(painty::bench::ImageSizes);
+}  // namespace
@@ -0,0 +1,108 @@
+/**
+ * @file SyntheticInputs.hxx
+ * @author Thomas Lindemeier
+ * @brief Reproducible inputs for the benchmarks.
+ * @date 2020-11-13
+ *
+ */
+#pragma once
+
+#include <cmath>
+#include <random>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include "benchmark/benchmark.h"
+#pragma clang diagnostic pop
+#include "painty/core/Color.hxx"
+#include "painty/image/Mat.hxx"
+#include "painty/mixer/Palette.hxx"
+
+namespace painty {
+namespace bench {
+
+constexpr uint32_t Seed = 42U;
+
+/**
+ * @brief Register the image sizes benchmarked for full image kernels.
+ *
+ */
+inline void ImageSizes(benchmark::internal::Benchmark* b) {
+  b->Arg(512)->Arg(2048)->Arg(4096)->Unit(benchmark::kMillisecond);
+}
+
+/**
+ * @brief Smooth color gradients and edges with some noise in sRGB [0, 1],
+ * giving structure to the flow and segmentation kernels.
+ *
+ */
+inline auto SyntheticSrgb(const int32_t rows, const int32_t cols) -> Mat3d {
+  std::mt19937 gen(Seed);
+  std::normal_distribution<double> noise(0.0, 0.02);
+  Mat3d image(rows, cols);
+  for (auto y = 0; y < rows; y++) {
+    for (auto x = 0; x < cols; x++) {
+      const auto u = static_cast<double>(x) / static_cast<double>(cols);
+      const auto v = static_cast<double>(y) / static_cast<double>(rows);
+      const auto wave =
+        0.5 + 0.5 * std::sin(12.0 * u + 7.0 * v + 4.0 * std::sin(5.0 * v));
+      const auto disc = (std::hypot(u - 0.6, v - 0.4) < 0.2) ? 1.0 : 0.0;
+      image(y, x) = vec3(0.8 * wave + 0.2 * disc + noise(gen),
+                         0.5 * u + 0.3 * disc + noise(gen),
+                         0.7 * v + 0.3 * wave + noise(gen))
+                      .cwiseMax(0.0)
+                      .cwiseMin(1.0);
+    }
+  }
+  return image;
+}
+
+inline auto SyntheticLab(const int32_t rows, const int32_t cols) -> Mat3d {
+  return convertColor(SyntheticSrgb(rows, cols),
+                      ColorConverter<double>::Conversion::srgb_2_CIELab);
+}
+
+/**
+ * @brief Uniform random values in [low, high].
+ *
+ */
+inline auto RandomMat1d(const int32_t rows, const int32_t cols,
+                        const double low, const double high) -> Mat1d {
+  std::mt19937 gen(Seed);
+  std::uniform_real_distribution<double> dis(low, high);
+  Mat1d m(rows, cols);
+  for (auto& v : m) {
+    v = dis(gen);
+  }
+  return m;
+}
+
+inline auto RandomMat3d(const int32_t rows, const int32_t cols,
+                        const double low, const double high) -> Mat3d {
+  std::mt19937 gen(Seed);
+  std::uniform_real_distribution<double> dis(low, high);
+  Mat3d m(rows, cols);
+  for (auto& v : m) {
+    v = {dis(gen), dis(gen), dis(gen)};
+  }
+  return m;
+}
+
+/**
+ * @brief Plausible Kubelka-Munk coefficients of a few base paints.
+ *
+ */
+inline auto SyntheticPalette(const std::size_t count) -> Palette {
+  std::mt19937 gen(Seed);
+  std::uniform_real_distribution<double> K(0.05, 2.0);
+  std::uniform_real_distribution<double> S(0.05, 1.0);
+  Palette palette(count);
+  for (auto& paint : palette) {
+    paint.K = {K(gen), K(gen), K(gen)};
+    paint.S = {S(gen), S(gen), S(gen)};
+  }
+  return palette;
+}
+
+}  // namespace bench
+}  // namespace painty
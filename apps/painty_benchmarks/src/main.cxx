@@ -0,0 +1,13 @@
+/**
+ * @file main.cxx
+ * @author Thomas Lindemeier
+ * @brief Microbenchmarks of the hot kernels, run from the source directory.
+ * @date 2020-11-13
+ *
+ */
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Weverything"
+#include "benchmark/benchmark.h"
+#pragma clang diagnostic pop
+
+BENCHMARK_MAIN();
@@ -1,6 +1,7 @@
 #include "DigitalCanvas.hxx"
 
 #include <QtGui/QKeyEvent>
+#include <QtGui/QPainter>
 #include <QtGui/QWheelEvent>
 #include <QtWidgets/QGraphicsPixmapItem>
 #include <QtWidgets/QGraphicsSceneMouseEvent>
@@ -24,6 +25,8 @@ DigitalCanvas::DigitalCanvas(const uint32_t width, const uint32_t height,
                      static_cast<double>(height), parent),
       _pixmapItem(nullptr),
       _canvasPtr(nullptr),
+      _historyPtr(nullptr),
+      _pyramidPtr(nullptr),
       _brushTexturePtr(std::make_unique<painty::TextureBrush<painty::vec3>>(
         "./data/sample_0")),
       _brushFootprintPtr(
@@ -36,6 +39,10 @@ DigitalCanvas::DigitalCanvas(const uint32_t width, const uint32_t height,
   _pixmapItem->setFlag(QGraphicsItem::ItemIsMovable);
 
   _canvasPtr = std::make_shared<painty::Canvas<painty::vec3>>(height, width);
+  _historyPtr =
+    std::make_unique<painty::CanvasHistory<painty::vec3>>(*_canvasPtr);
+  _pyramidPtr =
+    std::make_unique<painty::CanvasPyramid<painty::vec3>>(*_canvasPtr);
 
   updateCanvas();
 }
@@ -46,6 +53,10 @@ void DigitalCanvas::setPickupMapLabelPtr(QLabel* labelPtr) {
   _pickupMapLabelPtr = labelPtr;
 }
 
+painty::CanvasHistory<painty::vec3>& DigitalCanvas::getHistory() {
+  return *_historyPtr;
+}
+
 void DigitalCanvas::setColor(const QColor& Rbc, const QColor& Rwc) {
   painty::vec3 Rw(Rwc.redF(), Rwc.greenF(), Rwc.blueF());
   painty::vec3 Rb(Rbc.redF(), Rbc.greenF(), Rbc.blueF());
@@ -75,11 +86,50 @@ void DigitalCanvas::setBrushRadius(int radius) {
 }
 
 void DigitalCanvas::dryCanvas() {
+  _historyPtr->markDirty(cv::Rect(0, 0, _canvasPtr->getPaintLayer().getCols(),
+                                  _canvasPtr->getPaintLayer().getRows()));
   _canvasPtr->dryCanvas();
+  if (!_historyPtr->commit()) {
+    std::cerr << "canvas too large to undo drying, history cleared"
+              << std::endl;
+  }
+  _pyramidPtr->markAllDirty();
+
+  updateCanvas();
+}
+
+void DigitalCanvas::clearCanvas() {
+  _historyPtr->clear();
+  _canvasPtr->clear();
+  _pyramidPtr->markAllDirty();
 
   updateCanvas();
 }
 
+void DigitalCanvas::undo() {
+  if (_mousePressed) {
+    return;
+  }
+  if (_historyPtr->undo()) {
+    for (const auto& region : _historyPtr->getRestoredRegions()) {
+      _pyramidPtr->markDirty(region);
+    }
+    updateCanvas();
+  }
+}
+
+void DigitalCanvas::redo() {
+  if (_mousePressed) {
+    return;
+  }
+  if (_historyPtr->redo()) {
+    for (const auto& region : _historyPtr->getRestoredRegions()) {
+      _pyramidPtr->markDirty(region);
+    }
+    updateCanvas();
+  }
+}
+
 void DigitalCanvas::mousePressEvent(QGraphicsSceneMouseEvent* event) {
   _brushStrokePath.clear();
   QPointF qp = event->scenePos();
@@ -113,6 +163,11 @@ void DigitalCanvas::mouseMoveEvent(QGraphicsSceneMouseEvent* event) {
     const auto p2   = _brushStrokePath[static_cast<size_t>(
       std::max(0, static_cast<int32_t>(_brushStrokePath.size()) - 1))];
     const auto dist = (p2 - p1).norm();  // distance in pixel
+
+    _historyPtr->markDirty(std::vector<painty::vec2>{p1, p2},
+                           2.0 * _brushRadius + 2.0);
+    _pyramidPtr->markDirty(std::vector<painty::vec2>{p1, p2},
+                           2.0 * _brushRadius + 2.0);
     // don't imprint at previous point
     for (int32_t pd = 1; pd <= static_cast<int32_t>(dist); pd++) {
       const double t = static_cast<double>(pd) / dist;
@@ -136,7 +191,9 @@ void DigitalCanvas::mouseReleaseEvent(QGraphicsSceneMouseEvent* event) {
 
   _mousePressed = false;
 
-  if (!_useFootprintBrush) {
+  if (_useFootprintBrush) {
+    _historyPtr->commit();
+  } else {
     // spline
     painty::SplineEval<std::vector<painty::vec2>::const_iterator> spline(
       _brushStrokePath.cbegin(), _brushStrokePath.cend());
@@ -147,7 +204,10 @@ void DigitalCanvas::mouseReleaseEvent(QGraphicsSceneMouseEvent* event) {
       cubicPoints.push_back(spline.cubic(t));
     }
 
+    _historyPtr->markDirty(cubicPoints, 2.0 * _brushRadius + 2.0);
+    _pyramidPtr->markDirty(cubicPoints, 2.0 * _brushRadius + 2.0);
     _brushTexturePtr->paintStroke(cubicPoints, *_canvasPtr);
+    _historyPtr->commit();
     updateCanvas();
   }
 
@@ -159,22 +219,46 @@ void DigitalCanvas::updateCanvas() {
   painty::ColorConverter<double> converter;
 
   {
-    painty::Mat<painty::vec3> rgb = renderer.compose(*_canvasPtr);
-    // convert to srgb for display
-    for (auto& v : rgb) {
-      converter.rgb2srgb(v, v);
+    // only refresh the tiles of the level matching the zoom that changed
+    _pyramidPtr->update();
+    const auto level = _pyramidPtr->getLevelForScale(_viewScale);
+    const auto& r    = _pyramidPtr->getLevel(level);
+    auto region      = _pyramidPtr->takeUpdatedRegion(level);
+    auto rebuild     = false;
+    if ((level != _displayLevel) || (_displayImage.width() != r.cols) ||
+        (_displayImage.height() != r.rows)) {
+      rebuild       = true;
+      _displayLevel = level;
+      _displayImage = QImage(r.cols, r.rows, QImage::Format_RGB32);
+      region        = cv::Rect(0, 0, r.cols, r.rows);
+      _pixmapItem->setScale(std::pow(2.0, static_cast<double>(level)));
     }
 
-    QImage qimage(rgb.cols, rgb.rows, QImage::Format_RGB32);
-    for (auto i = 0; i < rgb.rows; i++) {
-      for (auto j = 0; j < rgb.cols; j++) {
-        qimage.setPixel(j, i,
-                        qRgb(static_cast<uint8_t>(rgb(i, j)[0U] * 255.0),
-                             static_cast<uint8_t>(rgb(i, j)[1U] * 255.0),
-                             static_cast<uint8_t>(rgb(i, j)[2U] * 255.0)));
+    for (auto i = region.y; i < (region.y + region.height); i++) {
+      for (auto j = region.x; j < (region.x + region.width); j++) {
+        // convert to srgb for display
+        painty::vec3 v = r(i, j);
+        converter.rgb2srgb(v, v);
+        _displayImage.setPixel(j, i,
+                               qRgb(static_cast<uint8_t>(v[0U] * 255.0),
+                                    static_cast<uint8_t>(v[1U] * 255.0),
+                                    static_cast<uint8_t>(v[2U] * 255.0)));
+      }
+    }
+    if (rebuild) {
+      _pixmapItem->setPixmap(QPixmap::fromImage(_displayImage));
+    } else if (!region.empty()) {
+      // take the pixmap from the item so drawing into it does not detach it
+      auto pixmap = _pixmapItem->pixmap();
+      _pixmapItem->setPixmap(QPixmap());
+      {
+        QPainter painter(&pixmap);
+        painter.drawImage(QPoint(region.x, region.y), _displayImage,
+                          QRect(region.x, region.y, region.width,
+                                region.height));
       }
+      _pixmapItem->setPixmap(pixmap);
     }
-    _pixmapItem->setPixmap(QPixmap::fromImage(qimage));
   }
   {
     painty::Mat<painty::vec3> white(
@@ -223,6 +307,13 @@ void DigitalCanvas::setUseFootprintBrush(bool use) {
   _useFootprintBrush = use;
 }
 
+void DigitalCanvas::setViewScale(double scale) {
+  _viewScale = scale;
+  if (_pyramidPtr->getLevelForScale(_viewScale) != _displayLevel) {
+    updateCanvas();
+  }
+}
+
 painty::FootprintBrush<painty::vec3>* DigitalCanvas::getFootprintBrushPtr() {
   return _brushFootprintPtr.get();
 }
@@ -262,6 +353,7 @@ void DigitalCanvasView::wheelEvent(QWheelEvent* event) {
     } else if (numDegrees < 0.) {
       this->scale(0.9, 0.9);
     }
+    _digitalCanvas->setViewScale(this->transform().m11());
   }
   event->accept();
 }
@@ -1,12 +1,15 @@
 #ifndef EDAVID_DIGITAL_canvasPtr_H
 #define EDAVID_DIGITAL_canvasPtr_H
 
+#include <QtGui/QImage>
 #include <QtWidgets/QGraphicsScene>
 #include <QtWidgets/QGraphicsView>
 #include <QtWidgets/QLabel>
 #include <memory>
 
 #include "painty/renderer/Canvas.hxx"
+#include "painty/renderer/CanvasHistory.hxx"
+#include "painty/renderer/CanvasPyramid.hxx"
 #include "painty/renderer/FootprintBrush.hxx"
 #include "painty/renderer/TextureBrush.hxx"
 
@@ -28,13 +31,19 @@ class DigitalCanvas : public QGraphicsScene {
 
   void setPickupMapLabelPtr(QLabel* labelPtr);
 
+  painty::CanvasHistory<painty::vec3>& getHistory();
+
  public slots:
   void setColor(const QColor& Rbc, const QColor& Rwc);
   void setBrushRadius(int radius);
 
   void dryCanvas();
+  void clearCanvas();
   void updateCanvas();
+  void undo();
+  void redo();
   void setUseFootprintBrush(bool);
+  void setViewScale(double scale);
 
   painty::FootprintBrush<painty::vec3>* getFootprintBrushPtr();
 
@@ -48,6 +57,14 @@ class DigitalCanvas : public QGraphicsScene {
 
   std::shared_ptr<painty::Canvas<painty::vec3>> _canvasPtr;
 
+  std::unique_ptr<painty::CanvasHistory<painty::vec3>> _historyPtr;
+
+  std::unique_ptr<painty::CanvasPyramid<painty::vec3>> _pyramidPtr;
+
+  QImage _displayImage;
+  int32_t _displayLevel = -1;
+  double _viewScale     = 1.0;
+
   std::unique_ptr<painty::TextureBrush<painty::vec3>> _brushTexturePtr;
   std::unique_ptr<painty::FootprintBrush<painty::vec3>> _brushFootprintPtr;
 
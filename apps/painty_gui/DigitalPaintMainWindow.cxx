@@ -47,8 +47,7 @@ DigitalPaintMainWindow::DigitalPaintMainWindow(QWidget* parent)
   QMenu* fileMenu = menuBar()->addMenu(tr("&File"));
   fileMenu->addAction(newAct);
   connect(newAct, &QAction::triggered, [=]() {
-    m_canvasView->getDigitalCanvas()->getCanvas()->clear();
-    m_canvasView->getDigitalCanvas()->updateCanvas();
+    m_canvasView->getDigitalCanvas()->clearCanvas();
   });
 
   QAction* saveAct = new QAction(tr("&Save As"), this);
@@ -67,6 +66,23 @@ DigitalPaintMainWindow::DigitalPaintMainWindow(QWidget* parent)
     painty::io::imSave(fileName.toStdString(), image, true);
   });
 
+  QMenu* editMenu = menuBar()->addMenu(tr("&Edit"));
+  QAction* undoAct = new QAction(tr("&Undo"), this);
+  undoAct->setShortcuts(QKeySequence::Undo);
+  undoAct->setStatusTip(tr("Undo the last brush stroke"));
+  editMenu->addAction(undoAct);
+  connect(undoAct, &QAction::triggered, [=]() {
+    m_canvasView->getDigitalCanvas()->undo();
+  });
+
+  QAction* redoAct = new QAction(tr("&Redo"), this);
+  redoAct->setShortcuts(QKeySequence::Redo);
+  redoAct->setStatusTip(tr("Redo the last undone brush stroke"));
+  editMenu->addAction(redoAct);
+  connect(redoAct, &QAction::triggered, [=]() {
+    m_canvasView->getDigitalCanvas()->redo();
+  });
+
   QAction* aboutAct = new QAction(tr("&about"), this);
   aboutAct->setStatusTip(tr("About..."));
   QMenu* helpMenu = menuBar()->addMenu(tr("&About"));
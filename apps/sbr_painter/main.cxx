@@ -1,3 +1,4 @@
+#include <cmath>
 #include <fstream>
 #include <future>
 #include <iostream>
@@ -14,6 +15,7 @@
 #include "painty/mixer/Serialization.hxx"
 #include "painty/renderer/FootprintBrush.hxx"
 #include "painty/renderer/Renderer.hxx"
+#include "painty/renderer/StrokeLog.hxx"
 #include "painty/renderer/TextureBrushGpu.hxx"
 #include "painty/sbr/PictureTargetSbrPainter.hxx"
 #include "prgl/Window.hxx"
@@ -27,6 +29,11 @@ static void from_json(const nlohmann::json& j,
   p.nrColors         = j.value("nrColors", 6U);
   p.thinningVolume   = j.value("thinningVolume", 1.0);
   p.alphaDiff        = j.value("alphaDiff", 1.0);
+  // "oabf" or "grid"
+  p.smoothingFilter =
+    (j.value("smoothingFilter", std::string("oabf")) == "grid")
+      ? SmoothingFilter::BilateralGrid
+      : SmoothingFilter::OrientationAligned;
 }
 
 static void from_json(const nlohmann::json& j,
@@ -69,6 +76,12 @@ int main(int argc, const char* argv[]) {
       ("c,config", "config as json file", cxxopts::value<std::string>())
       ("o,output", "Output file to store the rendered image", cxxopts::value<std::string>()
           ->default_value("sbr.png"))
+      ("b,backend", "Render backend: gpu or cpu", cxxopts::value<std::string>()
+          ->default_value("gpu"))
+      ("l,stroke-log", "Record the rendered strokes to a file", cxxopts::value<std::string>())
+      ("r,replay", "Render a recorded stroke log instead of painting an image", cxxopts::value<std::string>())
+      ("s,scale", "Size of the replayed canvas relative to the recorded one", cxxopts::value<double>()
+          ->default_value("1.0"))
       ("help", "Print help")
       ;
   // clang-format on
@@ -80,6 +93,46 @@ int main(int argc, const char* argv[]) {
     exit(EXIT_SUCCESS);
   }
 
+  if (result.count("r") == 1UL) {
+    const auto backend = result["backend"].as<std::string>();
+    if ((backend != "gpu") && (backend != "cpu")) {
+      std::cerr << "unknown backend " << backend << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    painty::StrokeLogReader reader(result["replay"].as<std::string>());
+    const auto scale = result["scale"].as<double>();
+    if (scale <= 0.0) {
+      std::cerr << "scale must be positive" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    const auto size = painty::Size{
+      static_cast<uint32_t>(
+        std::round(scale * static_cast<double>(reader.getCanvasSize().width))),
+      static_cast<uint32_t>(std::round(
+        scale * static_cast<double>(reader.getCanvasSize().height)))};
+    std::cout << "Replaying stroke log with width=" << size.width
+              << " and height=" << size.height << " using " << backend
+              << " render backend" << std::endl;
+
+    auto renderThreadPtr =
+      (backend == "gpu")
+        ? std::make_unique<painty::SbrRenderThread>(
+            std::make_shared<painty::GpuTaskQueue>(size), size)
+        : std::make_unique<painty::SbrRenderThread>(size);
+    const auto strokes = painty::ReplayStrokeLog(reader, *renderThreadPtr);
+    if (reader.isTruncated()) {
+      std::cerr << "stroke log is truncated" << std::endl;
+    }
+    std::cout << "Replayed " << strokes << " strokes" << std::endl;
+    renderThreadPtr->dryCanvas().wait();
+
+    const auto writeFile = result["output"].as<std::string>();
+    std::cout << "Writing result to: " << writeFile << std::endl;
+    painty::io::imSave(writeFile, renderThreadPtr->getLinearRgbImage().get(),
+                       true);
+    exit(EXIT_SUCCESS);
+  }
+
   if (result.count("i") == 0UL) {
     std::cerr << "no input picture given" << std::endl;
     std::cout << options.help({"", "Group"}) << std::endl;
@@ -147,12 +200,29 @@ int main(int argc, const char* argv[]) {
   // }
   const auto size = painty::Size{width, height};
 
-  const auto gpuTaskQueue = std::make_shared<painty::GpuTaskQueue>(size);
-
-  painty::PictureTargetSbrPainter picturePainter(
-    gpuTaskQueue, size, std::make_shared<painty::PaintMixer>(palette));
+  const auto backend = result["backend"].as<std::string>();
+  if ((backend != "gpu") && (backend != "cpu")) {
+    std::cerr << "unknown backend " << backend << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "Using " << backend << " render backend" << std::endl;
+
+  const auto gpuTaskQueue =
+    (backend == "gpu") ? std::make_shared<painty::GpuTaskQueue>(size) : nullptr;
+
+  auto picturePainterPtr =
+    (gpuTaskQueue != nullptr)
+      ? std::make_unique<painty::PictureTargetSbrPainter>(
+          gpuTaskQueue, size, std::make_shared<painty::PaintMixer>(palette))
+      : std::make_unique<painty::PictureTargetSbrPainter>(
+          size, std::make_shared<painty::PaintMixer>(palette));
+  auto& picturePainter = *picturePainterPtr;
   picturePainter.enableCoatCanvas(j.value("coatCanvas", false));
   picturePainter.enableSmudge(j.value("enableSmudge", true));
+  if (result.count("l") == 1UL) {
+    picturePainter.setStrokeLog(std::make_shared<painty::StrokeLogWriter>(
+      result["stroke-log"].as<std::string>(), size));
+  }
 
   std::cout << "Setting configs in renderer" << std::endl;
   picturePainter._paramsInput        = j["image_params"];
@@ -0,0 +1,81 @@
+/**
+ * @file SumTree.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-02
+ *
+ */
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace painty {
+/**
+ * @brief Weighted sampling of indices whose weights can change between the
+ * draws. The weights are the leaves of a complete binary tree whose inner
+ * nodes hold the sums of their children, so drawing an index and updating a
+ * weight both cost O(log n) and no draw is ever rejected.
+ *
+ */
+class SumTree {
+ public:
+  /**
+   * @brief Construct a new Sum Tree object
+   *
+   * @param weights the weights of the indices, negative weights are zero.
+   */
+  explicit SumTree(const std::vector<double>& weights);
+
+  auto size() const -> size_t;
+
+  auto total() const -> double;
+
+  auto weight(size_t index) const -> double;
+
+  void set(size_t index, double weight);
+
+  /**
+   * @brief Set the weights of the indices [begin, end) in
+   * O(end - begin + log n).
+   *
+   */
+  void fill(size_t begin, size_t end, double weight);
+
+  /**
+   * @brief The index whose range of the cumulative weights contains u.
+   *
+   * @param u in [0, total())
+   * @return an index with a positive weight, if total() > 0
+   */
+  auto find(double u) const -> size_t;
+
+  /**
+   * @brief Draw an index with a probability proportional to its weight.
+   * total() must be positive.
+   *
+   */
+  template <class Generator>
+  auto sample(Generator& generator) const -> size_t {
+    std::uniform_real_distribution<double> distribution(0.0, total());
+    return find(distribution(generator));
+  }
+
+ private:
+  size_t _size = 0UL;
+
+  /**
+   * @brief The number of leaves, a power of two.
+   *
+   */
+  size_t _leaves = 1UL;
+
+  /**
+   * @brief The root is node 1, the children of node i are 2i and 2i + 1 and
+   * the leaves start at _leaves.
+   *
+   */
+  std::vector<double> _nodes;
+};
+}  // namespace painty
@@ -6,10 +6,13 @@
  *
  */
 #pragma once
+#include <algorithm>
+#include <chrono>
 #include <functional>
 #include <future>
 #include <queue>
 #include <thread>
+#include <vector>
 
 namespace painty {
 
@@ -72,6 +75,13 @@ class ThreadPool final {
     return push(true, f, args...);
   }
 
+  /**
+   * @brief Run the front job of the queue on the calling thread.
+   *
+   * @return false if the queue was empty.
+   */
+  auto runPendingTask() -> bool;
+
  private:
   std::vector<std::thread> _threads;
   std::mutex _mutex;
@@ -81,4 +91,48 @@ class ThreadPool final {
   std::deque<std::packaged_task<void()> > _tasks;
 };
 
+/**
+ * @brief The pool shared by the parallel filters, one worker per hardware
+ * thread, started on first use.
+ *
+ */
+auto DefaultThreadPool() -> ThreadPool&;
+
+/**
+ * @brief Split the range [begin, end) into chunks and process them on the
+ * pool. Blocks until all chunks are done, the waiting thread runs queued jobs
+ * meanwhile, so a ParallelFor nested in a job of the same pool cannot starve
+ * it. The first exception of a chunk is rethrown once all chunks are done.
+ *
+ * @param pool the workers.
+ * @param begin
+ * @param end
+ * @param chunkSize number of elements per chunk, the chunks start at
+ * begin + k * chunkSize.
+ * @param f callable taking the first and the past the end element of a chunk.
+ */
+template <class Function>
+void ParallelFor(ThreadPool& pool, const int32_t begin, const int32_t end,
+                 const int32_t chunkSize, Function&& f) {
+  std::vector<std::future<void>> futures;
+  for (auto i = begin; i < end; i += chunkSize) {
+    const auto chunkEnd = std::min(i + chunkSize, end);
+    futures.push_back(pool.add_back([&f, i, chunkEnd]() {
+      f(i, chunkEnd);
+    }));
+  }
+  for (auto& future : futures) {
+    while (future.wait_for(std::chrono::seconds(0)) !=
+           std::future_status::ready) {
+      if (!pool.runPendingTask()) {
+        future.wait();
+      }
+    }
+  }
+  // rethrow only after all chunks are done, they reference f
+  for (auto& future : futures) {
+    future.get();
+  }
+}
+
 }  // namespace painty
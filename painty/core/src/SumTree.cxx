@@ -0,0 +1,87 @@
+/**
+ * @file SumTree.cxx
+ * @author thomas lindemeier
+ * @brief
+ * @date 2020-11-02
+ *
+ */
+
+#include "painty/core/SumTree.hxx"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace painty {
+
+SumTree::SumTree(const std::vector<double>& weights) : _size(weights.size()) {
+  while (_leaves < _size) {
+    _leaves *= 2UL;
+  }
+  _nodes = std::vector<double>(2UL * _leaves, 0.0);
+  for (size_t i = 0UL; i < _size; i++) {
+    _nodes[_leaves + i] = std::max(weights[i], 0.0);
+  }
+  for (auto i = _leaves - 1UL; i > 0UL; i--) {
+    _nodes[i] = _nodes[2UL * i] + _nodes[2UL * i + 1UL];
+  }
+}
+
+auto SumTree::size() const -> size_t {
+  return _size;
+}
+
+auto SumTree::total() const -> double {
+  return _nodes[1UL];
+}
+
+auto SumTree::weight(const size_t index) const -> double {
+  if (index >= _size) {
+    throw std::out_of_range("SumTree index out of range");
+  }
+  return _nodes[_leaves + index];
+}
+
+void SumTree::set(const size_t index, const double weight) {
+  fill(index, index + 1UL, weight);
+}
+
+void SumTree::fill(const size_t begin, const size_t end, const double weight) {
+  if ((begin > end) || (end > _size)) {
+    throw std::out_of_range("SumTree range out of range");
+  }
+  if (begin == end) {
+    return;
+  }
+  auto first = _leaves + begin;
+  auto last  = _leaves + end - 1UL;
+  std::fill(_nodes.begin() + static_cast<std::ptrdiff_t>(first),
+            _nodes.begin() + static_cast<std::ptrdiff_t>(last + 1UL),
+            std::max(weight, 0.0));
+  // the sums are recomputed instead of updated, so they do not drift and
+  // cleared subtrees are exactly zero
+  while (first > 1UL) {
+    first /= 2UL;
+    last /= 2UL;
+    for (auto i = first; i <= last; i++) {
+      _nodes[i] = _nodes[2UL * i] + _nodes[2UL * i + 1UL];
+    }
+  }
+}
+
+auto SumTree::find(double u) const -> size_t {
+  auto node = 1UL;
+  while (node < _leaves) {
+    const auto left  = _nodes[2UL * node];
+    const auto right = _nodes[2UL * node + 1UL];
+    // rounding may push u past the last positive weight
+    if ((u < left) || (right <= 0.0)) {
+      node = 2UL * node;
+    } else {
+      u -= left;
+      node = 2UL * node + 1UL;
+    }
+  }
+  return std::min(node - _leaves, _size - 1UL);
+}
+
+}  // namespace painty
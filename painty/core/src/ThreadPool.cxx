@@ -29,7 +29,12 @@ void ThreadPool::start() {
 }
 
 void ThreadPool::stop() {
-  _stop = true;
+  {
+    // under the lock, so that no worker misses the notification between its
+    // check of the queue and its wait
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stop = true;
+  }
 
   _condition.notify_all();
 
@@ -45,6 +50,20 @@ void ThreadPool::clear() {
   _tasks.clear();
 }
 
+auto ThreadPool::runPendingTask() -> bool {
+  std::packaged_task<void()> f;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_tasks.empty()) {
+      return false;
+    }
+    f = std::move(_tasks.front());
+    _tasks.pop_front();
+  }
+  f();
+  return true;
+}
+
 void ThreadPool::initWorkers() {
   _stop = false;
   for (auto& thread : _threads) {
@@ -55,10 +74,10 @@ void ThreadPool::initWorkers() {
         std::unique_lock<std::mutex> lock(_mutex);
 
         while (_tasks.empty()) {
-          _condition.wait(lock);
           if (_stop) {
             return;
           }
+          _condition.wait(lock);
         }
 
         f = std::move(_tasks.front());
@@ -72,4 +91,9 @@ void ThreadPool::initWorkers() {
   }
 }
 
+auto DefaultThreadPool() -> ThreadPool& {
+  static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1U));
+  return pool;
+}
+
 }  // namespace painty
@@ -0,0 +1,64 @@
+/**
+ * @file SumTreeTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-02
+ *
+ */
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "painty/core/SumTree.hxx"
+
+TEST(SumTreeTest, Find) {
+  painty::SumTree tree({1.0, 0.0, 2.0, -1.0, 3.0});
+  EXPECT_EQ(tree.size(), 5UL);
+  EXPECT_NEAR(tree.total(), 6.0, 1e-12);
+  EXPECT_NEAR(tree.weight(3UL), 0.0, 1e-12);
+  EXPECT_EQ(tree.find(0.0), 0UL);
+  EXPECT_EQ(tree.find(0.999), 0UL);
+  EXPECT_EQ(tree.find(1.0), 2UL);
+  EXPECT_EQ(tree.find(2.999), 2UL);
+  EXPECT_EQ(tree.find(3.0), 4UL);
+  EXPECT_EQ(tree.find(5.999), 4UL);
+  EXPECT_EQ(tree.find(6.0), 4UL);
+  EXPECT_THROW(tree.weight(5UL), std::out_of_range);
+}
+
+TEST(SumTreeTest, Update) {
+  painty::SumTree tree(std::vector<double>(37UL, 0.5));
+  tree.fill(3UL, 30UL, 0.0);
+  EXPECT_NEAR(tree.total(), 5.0, 1e-12);
+  tree.set(10UL, 4.0);
+  EXPECT_NEAR(tree.total(), 9.0, 1e-12);
+  EXPECT_EQ(tree.find(1.5), 10UL);
+  EXPECT_THROW(tree.fill(30UL, 38UL, 1.0), std::out_of_range);
+
+  // cleared weights are never drawn
+  tree.fill(0UL, 37UL, 0.0);
+  EXPECT_NEAR(tree.total(), 0.0, 0.0);
+  tree.set(36UL, 1e-3);
+  std::default_random_engine generator;
+  for (auto i = 0; i < 100; i++) {
+    EXPECT_EQ(tree.sample(generator), 36UL);
+  }
+}
+
+TEST(SumTreeTest, Distribution) {
+  const std::vector<double> weights = {1.0, 2.0, 3.0, 4.0};
+  const painty::SumTree tree(weights);
+  std::vector<double> counts(weights.size(), 0.0);
+  std::default_random_engine generator;
+  const auto n = 100000;
+  for (auto i = 0; i < n; i++) {
+    counts[tree.sample(generator)] += 1.0;
+  }
+  for (size_t i = 0UL; i < weights.size(); i++) {
+    EXPECT_NEAR(counts[i] / n, weights[i] / 10.0, 0.01);
+  }
+}
@@ -50,3 +50,26 @@ TEST(ThreadPoolTest, Construct) {
     }
   }
 }
+
+TEST(ThreadPoolTest, ParallelForNested) {
+  // every worker of the pool waits for a nested ParallelFor
+  painty::ThreadPool pool(2U);
+  std::vector<int32_t> sums(8U, 0);
+  painty::ParallelFor(pool, 0, 8, 1, [&](const int32_t begin, const int32_t) {
+    std::vector<int32_t> values(100U, 0);
+    painty::ParallelFor(pool, 0, 100, 10,
+                        [&values](const int32_t b, const int32_t e) {
+                          for (auto i = b; i < e; i++) {
+                            values[static_cast<size_t>(i)] = i;
+                          }
+                        });
+    for (const auto v : values) {
+      sums[static_cast<size_t>(begin)] += v;
+    }
+  });
+  for (const auto sum : sums) {
+    EXPECT_EQ(sum, 4950);
+  }
+
+  EXPECT_EQ(&painty::DefaultThreadPool(), &painty::DefaultThreadPool());
+}
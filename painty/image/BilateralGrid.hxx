@@ -0,0 +1,40 @@
+/**
+ * @file BilateralGrid.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ *
+ * @date 2020-11-16
+ *
+ */
+#pragma once
+
+#include "painty/image/Mat.hxx"
+
+namespace painty {
+
+/**
+ * @brief Bilateral filter evaluated on a downsampled space-luminance grid.
+ * (Chen, J., Paris, S., and Durand, F. Real-time edge-aware image processing with the bilateral grid. ACM Transactions on Graphics 26, 3 (2007))
+ *
+ * The image is splatted into cells of sigmaSpatial x sigmaSpatial pixels and
+ * sigmaColor luminance, blurred there and sliced back, so the cost does not
+ * depend on the sigmas. The grid is processed in tiles on all cores, which
+ * bounds the memory for large images.
+ *
+ * In contrast to the orientation aligned bilateral filter, the kernel is
+ * isotropic instead of following the edge tangent flow, and the range kernel
+ * only uses the luminance, edges between colors of equal luminance are
+ * smoothed.
+ *
+ * @param imageInLab input image in CIELab color space.
+ * @param sigmaSpatial the sigma for the spatial blur in pixels, > 0.
+ * @param sigmaColor the sigma for the luminance, > 0.
+ * @param mask optional, of the image size. Pixels that are zero neither
+ * contribute to the grid nor get filtered, they are copied unchanged.
+ * @return Mat3d
+ */
+auto filterBilateralGrid(const Mat3d& imageInLab, double sigmaSpatial,
+                         double sigmaColor, const Mat1d& mask = Mat1d())
+  -> Mat3d;
+
+}  // namespace painty
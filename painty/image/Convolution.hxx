@@ -10,6 +10,7 @@
 
 #include "painty/core/Math.hxx"
 #include "painty/image/Mat.hxx"
+#include "painty/image/RecursiveGaussian.hxx"
 
 namespace painty {
 
@@ -99,8 +100,8 @@ Mat<T> differencesOfGaussians(const Mat<T>& input, const double sigma,
                               const double tau = 0.99) {
   Mat<T> d0;
   Mat<T> d1;
-  cv::GaussianBlur(input, d0, cv::Size(-1, -1), sigma);
-  cv::GaussianBlur(input, d1, cv::Size(-1, -1), 1.6 * sigma);
+  gaussianBlur(input, d0, sigma, cv::BORDER_DEFAULT);
+  gaussianBlur(input, d1, 1.6 * sigma, cv::BORDER_DEFAULT);
 
   return d0 - tau * d1;
 }
@@ -129,20 +130,35 @@ Mat<T> computeGaborEnergy(const Mat<T>& source, const double lambda,
   return superposition;
 }
 
+/**
+ * @brief The edge preserving filters available for smoothing input images.
+ *
+ */
+enum class SmoothingFilter {
+  OrientationAligned,  // follows the edge tangent flow, cost grows with sigma
+  BilateralGrid  // isotropic and luminance only, cost independent of sigma
+};
+
 /**
  * @brief Smoothes an image using the orientation aligned bilateral filter.
  * (Kyprianidis, J. E., and Kang, H. Image and video abstraction by coherence-enhancing filtering. Computer Graphics Forum 30, 2 (Apr. 2011), 593–602)
  *
  * @param labSource input image in CIELab color space.
+ * @param mask optional, zero pixels are skipped when computing the flow field.
+ * The bilateral grid also leaves them unchanged and excludes them from the
+ * smoothing of the others.
  * @param sigmaSpatial the sigma for the spatial blur
  * @param sigmaColor sigma for the color blur
  * @param sigmaFlow sigma for the flow field blur
  * @param nIterations number of iterations to run
+ * @param filter the filter, see filterBilateralGrid() for how the bilateral
+ * grid differs, it does not use the flow field.
  * @return Mat3d
  */
-auto smoothOABF(const Mat3d& labSource, const Mat1d& mask = Mat1d(),
-                const double sigmaSpatial = 3.0, const double sigmaColor = 4.25,
-                const double sigmaFlow = 3.0, const uint32_t nIterations = 5U)
-  -> Mat3d;
+auto smoothOABF(
+  const Mat3d& labSource, const Mat1d& mask = Mat1d(),
+  const double sigmaSpatial = 3.0, const double sigmaColor = 4.25,
+  const double sigmaFlow = 3.0, const uint32_t nIterations = 5U,
+  const SmoothingFilter filter = SmoothingFilter::OrientationAligned) -> Mat3d;
 
 }  // namespace painty
@@ -10,6 +10,7 @@
 
 #include "painty/core/Vec.hxx"
 #include "painty/image/Mat.hxx"
+#include "painty/image/StreamlineCache.hxx"
 
 namespace painty {
 namespace tensor {
@@ -25,10 +26,51 @@ vec2 GetMaxEigenvector(const vec3& tensor);
 Mat3d ComputeTensors(const Mat3d& image, const Mat1d& mask, double innerSigma,
                      double outerSigma);
 
+/**
+ * @brief The first pass of ComputeTensorsFused(), the products dx2, dxy and
+ * dy2 of the image gradients and the mask weight.
+ *
+ * @param maskProducts zero the products and the weight outside of the mask.
+ * @return Mat<vec4f>
+ */
+Mat<vec4f> ComputeGradientProducts(const Mat3d& image, const Mat1d& mask,
+                                   double innerSigma, bool maskProducts);
+
+/**
+ * @brief The last passes of ComputeTensorsFused(), normalized tensors from
+ * blurred gradient products.
+ *
+ * @param maskProducts divide the products by the blurred mask weight.
+ * @param etf receives the edge tangent flow if not null.
+ * @return Mat<vec3f>
+ */
+Mat<vec3f> NormalizeGradientProducts(const Mat<vec4f>& products,
+                                     bool maskProducts,
+                                     Mat<vec2f>* etf = nullptr);
+
+/**
+ * @brief Single precision ComputeTensors(). The gradients and their products
+ * are computed in one pass over the image on all cores, the products are
+ * blurred together and the edge tangent flow is computed while normalizing.
+ *
+ * @param etf receives the edge tangent flow if not null.
+ * @return Mat<vec3f>
+ */
+Mat<vec3f> ComputeTensorsFused(const Mat3d& image, const Mat1d& mask,
+                               double innerSigma, double outerSigma,
+                               Mat<vec2f>* etf = nullptr);
+
 }  // namespace tensor
 
 Mat2d ComputeEdgeTangentFlow(const Mat3d& structureTensorField);
 
 Mat1d lineIntegralConv(const Mat2d& etf, double sigmaL);
 
+/**
+ * @brief Line integral convolution along precomputed streamlines, which have
+ * to cover the kernel of sigmaL.
+ *
+ */
+Mat1d lineIntegralConv(const StreamlineCache& streamlines, double sigmaL);
+
 }  // namespace painty
@@ -7,6 +7,7 @@
  */
 #pragma once
 #include "painty/image/Mat.hxx"
+#include "painty/image/StreamlineCache.hxx"
 
 namespace painty {
 /**
@@ -29,11 +30,23 @@ class FlowBasedDoG {
   static Mat1d thresholdingXDoG(const Mat1d& response, double xdogParamEps,
                                 double xdogParamPhi);
 
+  /**
+   * @brief Reuses the streamlines of tfm, they have to be at least
+   * 2 * sigmaSmoothing long.
+   *
+   */
   static Mat1d filterFlowBasedDoG(const Mat1d& img, const Mat2d& tfm,
+                                  const StreamlineCache& streamlines,
                                   double sigma_e, double sigma_r, double tau,
                                   double sigmaSmoothing);
 
-  static void smoothAlongFlow(const Mat1d& img, Mat1d& dst, const Mat2d& tfm,
+  /**
+   * @brief Reuses the streamlines of a flow field, they have to be at least
+   * 2 * sigma_m long.
+   *
+   */
+  static void smoothAlongFlow(const Mat1d& img, Mat1d& dst,
+                              const StreamlineCache& streamlines,
                               double sigma_m);
 
  private:
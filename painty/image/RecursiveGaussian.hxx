@@ -0,0 +1,64 @@
+/**
+ * @file RecursiveGaussian.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ *
+ * @date 2020-11-19
+ *
+ */
+#pragma once
+
+#include "painty/image/Mat.hxx"
+
+namespace painty {
+
+/**
+ * @brief From this sigma on, gaussianBlur() uses the recursive filter. Below,
+ * the kernels are short and cv::GaussianBlur is faster and exact.
+ *
+ */
+constexpr auto RecursiveGaussianMinSigma = 6.0;
+
+/**
+ * @brief Gaussian blur with a recursive filter.
+ * (Young, I. T., and van Vliet, L. J. Recursive implementation of the Gaussian filter. Signal Processing 44, 2 (1995))
+ *
+ * A causal and an anticausal third order filter run along the rows and the
+ * columns, which costs the same for every sigma. The borders are extended by
+ * replicating the edge pixels. The work is split over all cores.
+ *
+ * @param src float or double image with any number of channels
+ * @param dst blurred image of the type of src, may be src
+ * @param sigma standard deviation, >= 0.5
+ */
+void recursiveGaussianBlur(cv::InputArray src, cv::OutputArray dst,
+                           double sigma);
+
+/**
+ * @brief Gaussian blur that uses recursiveGaussianBlur() for float and double
+ * images from RecursiveGaussianMinSigma on and cv::GaussianBlur below.
+ *
+ * @param src source image
+ * @param dst blurred image of the type of src, may be src
+ * @param sigma standard deviation, the image is copied for sigma <= 0
+ * @param borderType border of cv::GaussianBlur
+ */
+void gaussianBlur(cv::InputArray src, cv::OutputArray dst, double sigma,
+                  int borderType = cv::BORDER_REFLECT);
+
+/**
+ * @brief Mask normalized Gaussian blur, blur(src * m) / blur(m) with m being 1
+ * where the mask is > 0 and 0 elsewhere. Only pixels inside the mask
+ * contribute, pixels without any contributing neighbor become zero.
+ *
+ * @param src float or double image with any number of channels
+ * @param mask computation mask of the size of src
+ * @param dst blurred image of the type of src, may be src
+ * @param sigma standard deviation, > 0
+ * @param borderType border of cv::GaussianBlur
+ */
+void gaussianBlurMasked(cv::InputArray src, const Mat1d& mask,
+                        cv::OutputArray dst, double sigma,
+                        int borderType = cv::BORDER_REFLECT);
+
+}  // namespace painty
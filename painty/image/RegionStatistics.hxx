@@ -0,0 +1,90 @@
+/**
+ * @file RegionStatistics.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ *
+ * @date 2020-11-24
+ *
+ */
+#pragma once
+
+#include <vector>
+
+#include "painty/image/Mat.hxx"
+
+namespace painty {
+/**
+ * @brief Per label pixel count, channel sums and sums of squares of several
+ * images, reduced in one parallel pass over the label map. The moments are
+ * stored in flat arrays indexed by label, so a query is a lookup instead of a
+ * walk over the points of an ImageRegion.
+ *
+ */
+class RegionStatistics {
+ public:
+  /**
+   * @brief Construct a new Region Statistics object
+   *
+   * @param labels label map, labels outside [0, labelCount) are skipped
+   * @param labelCount number of regions
+   * @param images double images of the size of the label map, indexed in the
+   * order given
+   * @param bandCount number of row bands reduced in parallel, 0 uses one band
+   * per hardware thread
+   */
+  RegionStatistics(const Mat1i& labels, int32_t labelCount,
+                   const std::vector<cv::Mat>& images, int32_t bandCount = 0);
+
+  auto labelCount() const -> int32_t;
+
+  auto count(int32_t label) const -> size_t;
+
+  auto sum(size_t image, int32_t label, int32_t channel) const -> double;
+
+  /**
+   * @brief Zero for empty labels.
+   *
+   */
+  auto mean(size_t image, int32_t label, int32_t channel) const -> double;
+
+  template <int32_t Channels>
+  auto mean(const size_t image, const int32_t label) const
+    -> vec<double, Channels> {
+    vec<double, Channels> m;
+    for (auto c = 0; c < Channels; c++) {
+      m[c] = mean(image, label, c);
+    }
+    return m;
+  }
+
+  /**
+   * @brief The sum of the squared norms of the pixels of a label.
+   *
+   */
+  auto sumOfSquares(size_t image, int32_t label) const -> double;
+
+  /**
+   * @brief Root mean square norm of the pixels of a label, as
+   * ImageRegion::computeRms(), zero for empty labels.
+   *
+   */
+  auto rms(size_t image, int32_t label) const -> double;
+
+ private:
+  auto index(size_t image, int32_t label, int32_t channel) const -> size_t;
+
+  int32_t _labelCount = 0;
+
+  /**
+   * @brief The first channel of each image in the channels of a label.
+   *
+   */
+  std::vector<int32_t> _offsets;
+  std::vector<int32_t> _channels;
+  int32_t _stride = 0;
+
+  std::vector<size_t> _counts;
+  std::vector<double> _sums;
+  std::vector<double> _squares;
+};
+}  // namespace painty
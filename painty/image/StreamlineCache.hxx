@@ -0,0 +1,77 @@
+/**
+ * @file StreamlineCache.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ *
+ * @date 2020-11-17
+ *
+ */
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "painty/image/Mat.hxx"
+
+namespace painty {
+
+/**
+ * @brief Streamlines through an edge tangent flow field, traced once forwards
+ * and backwards from every pixel and shared by the filters that integrate
+ * along the flow.
+ *
+ * The streamlines advance from cell to cell as in Kyprianidis, J. E., and
+ * Kang, H. Image and video abstraction by coherence-enhancing filtering, so
+ * the filters weight a sample by the step length that led to it.
+ */
+class StreamlineCache final {
+ public:
+  struct Sample {
+    float x = 0.0F;
+    float y = 0.0F;
+
+    /**
+     * @brief Along the streamline from the pixel to the sample.
+     *
+     */
+    float arcLength = 0.0F;
+  };
+
+  enum class Direction : uint32_t { Forward = 0U, Backward = 1U };
+
+  /**
+   * @brief Trace the streamlines of all pixels on all cores.
+   *
+   * @param etf the edge tangent flow.
+   * @param length the arc length traced in each direction, the last sample is
+   * the first one at or beyond it.
+   */
+  StreamlineCache(const Mat2d& etf, double length);
+
+  auto getLength() const -> double;
+
+  auto getSize() const -> cv::Size;
+
+  /**
+   * @brief The samples of the streamline of a pixel in one direction, ordered
+   * by arc length.
+   *
+   * @return the begin and end of the samples.
+   */
+  auto getSamples(int32_t y, int32_t x, Direction direction) const
+    -> std::pair<const Sample*, const Sample*>;
+
+ private:
+  double _length = 0.0;
+  cv::Size _size = {};
+
+  /**
+   * @brief Begin of the forward and backward samples of every pixel, followed
+   * by the end of the last pixel.
+   *
+   */
+  std::vector<uint64_t> _offsets;
+  std::vector<Sample> _samples;
+};
+
+}  // namespace painty
@@ -10,15 +10,25 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <vector>
 
 #include "painty/image/Mat.hxx"
 
 namespace painty {
+class ThreadPool;
+
 class ImageRegion {
   int32_t label;
 
-  std::vector<vec2i> points;
+  /**
+   * @brief The points of the region are [pointsBegin, pointsEnd) of a buffer
+   * that may be shared with other regions.
+   *
+   */
+  std::shared_ptr<const std::vector<vec2i>> points;
+  size_t pointsBegin;
+  size_t pointsEnd;
 
   bool active;
 
@@ -27,6 +37,14 @@ class ImageRegion {
 
   ImageRegion(int32_t label, const Mat1i& labelsMap);
 
+  /**
+   * @brief A view of the range [begin, end) of a point buffer.
+   *
+   */
+  ImageRegion(int32_t label,
+              const std::shared_ptr<const std::vector<vec2i>>& pointBuffer,
+              size_t begin, size_t end);
+
   void setLabel(int32_t label);
 
   void setActive(bool active);
@@ -37,56 +55,64 @@ class ImageRegion {
 
   vec2 getSpatialMean() const;
 
-  std::vector<vec2i>::const_iterator cbegin();
+  const vec2i* cbegin() const;
+
+  const vec2i* cend() const;
+
+  const vec2i* begin() const;
+
+  const vec2i* end() const;
+
+  size_t size() const;
 
-  std::vector<vec2i>::const_iterator cend();
+  bool empty() const;
 
   double getInscribedCircle(vec2& incenter) const;
 
   template <class T>
   typename DataType<T>::channel_type computeRms(const Mat<T>& data0,
                                                 const Mat<T>& data1) const {
-    if (points.empty()) {
+    if (empty()) {
       return T(0.);
     }
     typename DataType<T>::channel_type s = T(0.);
-    for (const vec2i& p : points) {
+    for (const vec2i& p : *this) {
       s += (data0(p[1], p[0]) - data1(p[1], p[0])).squaredNorm();
     }
 
-    return std::sqrt(s /= points.size());
+    return std::sqrt(s /= size());
   }
 
   template <class T>
   T computeRms(const Mat<T>& diff) const {
-    if (points.empty()) {
+    if (empty()) {
       return static_cast<T>(0.0);
     }
     T s = static_cast<T>(0.0);
-    for (const vec2i& p : points) {
+    for (const vec2i& p : *this) {
       s += std::pow(diff(p[1], p[0]), static_cast<T>(2.0));
     }
 
-    return std::sqrt(s /= static_cast<T>(points.size()));
+    return std::sqrt(s /= static_cast<T>(size()));
   }
 
   template <class T>
   void fill(Mat<T>& m, const T& v) const {
-    if (points.empty()) {
+    if (empty()) {
       return;
     }
-    for (const vec2i& p : points) {
+    for (const vec2i& p : *this) {
       m(p[1], p[0]) = v;
     }
   }
 
   template <class T>
   T computeSum(const Mat<T>& v) const {
-    if (points.empty()) {
+    if (empty()) {
       return T(0.);
     }
     T s = T(0.);
-    for (const vec2i& p : points) {
+    for (const vec2i& p : *this) {
       s += v(p[1], p[0]);
     }
 
@@ -96,19 +122,19 @@ class ImageRegion {
   template <class T>
   T computeMean(const Mat<T>& data) const {
     T m = 0.;
-    for (const vec2i& p : points) {
+    for (const vec2i& p : *this) {
       m += data(p[1], p[0]);
     }
-    return (1.0 / static_cast<T>(points.size())) * m;
+    return (1.0 / static_cast<T>(size())) * m;
   }
 
   template <class T, int32_t Channels>
   vec<T, Channels> computeMean(const Mat<vec<T, Channels> >& data) const {
     vec<T, Channels> m = vec<T, Channels>::Zero();
-    for (const vec2i& p : points) {
+    for (const vec2i& p : *this) {
       m += data(p[1], p[0]);
     }
-    return (1.0 / static_cast<T>(points.size())) * m;
+    return (1.0 / static_cast<T>(size())) * m;
   }
 
   Mat1d getDistanceTransform(const cv::Rect2i& boundingRectangle) const;
@@ -116,6 +142,51 @@ class ImageRegion {
   cv::Rect2i getBoundingRectangle() const;
 };
 
+/**
+ * @brief Split a label map into regions with a counting sort over the labels.
+ * The points of all regions are stored in one buffer, each region is a view
+ * of its range, so the cost does not depend on the number of labels.
+ *
+ * @param labels label map, labels outside [0, labelCount) are skipped
+ * @param labelCount number of regions
+ * @return the region of every label, indexed by label
+ */
+auto ExtractImageRegions(const Mat1i& labels, int32_t labelCount)
+  -> std::vector<ImageRegion>;
+
+/**
+ * @brief Squared Euclidean distance of every pixel to the nearest pixel with
+ * another label, pixels outside the map count as another label.
+ * (Felzenszwalb, P. F., and Huttenlocher, D. P. Distance transforms of sampled functions. Theory of Computing 8, 19 (2012))
+ *
+ * The nearest pixel of another label in a column bounds the runs of equal
+ * labels, and along a row only parabolas of the own run and the two pixels
+ * ending it can be nearest. So the transform of all labels is exact and
+ * costs one pass over the map.
+ *
+ * @param labels label map
+ * @return Mat1d
+ */
+auto ComputeLabelDistances(const Mat1i& labels) -> Mat1d;
+
+struct InscribedCircle {
+  vec2 center   = vec2::Zero();
+  double radius = 0.0;
+};
+
+/**
+ * @brief Largest inscribed circles of all labels from one label aware
+ * distance transform. The center is the first pixel farthest away from other
+ * labels, the radius the distance to them minus one, as in
+ * ImageRegion::getInscribedCircle(). Empty labels get a zero circle.
+ *
+ * @param labels label map, labels outside [0, labelCount) are skipped
+ * @param labelCount number of regions
+ * @return the circle of every label, indexed by label
+ */
+auto ComputeInscribedCircles(const Mat1i& labels, int32_t labelCount)
+  -> std::vector<InscribedCircle>;
+
 class SuperpixelSegmentation {
   class SuperPixel {
    public:
@@ -166,6 +237,21 @@ class SuperpixelSegmentation {
   void extractWithDiff(const Mat3d& targetLab, const Mat1d& difference,
                        const Mat1d& mask, int32_t cellWidth);
 
+  /**
+   * @brief Warm start the segmentation of the last extractWithDiff() call for
+   * a changed difference map of the same target.
+   *
+   * Clusters whose window saw a mean absolute change of the difference of at
+   * most minChange are frozen. Only the active clusters are iterated again,
+   * starting from the previous labels and centers, and only the image tiles
+   * they reach are visited. Falls back to extractWithDiff() if there is no
+   * previous SLIC segmentation.
+   *
+   * @param difference the new difference map
+   * @param minChange the mean change that activates a cluster
+   */
+  void updateWithDiff(const Mat1d& difference, double minChange);
+
   void getSegmentationOutlined(Mat3d& background) const;
 
   const Mat1i& getRegions(std::map<int32_t, ImageRegion>& regions);
@@ -177,10 +263,49 @@ class SuperpixelSegmentation {
  private:
   void perturbClusterCenters(std::vector<SuperPixel>& superPixels) const;
 
-  double computeStats(std::vector<SuperPixel>& superPixels,
-                      Mat<int32_t>& labels) const;
-
-  double distance(SuperPixel& superPixel, const vec2i& pos2) const;
+  /**
+   * @brief Move the active clusters to the mean of their pixels, all clusters
+   * if active is empty.
+   *
+   */
+  double computeStats(ThreadPool& pool, std::vector<SuperPixel>& superPixels,
+                      Mat<int32_t>& labels,
+                      const std::vector<uint8_t>& active) const;
+
+  /**
+   * @brief Assign the pixels to the nearest cluster whose window of the given
+   * radius contains them, on tiles of the image in parallel. A pixel only
+   * changes its label if it is closer to a cluster than it was before. The
+   * maximum distances of each cluster are reduced from the tiles afterwards.
+   * If active is not empty, only the tiles reached by active clusters are
+   * visited.
+   *
+   */
+  void assignPixels(ThreadPool& pool, int32_t radius, Mat<int32_t>& labels,
+                    Mat1d& distances, const std::vector<uint8_t>& active);
+
+  /**
+   * @brief Squared color, difference and spatial distance of a pixel to a
+   * cluster.
+   *
+   */
+  vec3 squaredDistances(const SuperPixel& superPixel, int32_t x,
+                        int32_t y) const;
+
+  bool isAssignable(int32_t x, int32_t y) const;
+
+  /**
+   * @brief Iterate the active clusters, all if active is empty, until they
+   * converge and relabel.
+   *
+   */
+  void iterate(ThreadPool& pool, const std::vector<uint8_t>& active);
+
+  /**
+   * @brief Compute the connected labels from the assignment.
+   *
+   */
+  void relabel();
 
   std::vector<SuperPixel> _superPixels;
   Mat3d _targetLab;
@@ -188,6 +313,16 @@ class SuperpixelSegmentation {
   Mat<int32_t> _labels;
   Mat1d _mask;
 
+  /**
+   * @brief SLIC state kept for warm starts, the cluster of each pixel before
+   * the connectivity is enforced and its distance to it.
+   *
+   */
+  Mat<int32_t> _assignment;
+  Mat1d _distances;
+  int32_t _cellWidth = 0;
+  int32_t _gridStep  = 0;
+
   ExtractionStrategy _extractionStrategy =
     ExtractionStrategy::SLICO_POISSON_WEIGHTED;
 
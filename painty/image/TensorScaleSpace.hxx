@@ -0,0 +1,74 @@
+/**
+ * @file TensorScaleSpace.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ *
+ * @date 2020-11-18
+ *
+ */
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "painty/image/Mat.hxx"
+
+namespace painty {
+
+/**
+ * @brief Gaussian scale space of the structure tensors of an image.
+ *
+ * The gradient products dx2, dxy and dy2 are computed once. A level for the
+ * outer sigma s2 is blurred by sqrt(s2^2 - s1^2) from the next finer level s1
+ * instead of from the gradients, so querying tensors for several scales costs
+ * about one blur of the largest scale. Gradients are not blurred, which
+ * corresponds to an inner sigma of zero. Not thread safe.
+ */
+class TensorScaleSpace final {
+ public:
+  /**
+   * @brief Compute the gradient products of an image.
+   *
+   * @param image source image, preferably in CIELab space
+   * @param mask computation mask, zero pixels are skipped
+   */
+  TensorScaleSpace(const Mat3d& image, const Mat1d& mask);
+
+  /**
+   * @brief Add the levels for outer sigmas, in ascending order so each level
+   * is blurred from the previous one.
+   *
+   * @param sigmas
+   */
+  void addLevels(std::vector<double> sigmas);
+
+  /**
+   * @brief Normalized structure tensors for an outer sigma, as computed by
+   * tensor::ComputeTensors() with an inner sigma of zero. A missing level is
+   * added from the next finer level.
+   *
+   * @param outerSigma sigma for gauss blurring the tensors
+   * @return Mat3d
+   */
+  auto getTensors(double outerSigma) -> Mat3d;
+
+  /**
+   * @brief Number of levels including the unblurred one.
+   *
+   */
+  auto getLevelCount() const -> std::size_t;
+
+ private:
+  auto getLevel(double sigma) -> const Mat<vec4f>&;
+
+  Mat3d _image;
+  Mat1d _mask;
+
+  /**
+   * @brief Gradient products and mask weight by sigma.
+   *
+   */
+  std::map<double, Mat<vec4f>> _levels;
+};
+
+}  // namespace painty
@@ -0,0 +1,236 @@
+/**
+ * @file BilateralGrid.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ *
+ * @date 2020-11-16
+ *
+ */
+#include "painty/image/BilateralGrid.hxx"
+
+#include <algorithm>
+#include <array>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "painty/core/ThreadPool.hxx"
+
+namespace painty {
+
+namespace {
+/**
+ * @brief Cells around a tile that contribute to it, one for the trilinear
+ * interpolation and two for the blur kernel.
+ *
+ */
+constexpr auto Margin = 3;
+
+/**
+ * @brief The tile size is at least this many cells, so the margins are a small
+ * part of the work for large spatial sigmas.
+ *
+ */
+constexpr auto MinTileCells = 32.0;
+
+constexpr auto MinTileSize = 256;
+
+/**
+ * @brief Homogeneous L, a, b and weight.
+ *
+ */
+using Cell = std::array<float, 4UL>;
+
+class Grid final {
+ public:
+  Grid(const int32_t nx, const int32_t ny, const int32_t nz)
+      : _nx(nx),
+        _ny(ny),
+        _nz(nz),
+        _cells(static_cast<std::size_t>(nx * ny * nz), Cell{}),
+        _tmp(_cells.size()) {}
+
+  void splat(const double gx, const double gy, const double gz,
+             const Cell& value) {
+    forEachCorner(gx, gy, gz, [this, &value](std::size_t i, float w) {
+      for (auto c = 0UL; c < value.size(); c++) {
+        _cells[i][c] += w * value[c];
+      }
+    });
+  }
+
+  auto slice(const double gx, const double gy, const double gz) const -> Cell {
+    Cell value = {};
+    forEachCorner(gx, gy, gz, [this, &value](std::size_t i, float w) {
+      for (auto c = 0UL; c < value.size(); c++) {
+        value[c] += w * _cells[i][c];
+      }
+    });
+    return value;
+  }
+
+  /**
+   * @brief Blur with the binomial kernel 1 4 6 4 1 along all dimensions.
+   *
+   */
+  void blur() {
+    blurAxis(_nz, 1);
+    blurAxis(_nx, _nz);
+    blurAxis(_ny, _nx * _nz);
+  }
+
+ private:
+  template <class Function>
+  void forEachCorner(const double gx, const double gy, const double gz,
+                     Function&& f) const {
+    const auto x  = std::clamp(static_cast<int32_t>(gx), 0, _nx - 2);
+    const auto y  = std::clamp(static_cast<int32_t>(gy), 0, _ny - 2);
+    const auto z  = std::clamp(static_cast<int32_t>(gz), 0, _nz - 2);
+    const auto fx = static_cast<float>(gx - x);
+    const auto fy = static_cast<float>(gy - y);
+    const auto fz = static_cast<float>(gz - z);
+    for (auto dy = 0; dy < 2; dy++) {
+      const auto wy = (dy == 0) ? (1.0F - fy) : fy;
+      for (auto dx = 0; dx < 2; dx++) {
+        const auto wxy = wy * ((dx == 0) ? (1.0F - fx) : fx);
+        const auto i   = static_cast<std::size_t>(
+          ((y + dy) * _nx + (x + dx)) * _nz + z);
+        f(i, wxy * (1.0F - fz));
+        f(i + 1UL, wxy * fz);
+      }
+    }
+  }
+
+  void blurAxis(const int32_t size, const int32_t stride) {
+    static constexpr std::array<float, 5UL> Kernel = {
+      1.0F / 16.0F, 4.0F / 16.0F, 6.0F / 16.0F, 4.0F / 16.0F, 1.0F / 16.0F};
+    const auto total = static_cast<int32_t>(_cells.size());
+    for (auto i = 0; i < total; i++) {
+      const auto a = (i / stride) % size;
+      Cell sum     = {};
+      for (auto k = -2; k <= 2; k++) {
+        if (((a + k) < 0) || ((a + k) >= size)) {
+          continue;
+        }
+        const auto& cell = _cells[static_cast<std::size_t>(i + k * stride)];
+        const auto w     = Kernel[static_cast<std::size_t>(k + 2)];
+        for (auto c = 0UL; c < sum.size(); c++) {
+          sum[c] += w * cell[c];
+        }
+      }
+      _tmp[static_cast<std::size_t>(i)] = sum;
+    }
+    _cells.swap(_tmp);
+  }
+
+  int32_t _nx = 0;
+  int32_t _ny = 0;
+  int32_t _nz = 0;
+  std::vector<Cell> _cells;
+  std::vector<Cell> _tmp;
+};
+}  // namespace
+
+auto filterBilateralGrid(const Mat3d& imageInLab, const double sigmaSpatial,
+                         const double sigmaColor, const Mat1d& mask)
+  -> Mat3d {
+  if ((sigmaSpatial <= 0.0) || (sigmaColor <= 0.0)) {
+    throw std::invalid_argument("Sigmas of the bilateral grid must be > 0");
+  }
+  if (!mask.empty() && (mask.size() != imageInLab.size())) {
+    throw std::invalid_argument("Mask of the bilateral grid must be of the "
+                                "image size");
+  }
+  const auto isInside = [&mask](const int32_t y, const int32_t x) {
+    return mask.empty() || (mask(y, x) > 0.0);
+  };
+  Mat3d out(imageInLab.size());
+  if (imageInLab.empty()) {
+    return out;
+  }
+
+  auto minL = imageInLab(0)[0U];
+  auto maxL = minL;
+  for (auto i = 0; i < static_cast<int32_t>(imageInLab.total()); i++) {
+    minL = std::min(minL, imageInLab(i)[0U]);
+    maxL = std::max(maxL, imageInLab(i)[0U]);
+  }
+  const auto nz = static_cast<int32_t>((maxL - minL) / sigmaColor) + 2;
+
+  const auto s = sigmaSpatial;
+  const auto processTile = [&](const cv::Rect& tile) {
+    // the cells covering the tile plus the margin
+    const auto cx0 = static_cast<int32_t>(std::floor(tile.x / s)) - Margin;
+    const auto cy0 = static_cast<int32_t>(std::floor(tile.y / s)) - Margin;
+    const auto cx1 =
+      static_cast<int32_t>(std::floor((tile.x + tile.width - 1) / s)) +
+      Margin + 1;
+    const auto cy1 =
+      static_cast<int32_t>(std::floor((tile.y + tile.height - 1) / s)) +
+      Margin + 1;
+    Grid grid(cx1 - cx0 + 1, cy1 - cy0 + 1, nz);
+
+    const auto xBegin = std::max(0, static_cast<int32_t>(std::ceil(cx0 * s)));
+    const auto yBegin = std::max(0, static_cast<int32_t>(std::ceil(cy0 * s)));
+    const auto xEnd =
+      std::min(imageInLab.cols, static_cast<int32_t>(std::ceil(cx1 * s)));
+    const auto yEnd =
+      std::min(imageInLab.rows, static_cast<int32_t>(std::ceil(cy1 * s)));
+    for (auto y = yBegin; y < yEnd; y++) {
+      for (auto x = xBegin; x < xEnd; x++) {
+        if (!isInside(y, x)) {
+          continue;
+        }
+        const auto& c = imageInLab(y, x);
+        grid.splat(x / s - cx0, y / s - cy0, (c[0U] - minL) / sigmaColor,
+                   {static_cast<float>(c[0U]), static_cast<float>(c[1U]),
+                    static_cast<float>(c[2U]), 1.0F});
+      }
+    }
+
+    grid.blur();
+
+    for (auto y = tile.y; y < (tile.y + tile.height); y++) {
+      for (auto x = tile.x; x < (tile.x + tile.width); x++) {
+        const auto& c = imageInLab(y, x);
+        if (!isInside(y, x)) {
+          out(y, x) = c;
+          continue;
+        }
+        const auto v = grid.slice(x / s - cx0, y / s - cy0,
+                                 (c[0U] - minL) / sigmaColor);
+        out(y, x) = (v[3U] > 0.0F)
+                      ? vec3(static_cast<double>(v[0U] / v[3U]),
+                             static_cast<double>(v[1U] / v[3U]),
+                             static_cast<double>(v[2U] / v[3U]))
+                      : c;
+      }
+    }
+  };
+
+  const auto tileSize =
+    std::max(MinTileSize, static_cast<int32_t>(std::ceil(MinTileCells * s)));
+  auto& pool = DefaultThreadPool();
+  std::vector<std::future<void>> futures;
+  for (auto ty = 0; ty < imageInLab.rows; ty += tileSize) {
+    for (auto tx = 0; tx < imageInLab.cols; tx += tileSize) {
+      const auto tile =
+        cv::Rect(tx, ty, std::min(tileSize, imageInLab.cols - tx),
+                 std::min(tileSize, imageInLab.rows - ty));
+      futures.push_back(pool.add_back([&processTile, tile]() {
+        processTile(tile);
+      }));
+    }
+  }
+  // the pool is shared, no job may outlive processTile if one of them fails
+  for (const auto& f : futures) {
+    f.wait();
+  }
+  for (auto& f : futures) {
+    f.get();
+  }
+
+  return out;
+}
+
+}  // namespace painty
@@ -6,6 +6,7 @@
  */
 #include "painty/image/Convolution.hxx"
 
+#include "painty/image/BilateralGrid.hxx"
 #include "painty/image/EdgeTangentFlow.hxx"
 #include "painty/image/FlowBasedDoG.hxx"
 
@@ -83,12 +84,23 @@ Mat<double> createGaborKernel(double lambda, double theta, double gamma,
 
 auto smoothOABF(const Mat3d& labSource, const Mat1d& mask,
                 const double sigmaSpatial, const double sigmaColor,
-                const double sigmaFlow, const uint32_t nIterations) -> Mat3d {
+                const double sigmaFlow, const uint32_t nIterations,
+                const SmoothingFilter filter) -> Mat3d {
   if ((sigmaColor <= 0.0) || (sigmaSpatial <= 0.0)) {
     return labSource.clone();
   }
-  const auto etf = ComputeEdgeTangentFlow(
-    tensor::ComputeTensors(labSource, mask, 0.0, sigmaFlow));
+  if (filter == SmoothingFilter::BilateralGrid) {
+    auto smoothed = labSource.clone();
+    for (auto i = 0U; i < nIterations; i++) {
+      smoothed =
+        filterBilateralGrid(smoothed, sigmaSpatial, sigmaColor, mask);
+    }
+    return smoothed;
+  }
+  Mat<vec2f> etfFloat;
+  tensor::ComputeTensorsFused(labSource, mask, 0.0, sigmaFlow, &etfFloat);
+  Mat2d etf;
+  etfFloat.convertTo(etf, CV_64FC2);
 
   return FlowBasedDoG::filterBilateralOrientationAligned(
     labSource, etf, sigmaSpatial, sigmaColor, nIterations);
@@ -7,11 +7,14 @@
  *
  *
  */
+#include <algorithm>
 #include <random>
 
 #include "painty/core/Math.hxx"
+#include "painty/core/ThreadPool.hxx"
 #include "painty/image/Convolution.hxx"
 #include "painty/image/EdgeTangentFlow.hxx"
+#include "painty/image/RecursiveGaussian.hxx"
 
 namespace painty {
 namespace tensor {
@@ -73,96 +76,32 @@ Mat3d ComputeTensors(const Mat3d& image, const Mat1d& mask, double innerSigma,
   // inner blur
   if (innerSigma > 0) {
     if (!mask.empty()) {
-      cv::Mat_<double> maskB(mask.size());
-      for (int32_t i = 0; i < (dxTemp.cols * dxTemp.rows); i++) {
-        maskB(i) = mask(i) > 0 ? 1. : 0.;
-        if (mask(i) > 0) {
-          dxTemp(i) = dxTemp(i);
-          dyTemp(i) = dyTemp(i);
-        } else {
-          dxTemp(i) << 0., 0., 0.;
-          dyTemp(i) << 0., 0., 0.;
-        }
-      }
-      cv::GaussianBlur(maskB, maskB, cv::Size(-1, -1), innerSigma, 0.0,
-                       cv::BORDER_REFLECT);
-      cv::GaussianBlur(dxTemp, dxTemp, cv::Size(-1, -1), innerSigma, 0.0,
-                       cv::BORDER_REFLECT);
-      cv::GaussianBlur(dyTemp, dyTemp, cv::Size(-1, -1), innerSigma, 0.0,
-                       cv::BORDER_REFLECT);
-
-      for (int32_t i = 0; i < dxTemp.cols * dxTemp.rows; i++) {
-        const auto allowed = (maskB(i) > 0);
-        dxTemp(i)          = (allowed) ? dxTemp(i) / maskB(i) : dxTemp(i);
-        dyTemp(i)          = (allowed) ? dyTemp(i) / maskB(i) : dyTemp(i);
-      }
+      gaussianBlurMasked(dxTemp, mask, dxTemp, innerSigma);
+      gaussianBlurMasked(dyTemp, mask, dyTemp, innerSigma);
     } else {
-      cv::GaussianBlur(dxTemp, dxTemp, cv::Size(-1, -1), innerSigma, 0.0,
-                       cv::BORDER_REFLECT);
-      cv::GaussianBlur(dyTemp, dyTemp, cv::Size(-1, -1), innerSigma, 0.0,
-                       cv::BORDER_REFLECT);
+      gaussianBlur(dxTemp, dxTemp, innerSigma);
+      gaussianBlur(dyTemp, dyTemp, innerSigma);
     }
   }
 
   // second order tensors
-  cv::Mat_<double> dx2(dxTemp.size());
-  cv::Mat_<double> dy2(dxTemp.size());
-  cv::Mat_<double> dxy(dxTemp.size());
+  Mat3d tensors(dxTemp.size());
   for (int32_t i = 0; i < dxTemp.cols * dxTemp.rows; i++) {
     vec3 g0 = dxTemp(i);
     vec3 g1 = dyTemp(i);
 
-    dx2(i) = g0.dot(g0);
-    dy2(i) = g1.dot(g1);
-    dxy(i) = g0.dot(g1);
+    tensors(i) = {g0.dot(g0), g0.dot(g1), g1.dot(g1)};
   }
 
-  // outer blur
+  // outer blur, all products at once
   if (outerSigma > 0) {
-    const int32_t k_size = -1;
     if (!mask.empty()) {
-      Mat<double> maskB(mask.size());
-      for (int32_t i = 0; i < dxTemp.cols * dxTemp.rows; i++) {
-        maskB(i) = mask(i) > 0 ? 1. : 0.;
-        if (mask(i) > 0) {
-          dx2(i) = dx2(i);
-          dy2(i) = dy2(i);
-          dxy(i) = dxy(i);
-        } else {
-          dx2(i) = 0.0;
-          dy2(i) = 0.0;
-          dxy(i) = 0.0;
-        }
-      }
-      cv::GaussianBlur(maskB, maskB, cv::Size(k_size, k_size), outerSigma, 0.0,
-                       cv::BORDER_REFLECT);
-      cv::GaussianBlur(dx2, dx2, cv::Size(k_size, k_size), outerSigma, 0.0,
-                       cv::BORDER_REFLECT);
-      cv::GaussianBlur(dy2, dy2, cv::Size(k_size, k_size), outerSigma, 0.0,
-                       cv::BORDER_REFLECT);
-      cv::GaussianBlur(dxy, dxy, cv::Size(k_size, k_size), outerSigma, 0.0,
-                       cv::BORDER_REFLECT);
-
-      for (int32_t i = 0; i < (dxTemp.cols * dxTemp.rows); i++) {
-        const auto allowed = (maskB(i) > 0);
-        dx2(i)             = (allowed) ? dx2(i) / maskB(i) : dx2(i);
-        dy2(i)             = (allowed) ? dy2(i) / maskB(i) : dy2(i);
-        dxy(i)             = (allowed) ? dxy(i) / maskB(i) : dxy(i);
-      }
+      gaussianBlurMasked(tensors, mask, tensors, outerSigma);
     } else {
-      cv::GaussianBlur(dx2, dx2, cv::Size(k_size, k_size), outerSigma, 0.0,
-                       cv::BORDER_REFLECT);
-      cv::GaussianBlur(dy2, dy2, cv::Size(k_size, k_size), outerSigma, 0.0,
-                       cv::BORDER_REFLECT);
-      cv::GaussianBlur(dxy, dxy, cv::Size(k_size, k_size), outerSigma, 0.0,
-                       cv::BORDER_REFLECT);
+      gaussianBlur(tensors, tensors, outerSigma);
     }
   }
-  Mat3d tensors(dx2.size());
-  for (auto i = 0U; i < tensors.total(); i++) {
-    const auto index = static_cast<int32_t>(i);
-    tensors(index)   = {dx2(index), dxy(index), dy2(index)};
-  }
+
   // normalize
   double mag = 0.0;
   for (auto i = 0U; i < tensors.total(); i++) {
@@ -180,6 +119,189 @@ Mat3d ComputeTensors(const Mat3d& image, const Mat1d& mask, double innerSigma,
 
   return tensors;
 }
+
+namespace {
+/**
+ * @brief Rows per task of the fused tensor kernels.
+ *
+ */
+constexpr auto TensorRowTileSize = 32;
+
+/**
+ * @brief 3x3 Sobel derivatives of all channels, the borders are handled like
+ * cv::Sobel does.
+ *
+ */
+void Sobel3x3(const Mat3d& image, const int32_t y, const int32_t x, vec3f& dx,
+              vec3f& dy) {
+  auto xm = x - 1;
+  auto xp = x + 1;
+  auto ym = y - 1;
+  auto yp = y + 1;
+  if ((xm < 0) || (xp >= image.cols) || (ym < 0) || (yp >= image.rows)) {
+    xm = cv::borderInterpolate(xm, image.cols, cv::BORDER_REFLECT_101);
+    xp = cv::borderInterpolate(xp, image.cols, cv::BORDER_REFLECT_101);
+    ym = cv::borderInterpolate(ym, image.rows, cv::BORDER_REFLECT_101);
+    yp = cv::borderInterpolate(yp, image.rows, cv::BORDER_REFLECT_101);
+  }
+  const auto& a = image(ym, xm);
+  const auto& b = image(ym, x);
+  const auto& c = image(ym, xp);
+  const auto& d = image(y, xm);
+  const auto& f = image(y, xp);
+  const auto& g = image(yp, xm);
+  const auto& h = image(yp, x);
+  const auto& i = image(yp, xp);
+  dx = ((c + 2.0 * f + i) - (a + 2.0 * d + g)).cast<float>();
+  dy = ((g + 2.0 * h + i) - (a + 2.0 * b + c)).cast<float>();
+}
+
+/**
+ * @brief Run a kernel taking y and x for all pixels on row tiles.
+ *
+ */
+template <class Kernel>
+void ForEachPixel(ThreadPool& pool, const cv::Size& size, Kernel&& kernel) {
+  ParallelFor(pool, 0, size.height, TensorRowTileSize,
+              [&kernel, &size](const int32_t begin, const int32_t end) {
+                for (auto y = begin; y < end; y++) {
+                  for (auto x = 0; x < size.width; x++) {
+                    kernel(y, x);
+                  }
+                }
+              });
+}
+
+/**
+ * @brief Minor eigenvector of a tensor, as in ComputeEdgeTangentFlow().
+ *
+ */
+vec2f TangentOf(const double E, const double F, const double G) {
+  const auto det = std::sqrt((E - G) * (E - G) + 4.0 * F * F);
+  const vec2 v   = {2.0 * F, G - E - det};
+  const auto m   = v.norm();
+  if (!fuzzyCompare(m, 0.0, std::numeric_limits<double>::epsilon() * 1000.0)) {
+    return (v / m).cast<float>();
+  }
+  return {0.0F, 1.0F};
+}
+}  // namespace
+
+Mat<vec4f> ComputeGradientProducts(const Mat3d& image, const Mat1d& mask,
+                                   const double innerSigma,
+                                   const bool maskProducts) {
+  const auto useMask = !mask.empty();
+  const auto isInside = [&mask, useMask](const int32_t y, const int32_t x) {
+    return !useMask || (mask(y, x) > 0.0);
+  };
+  auto& pool = DefaultThreadPool();
+
+  Mat<vec4f> products(image.size());
+  const auto storeProducts = [&products, &isInside, maskProducts](
+                               const int32_t y, const int32_t x,
+                               const vec3f& dx, const vec3f& dy) {
+    const auto w = (!maskProducts || isInside(y, x)) ? 1.0F : 0.0F;
+    products(y, x) = {w * dx.dot(dx), w * dx.dot(dy), w * dy.dot(dy), w};
+  };
+
+  if (innerSigma > 0.0) {
+    Mat<vec3f> dxs(image.size());
+    Mat<vec3f> dys(image.size());
+    Mat1f weights(image.size(), 1.0F);
+    ForEachPixel(pool, image.size(), [&](const int32_t y, const int32_t x) {
+      Sobel3x3(image, y, x, dxs(y, x), dys(y, x));
+      if (!isInside(y, x)) {
+        dxs(y, x)     = vec3f::Zero();
+        dys(y, x)     = vec3f::Zero();
+        weights(y, x) = 0.0F;
+      }
+    });
+    gaussianBlur(dxs, dxs, innerSigma);
+    gaussianBlur(dys, dys, innerSigma);
+    if (useMask) {
+      gaussianBlur(weights, weights, innerSigma);
+    }
+    ForEachPixel(pool, image.size(), [&](const int32_t y, const int32_t x) {
+      const auto w = weights(y, x);
+      if (w > 0.0F) {
+        storeProducts(y, x, dxs(y, x) / w, dys(y, x) / w);
+      } else {
+        storeProducts(y, x, dxs(y, x), dys(y, x));
+      }
+    });
+  } else {
+    ForEachPixel(pool, image.size(), [&](const int32_t y, const int32_t x) {
+      vec3f dx;
+      vec3f dy;
+      Sobel3x3(image, y, x, dx, dy);
+      storeProducts(y, x, dx, dy);
+    });
+  }
+  return products;
+}
+
+Mat<vec3f> NormalizeGradientProducts(const Mat<vec4f>& products,
+                                     const bool maskProducts,
+                                     Mat<vec2f>* etf) {
+  const auto tensorAt = [&products, maskProducts](const int32_t y,
+                                                  const int32_t x) {
+    const auto& p = products(y, x);
+    return (maskProducts && (p[3U] > 0.0F))
+             ? vec3f(p[0U] / p[3U], p[1U] / p[3U], p[2U] / p[3U])
+             : vec3f(p[0U], p[1U], p[2U]);
+  };
+  auto& pool = DefaultThreadPool();
+
+  const auto tiles = static_cast<std::size_t>(
+    (products.rows + TensorRowTileSize - 1) / TensorRowTileSize);
+  std::vector<float> tileMax(tiles, 0.0F);
+  ParallelFor(pool, 0, products.rows, TensorRowTileSize,
+              [&](const int32_t begin, const int32_t end) {
+                auto& mag =
+                  tileMax[static_cast<std::size_t>(begin / TensorRowTileSize)];
+                for (auto y = begin; y < end; y++) {
+                  for (auto x = 0; x < products.cols; x++) {
+                    mag = std::max(mag, tensorAt(y, x).norm());
+                  }
+                }
+              });
+  auto mag = 0.0F;
+  for (const auto m : tileMax) {
+    mag = std::max(mag, m);
+  }
+  const auto scale = (mag > 0.0F) ? (1.0F / mag) : 1.0F;
+
+  Mat<vec3f> tensors(products.size());
+  if (etf != nullptr) {
+    etf->create(products.size());
+  }
+  ForEachPixel(pool, products.size(), [&](const int32_t y, const int32_t x) {
+    const vec3f t = scale * tensorAt(y, x);
+    tensors(y, x) = t;
+    if (etf != nullptr) {
+      (*etf)(y, x) = TangentOf(static_cast<double>(t[0U]),
+                               static_cast<double>(t[1U]),
+                               static_cast<double>(t[2U]));
+    }
+  });
+
+  return tensors;
+}
+
+Mat<vec3f> ComputeTensorsFused(const Mat3d& image, const Mat1d& mask,
+                               const double innerSigma,
+                               const double outerSigma, Mat<vec2f>* etf) {
+  const auto maskProducts = !mask.empty() && (outerSigma > 0.0);
+  auto products =
+    ComputeGradientProducts(image, mask, innerSigma, maskProducts);
+
+  // all channels at once
+  if (outerSigma > 0.0) {
+    gaussianBlur(products, products, outerSigma);
+  }
+
+  return NormalizeGradientProducts(products, maskProducts, etf);
+}
 }  // namespace tensor
 
 /**
@@ -221,96 +343,201 @@ Mat2d ComputeEdgeTangentFlow(const Mat3d& structureTensorField) {  // create etf
   return etf;
 }
 
+namespace {
 /**
- * @brief Visualize vector fields (edge tangent flow) using salt and pepper noise convoluted along the vector field.
+ * @brief Rows of the output each task of the line integral convolution writes
+ * to.
  *
- * @param etf
- * @param sigmaL
- * @return Mat1d
  */
-Mat1d lineIntegralConv(const Mat2d& etf, const double sigmaL) {
-  const int32_t w = etf.cols;
-  const int32_t h = etf.rows;
-  Mat1d out(h, w);
+constexpr auto LicBandHeight = 32;
 
-  const double step = 1.0;
+/**
+ * @brief Fast LIC seeds a new streamline at pixels that have been passed less
+ * often than this.
+ *
+ */
+constexpr auto LicMinHits = 2;
 
-  const auto l = static_cast<int32_t>(
-    2.0 * std::floor(std::sqrt(-std::log(0.1) * 2.0 * (sigmaL * sigmaL))) +
-    1.0);
+/**
+ * @brief Length of the streamlines of Fast LIC relative to the kernel.
+ *
+ */
+constexpr auto LicStreamlineFactor = 8;
 
-  Mat1d noise(h / 4, w / 4);
-  {
-    std::random_device generator;
-    std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    for (size_t i = 0; i < noise.total(); i++) {
-      noise(static_cast<int32_t>(i)) =
-        (distribution(generator) < 0.5) ? 0.0 : 1.0;
-    }
-    cv::resize(noise, noise, etf.size(), 0., 0., cv::INTER_NEAREST);
+/**
+ * @brief Salt and pepper noise in blocks of 4x4 pixels.
+ *
+ */
+Mat1d CreateLicNoise(const cv::Size& size) {
+  Mat1d noise(size.height / 4, size.width / 4);
+  std::random_device generator;
+  std::uniform_real_distribution<double> distribution(0.0, 1.0);
+  for (size_t i = 0; i < noise.total(); i++) {
+    noise(static_cast<int32_t>(i)) =
+      (distribution(generator) < 0.5) ? 0.0 : 1.0;
   }
+  cv::resize(noise, noise, size, 0., 0., cv::INTER_NEAREST);
+  return noise;
+}
 
-  //#pragma omp parallel for
-  for (int32_t y = 0; y < h; y++) {
-    for (int32_t x = 0; x < w; x++) {
-      double c = 0;
-
-      vec2 v0 = etf(y, x);
+/**
+ * @brief Follow the flow in unit steps until the image border or until the
+ * last margin points are outside of the rows [rowBegin, rowEnd). Points
+ * further away do not contribute to the rows.
+ *
+ */
+void TraceUnitSteps(const Mat2d& etf, vec2 p, vec2 v0, const int32_t steps,
+                    const int32_t rowBegin, const int32_t rowEnd,
+                    const int32_t margin, std::vector<vec2>& points) {
+  auto outside = 0;
+  for (int32_t i = 0; (i < steps) && (outside < margin); i++) {
+    vec2 v1 = Interpolate(etf, p, cv::BORDER_REFLECT);
+    if (v1.dot(v0) < 0.0) {
+      v1 *= (-1.0);
+    }
+    p += v1;
+    if (std::isnan(p[0]) || std::isnan(p[1]) || p[0] < 0.0 ||
+        p[0] >= etf.cols || p[1] < 0.0 || p[1] >= etf.rows) {
+      break;
+    }
+    points.push_back(p);
+    v0 = v1;
 
-      vec2 xy_ = {x, y};
-      double g = 0;
+    const auto y = static_cast<int32_t>(p[1]);
+    outside      = ((y >= rowBegin) && (y < rowEnd)) ? 0 : (outside + 1);
+  }
+}
+}  // namespace
 
-      // forward
-      for (int32_t i = 0; i < l / 2; i++) {
-        vec2 v1 = Interpolate(etf, xy_, cv::BORDER_REFLECT);
+/**
+ * @brief Visualize vector fields (edge tangent flow) using salt and pepper noise convoluted along the vector field.
+ *
+ * Implements Fast LIC (Stalling, D., and Hege, H.-C. Fast and resolution independent line integral convolution. SIGGRAPH 1995):
+ * A long streamline is traced from pixels that have not been passed often
+ * enough and the box filtered noise is computed for all of its points with a
+ * running sum. The output is split into bands of rows processed in parallel,
+ * a band only collects the points that fall into it. A streamline is cut once
+ * it left the band for more than the kernel radius L, so it costs the points
+ * inside the band plus up to 2L points per crossing of the band border. The
+ * total cost is about N * (1 + 2L / LicBandHeight) for N pixels and flows
+ * crossing the bands, down from N * L / LicBandHeight of uncut streamlines.
+ *
+ * @param etf
+ * @param sigmaL the box filter has the standard deviation sigmaL.
+ * @return Mat1d
+ */
+Mat1d lineIntegralConv(const Mat2d& etf, const double sigmaL) {
+  const int32_t w = etf.cols;
+  const int32_t h = etf.rows;
 
-        if (v1.dot(v0) < 0.0) {
-          v1 *= (-1.0);
+  const auto noise = CreateLicNoise(etf.size());
+
+  const auto L = std::max(
+    1, static_cast<int32_t>(std::round(std::sqrt(3.0) * sigmaL)));
+  const auto steps = LicStreamlineFactor * L;
+
+  Mat1d sum(h, w, 0.0);
+  Mat1i hits(h, w, 0);
+
+  auto& pool = DefaultThreadPool();
+  ParallelFor(pool, 0, h, LicBandHeight, [&](const int32_t begin,
+                                             const int32_t end) {
+    std::vector<vec2> line;
+    std::vector<vec2> forward;
+    std::vector<double> values;
+    for (int32_t y = begin; y < end; y++) {
+      for (int32_t x = 0; x < w; x++) {
+        if (hits(y, x) >= LicMinHits) {
+          continue;
         }
-
-        xy_[0] += v1[0] * step;
-        xy_[1] += v1[1] * step;
-
-        if (std::isnan(xy_[0]) || std::isnan(xy_[1]) || xy_[0] < 0.0 ||
-            xy_[0] >= w || xy_[1] < 0.0 || xy_[1] >= h) {
-          break;
+        const vec2 seed = {x, y};
+        line.clear();
+        forward.clear();
+        TraceUnitSteps(etf, seed, -1.0 * etf(y, x), steps, begin, end, L,
+                       line);
+        std::reverse(line.begin(), line.end());
+        line.push_back(seed);
+        TraceUnitSteps(etf, seed, etf(y, x), steps, begin, end, L, forward);
+        line.insert(line.end(), forward.cbegin(), forward.cend());
+
+        const auto n = static_cast<int32_t>(line.size());
+        values.resize(line.size());
+        for (int32_t i = 0; i < n; i++) {
+          const auto& p = line[static_cast<size_t>(i)];
+          values[static_cast<size_t>(i)] =
+            noise(static_cast<int32_t>(p[1]), static_cast<int32_t>(p[0]));
         }
 
-        v0 = v1;
-
-        double gw = std::exp(-(i * i) / (2.0 * sigmaL * sigmaL));
-        c += gw *
-             noise(static_cast<int32_t>(xy_[1]), static_cast<int32_t>(xy_[0]));
-        g += gw;
-      }
-      v0  = -1.0 * etf(y, x);
-      xy_ = {x, y};
-      // backward
-      for (int32_t i = 0; i < l / 2; i++) {
-        vec2 v1 = -1.0 * Interpolate(etf, xy_, cv::BORDER_REFLECT);
-
-        if (v1.dot(v0) < 0.0) {
-          v1 *= (-1.0);
+        // running box filter over [i - L, i + L]
+        auto windowSum = 0.0;
+        for (int32_t i = 0; i < std::min(L, n - 1) + 1; i++) {
+          windowSum += values[static_cast<size_t>(i)];
         }
-
-        xy_[0] += v1[0] * step;
-        xy_[1] += v1[1] * step;
-
-        if (std::isnan(xy_[0]) || std::isnan(xy_[1]) || xy_[0] < 0.0 ||
-            xy_[0] >= w || xy_[1] < 0.0 || xy_[1] >= h) {
-          break;
+        for (int32_t i = 0; i < n; i++) {
+          const auto count = std::min(i + L, n - 1) - std::max(i - L, 0) + 1;
+          const auto& p    = line[static_cast<size_t>(i)];
+          const auto px    = static_cast<int32_t>(p[0]);
+          const auto py    = static_cast<int32_t>(p[1]);
+          if ((py >= begin) && (py < end)) {
+            sum(py, px) += windowSum / count;
+            hits(py, px)++;
+          }
+          if ((i + L + 1) < n) {
+            windowSum += values[static_cast<size_t>(i + L + 1)];
+          }
+          if ((i - L) >= 0) {
+            windowSum -= values[static_cast<size_t>(i - L)];
+          }
         }
-
-        v0 = v1;
-
-        double gw = std::exp(-(i * i) / (2.0 * sigmaL * sigmaL));
-        c += gw *
-             noise(static_cast<int32_t>(xy_[1]), static_cast<int32_t>(xy_[0]));
-        g += gw;
       }
-      out(y, x) = (g > 0.0) ? c / g : 0.0;
     }
+  });
+
+  Mat1d out(h, w);
+  for (int32_t i = 0; i < (w * h); i++) {
+    out(i) = (hits(i) > 0) ? sum(i) / hits(i) : 0.0;
   }
+  return out;
+}
+
+Mat1d lineIntegralConv(const StreamlineCache& streamlines,
+                       const double sigmaL) {
+  const int32_t w = streamlines.getSize().width;
+  const int32_t h = streamlines.getSize().height;
+  Mat1d out(h, w);
+
+  const auto noise = CreateLicNoise(out.size());
+
+  auto& pool = DefaultThreadPool();
+  ParallelFor(
+    pool, 0, h, LicBandHeight, [&](const int32_t begin, const int32_t end) {
+      for (int32_t y = begin; y < end; y++) {
+        for (int32_t x = 0; x < w; x++) {
+          double c = 0;
+          double g = 0;
+          for (const auto direction : {StreamlineCache::Direction::Forward,
+                                       StreamlineCache::Direction::Backward}) {
+            const auto samples = streamlines.getSamples(y, x, direction);
+            auto arcLength     = 0.0;
+            for (auto s = samples.first; s != samples.second; s++) {
+              if ((s->x < 0.0F) || (s->x >= static_cast<float>(w)) ||
+                  (s->y < 0.0F) || (s->y >= static_cast<float>(h))) {
+                break;
+              }
+              const auto dw = static_cast<double>(s->arcLength) - arcLength;
+              arcLength     = static_cast<double>(s->arcLength);
+
+              const auto gw = dw * std::exp(-(arcLength * arcLength) /
+                                            (2.0 * sigmaL * sigmaL));
+              c += gw * noise(static_cast<int32_t>(s->y),
+                              static_cast<int32_t>(s->x));
+              g += gw;
+            }
+          }
+          out(y, x) = (g > 0.0) ? c / g : 0.0;
+        }
+      }
+    });
 
   return out;
 }
@@ -7,22 +7,120 @@
  */
 #include "painty/image/FlowBasedDoG.hxx"
 
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "painty/core/ThreadPool.hxx"
 #include "painty/image/EdgeTangentFlow.hxx"
 
 namespace painty {
 
 namespace detail {
-static void run_oabf(uint32_t pass, const Mat3d& sourceLab, Mat3d& target,
-                     const Mat2d& tfm, const double sigma_d,
-                     const double sigma_r) {
-  const auto w = sourceLab.cols;
-  const auto h = sourceLab.rows;
 
-  for (auto y = 0; y < h; y++) {
+/**
+ * @brief Rows per task when distributing the filters over the thread pool.
+ *
+ */
+constexpr auto RowTileSize = 16;
+
+/**
+ * @brief Table of the range kernel exp(-e^2 / (2 sigma_r^2)) indexed by the
+ * squared color distance e^2, linearly interpolated.
+ *
+ */
+class RangeKernelLut {
+ public:
+  explicit RangeKernelLut(const double sigma_r)
+      : _scale(static_cast<float>(Resolution / (2.0 * sigma_r * sigma_r))),
+        _table(Size + 2U) {
+    for (auto i = 0U; i < _table.size(); i++) {
+      _table[i] = static_cast<float>(std::exp(-static_cast<double>(i) /
+                                              Resolution));
+    }
+  }
+
+  float operator()(const float e2) const {
+    const auto x = e2 * _scale;
+    if (!(x < static_cast<float>(Size))) {
+      return 0.0F;
+    }
+    const auto i = static_cast<uint32_t>(x);
+    const auto a = x - static_cast<float>(i);
+    return _table[i] + a * (_table[i + 1U] - _table[i]);
+  }
+
+ private:
+  /**
+   * @brief Table entries per unit of the exponent.
+   *
+   */
+  static constexpr auto Resolution = 256.0;
+
+  /**
+   * @brief Covers exponents up to 16, the kernel is below 1e-6 beyond.
+   *
+   */
+  static constexpr auto Size = 16U * 256U;
+
+  float _scale = 0.0F;
+  std::vector<float> _table;
+};
+
+/**
+ * @brief Bilinear lookup with reflected borders, equal to Interpolate().
+ *
+ */
+static inline void SampleBilinear(const Mat<vec3f>& image, const float px,
+                                  const float py, float* out) {
+  const auto x = static_cast<int32_t>(std::floor(px));
+  const auto y = static_cast<int32_t>(std::floor(py));
+  const auto a = px - static_cast<float>(x);
+  const auto c = py - static_cast<float>(y);
+
+  auto x0 = x;
+  auto x1 = x + 1;
+  auto y0 = y;
+  auto y1 = y + 1;
+  if ((x0 < 0) || (x1 >= image.cols) || (y0 < 0) || (y1 >= image.rows)) {
+    x0 = cv::borderInterpolate(x0, image.cols, cv::BORDER_REFLECT);
+    x1 = cv::borderInterpolate(x1, image.cols, cv::BORDER_REFLECT);
+    y0 = cv::borderInterpolate(y0, image.rows, cv::BORDER_REFLECT);
+    y1 = cv::borderInterpolate(y1, image.rows, cv::BORDER_REFLECT);
+  }
+  const auto* r0  = image.ptr<float>(y0);
+  const auto* r1  = image.ptr<float>(y1);
+  const auto* p00 = r0 + 3 * x0;
+  const auto* p01 = r0 + 3 * x1;
+  const auto* p10 = r1 + 3 * x0;
+  const auto* p11 = r1 + 3 * x1;
+  for (auto i = 0; i < 3; i++) {
+    out[i] = (p00[i] * (1.0F - a) + p01[i] * a) * (1.0F - c) +
+             (p10[i] * (1.0F - a) + p11[i] * a) * c;
+  }
+}
+
+/**
+ * @brief One pass of the orientation aligned bilateral filter for the rows
+ * [rowBegin, rowEnd), across the flow for pass 0 and along it for pass 1.
+ *
+ * @param spatial the spatial kernel for the tap distances 0..2 sigma_d.
+ * @param range the range kernel.
+ */
+static void run_oabf(const uint32_t pass, const Mat<vec3f>& sourceLab,
+                     Mat<vec3f>& target, const Mat2d& tfm,
+                     const double sigma_d, const std::vector<float>& spatial,
+                     const RangeKernelLut& range, const int32_t rowBegin,
+                     const int32_t rowEnd) {
+  const auto w       = sourceLab.cols;
+  const auto maxTaps = static_cast<int32_t>(spatial.size()) - 1;
+
+  for (auto y = rowBegin; y < rowEnd; y++) {
+    const auto* src = sourceLab.ptr<float>(y);
+    auto* dst       = target.ptr<float>(y);
     for (auto x = 0; x < w; x++) {
-      const vec2 uv(x, y);
-      const auto tangent = Interpolate(tfm, uv);
-      auto t = (pass == 0) ? vec2(tangent[1U], -tangent[0U]) : tangent;
+      const auto& tangent = tfm(y, x);
+      auto t = (pass == 0U) ? vec2(tangent[1U], -tangent[0U]) : tangent;
 
       if (std::abs(t[0U]) >= std::abs(t[1U])) {
         t[1U] = t[1U] / t[0U];
@@ -32,63 +130,62 @@ static void run_oabf(uint32_t pass, const Mat3d& sourceLab, Mat3d& target,
         t[1U] = 1.0;
       }
 
-      const auto center = Interpolate(sourceLab, uv);
-
-      auto sum = center;
-
-      double norm      = 1.0;
-      double halfWidth = (2.0 * sigma_d) / sqrt(t[0U] * t[0U] + t[1U] * t[1U]);
-
-      for (auto d = 1; d <= halfWidth; d++) {
-        const double uxn = uv[0U] + d * t[0U];
-        const double uyn = uv[1U] + d * t[1U];
-        const double uxp = uv[0U] - d * t[0U];
-        const double uyp = uv[1U] - d * t[1U];
-
-        const auto c0 = Interpolate(sourceLab, {uxn, uyn});
-        const auto c1 = Interpolate(sourceLab, {uxp, uyp});
-
-        const auto e0 = std::sqrt(std::pow(c0[0U] - center[0U], 2.0) +
-                                  std::pow(c0[1U] - center[1U], 2.0) +
-                                  std::pow(c0[2U] - center[2U], 2.0));
-        const auto e1 = std::sqrt(std::pow(c1[0U] - center[0U], 2.0) +
-                                  std::pow(c1[1U] - center[1U], 2.0) +
-                                  std::pow(c1[2U] - center[2U], 2.0));
-
-        const auto kerneld  = exp(-(d * d) / (2.0 * sigma_d * sigma_d));
-        const auto kernele0 = exp(-(e0 * e0) / (2.0 * sigma_r * sigma_r));
-        const auto kernele1 = exp(-(e1 * e1) / (2.0 * sigma_r * sigma_r));
-
-        norm += kerneld * kernele0;
-        norm += kerneld * kernele1;
-
-        sum[0U] += kerneld * kernele0 * c0[0U];
-        sum[1U] += kerneld * kernele0 * c0[1U];
-        sum[2U] += kerneld * kernele0 * c0[2U];
-
-        sum[0U] += kerneld * kernele1 * c1[0U];
-        sum[1U] += kerneld * kernele1 * c1[1U];
-        sum[2U] += kerneld * kernele1 * c1[2U];
+      const auto halfWidth =
+        (2.0 * sigma_d) / std::sqrt(t[0U] * t[0U] + t[1U] * t[1U]);
+      // degenerated flow leaves the pixel as it is
+      const auto taps = std::isfinite(halfWidth)
+                          ? std::min(static_cast<int32_t>(halfWidth), maxTaps)
+                          : 0;
+
+      const auto tx = static_cast<float>(t[0U]);
+      const auto ty = static_cast<float>(t[1U]);
+      const auto fx = static_cast<float>(x);
+      const auto fy = static_cast<float>(y);
+
+      const float center[3] = {src[3 * x], src[3 * x + 1], src[3 * x + 2]};
+      float sum[3]          = {center[0], center[1], center[2]};
+      auto norm             = 1.0F;
+
+      for (auto d = 1; d <= taps; d++) {
+        const auto fd = static_cast<float>(d);
+
+        float c0[3];
+        float c1[3];
+        SampleBilinear(sourceLab, fx + fd * tx, fy + fd * ty, c0);
+        SampleBilinear(sourceLab, fx - fd * tx, fy - fd * ty, c1);
+
+        auto e0 = 0.0F;
+        auto e1 = 0.0F;
+        for (auto i = 0; i < 3; i++) {
+          e0 += (c0[i] - center[i]) * (c0[i] - center[i]);
+          e1 += (c1[i] - center[i]) * (c1[i] - center[i]);
+        }
+
+        const auto k0 = spatial[static_cast<std::size_t>(d)] * range(e0);
+        const auto k1 = spatial[static_cast<std::size_t>(d)] * range(e1);
+        norm += k0 + k1;
+        for (auto i = 0; i < 3; i++) {
+          sum[i] += k0 * c0[i] + k1 * c1[i];
+        }
+      }
+      for (auto i = 0; i < 3; i++) {
+        dst[3 * x + i] = sum[i] / norm;
       }
-      sum[0U] /= norm;
-      sum[1U] /= norm;
-      sum[2U] /= norm;
-
-      target(y, x) = sum;
     }
   }
 }
 
 static void fdogAlongGradient(const Mat1d& img, Mat1d& dst, const Mat2d& tfm,
                               const double sigma_e, const double sigma_r,
-                              const double tau) {
+                              const double tau, const int32_t rowBegin,
+                              const int32_t rowEnd) {
   const auto twoSigmaESquared = 2.0 * sigma_e * sigma_e;
   const auto twoSigmaRSquared = 2.0 * sigma_r * sigma_r;
 
   const auto w = img.cols;
   const auto h = img.rows;
 
-  for (auto y = 0; y < h; y++) {
+  for (auto y = rowBegin; y < rowEnd; y++) {
     for (auto x = 0; x < w; x++) {
       const vec2 uv = {x, y};
       const auto t  = tfm(clamp(static_cast<int32_t>(round(uv[1U])), 0, h - 1),
@@ -140,88 +237,72 @@ static void fdogAlongGradient(const Mat1d& img, Mat1d& dst, const Mat2d& tfm,
 }  // namespace detail
 
 void FlowBasedDoG::smoothAlongFlow(const Mat1d& img, Mat1d& dst,
-                                   const Mat2d& tfm, const double sigma_m) {
-  struct lic_t {
-    vec2 p    = {0.0, 0.0};
-    vec2 t    = {0.0, 0.0};
-    double w  = 0.0;
-    double dw = 0.0;
-  };
-  const auto sign = [](double x) {
-    return (x <= 0.0) ? -1.0 : 1.0;
-  };
-
-  const auto step = [sign, &tfm](lic_t& s) {
-    auto t = Interpolate(tfm, {s.p[0U], s.p[1U]});
-    if (t.dot(s.t) < 0.0) {
-      t *= -1.0;
-    }
-    s.t[0U] = t[0U];
-    s.t[1U] = t[1U];
-
-    s.dw = (std::fabs(t[0U]) >= std::fabs(t[1U]))
-             ? std::fabs(((s.p[0U] - std::floor(s.p[0U])) - 0.5 - sign(t[0U])) /
-                         t[0U])
-             : std::fabs(((s.p[1U] - std::floor(s.p[1U])) - 0.5 - sign(t[1U])) /
-                         t[1U]);
-
-    s.p[0U] += t[0U] * s.dw;
-    s.p[1U] += t[1U] * s.dw;
-    s.w += s.dw;
-  };
-
+                                   const StreamlineCache& streamlines,
+                                   const double sigma_m) {
   const double twoSigmaMSquared = 2.0 * sigma_m * sigma_m;
   const double halfWidth        = 2.0 * sigma_m;
-  const auto w                  = img.cols;
-  const auto h                  = img.rows;
+  if (halfWidth > streamlines.getLength()) {
+    throw std::invalid_argument("Streamlines are too short for sigma_m");
+  }
+  if (streamlines.getSize() != img.size()) {
+    throw std::invalid_argument("Streamlines do not match the image size");
+  }
+  if (dst.size() != img.size()) {
+    dst = Mat1d(img.size());
+  }
 
-  for (auto y = 0; y < h; y++) {
-    for (auto x = 0; x < w; x++) {
-      const vec2 uv = {x, y};
-      double wg     = 1.0;
-      double H      = img(y, x);
-
-      lic_t a;
-      lic_t b;
-      a.p[0U] = b.p[0U] = uv[0U];
-      a.p[1U] = b.p[1U] = uv[1U];
-      a.t               = tfm(y, x);
-      b.t               = -tfm(y, x);
-      a.w = b.w = 0.0;
-
-      while (a.w < halfWidth) {
-        step(a);
-        double k = a.dw * exp(-a.w * a.w / twoSigmaMSquared);
-        H += k * Interpolate(img, {a.p[0U], a.p[1U]});
-        wg += k;
-      }
-      while (b.w < halfWidth) {
-        step(b);
-        double k = b.dw * exp(-b.w * b.w / twoSigmaMSquared);
-        H += k * Interpolate(img, {b.p[0U], b.p[1U]});
-        wg += k;
+  auto& pool = DefaultThreadPool();
+  ParallelFor(
+    pool, 0, img.rows, detail::RowTileSize,
+    [&](const int32_t begin, const int32_t end) {
+      for (auto y = begin; y < end; y++) {
+        for (auto x = 0; x < img.cols; x++) {
+          double wg = 1.0;
+          double H  = img(y, x);
+
+          for (const auto direction : {StreamlineCache::Direction::Forward,
+                                       StreamlineCache::Direction::Backward}) {
+            const auto samples = streamlines.getSamples(y, x, direction);
+            auto w             = 0.0;
+            for (auto s = samples.first; (s != samples.second) &&
+                                         (w < halfWidth);
+                 s++) {
+              const auto dw = static_cast<double>(s->arcLength) - w;
+              w             = static_cast<double>(s->arcLength);
+
+              const auto k = dw * std::exp(-w * w / twoSigmaMSquared);
+              H += k * Interpolate(img, vec2(static_cast<double>(s->x),
+                                             static_cast<double>(s->y)));
+              wg += k;
+            }
+          }
+
+          dst(y, x) = H / wg;
+        }
       }
-      H /= wg;
-
-      dst(y, x) = H;
-    }
-  }
+    });
 }
 
 Mat3d FlowBasedDoG::execute(const Mat3d& rgbLinear) const {
   const auto Lab =
     convertColor(rgbLinear, ColorConverter<double>::Conversion::rgb_2_CIELab);
-  const auto etf = ComputeEdgeTangentFlow(
-    tensor::ComputeTensors(Lab, Mat1d(), 0.0, _tensorOuterSigma));
+  Mat<vec2f> etfFloat;
+  tensor::ComputeTensorsFused(Lab, Mat1d(), 0.0, _tensorOuterSigma, &etfFloat);
+  Mat2d etf;
+  etfFloat.convertTo(etf, CV_64FC2);
 
   const auto oabf = filterBilateralOrientationAligned(
     Lab, etf, _oabfSigma_d, _oabfSigma_r, _oabfIterations);
 
+  // the streamlines of the flow, traced once for all filters along it
+  const StreamlineCache streamlines(etf, 2.0 * _xdogParamSmoothingSigma);
+
   std::vector<Mat1d> channels;
   cv::split(oabf, channels);
   const auto dogResponse = filterFlowBasedDoG(
-    channels.front(), etf, _xdogParamSigma, _xdogParamKappa * _xdogParamSigma,
-    _xdogParamTau, _xdogParamSmoothingSigma);
+    channels.front(), etf, streamlines, _xdogParamSigma,
+    _xdogParamKappa * _xdogParamSigma, _xdogParamTau,
+    _xdogParamSmoothingSigma);
 
   const auto xdog = thresholdingXDoG(dogResponse, _xdogParamEps, _xdogParamPhi);
 
@@ -233,15 +314,39 @@ Mat3d FlowBasedDoG::execute(const Mat3d& rgbLinear) const {
 Mat3d FlowBasedDoG::filterBilateralOrientationAligned(
   const Mat3d& imageInLab, const Mat2d& edgeTangentFlow, const double sigma_d,
   const double sigma_r, const uint32_t n) {
-  Mat3d t0(imageInLab.size());
-  auto t1 = imageInLab.clone();
+  if (n == 0U) {
+    return imageInLab.clone();
+  }
+
+  Mat<vec3f> t0(imageInLab.size());
+  Mat<vec3f> t1;
+  imageInLab.convertTo(t1, CV_32FC3);
 
+  std::vector<float> spatial(static_cast<std::size_t>(2.0 * sigma_d) + 1UL);
+  for (auto d = 0UL; d < spatial.size(); d++) {
+    const auto fd = static_cast<double>(d);
+    spatial[d] = static_cast<float>(std::exp(-(fd * fd) /
+                                             (2.0 * sigma_d * sigma_d)));
+  }
+  const detail::RangeKernelLut range(sigma_r);
+
+  auto& pool = DefaultThreadPool();
   for (auto i = 0U; i < n; i++) {
-    detail::run_oabf(0U, t1, t0, edgeTangentFlow, sigma_d, sigma_r);
-    detail::run_oabf(1U, t0, t1, edgeTangentFlow, sigma_d, sigma_r);
+    ParallelFor(pool, 0, t0.rows, detail::RowTileSize,
+                [&](const int32_t begin, const int32_t end) {
+                  detail::run_oabf(0U, t1, t0, edgeTangentFlow, sigma_d,
+                                   spatial, range, begin, end);
+                });
+    ParallelFor(pool, 0, t0.rows, detail::RowTileSize,
+                [&](const int32_t begin, const int32_t end) {
+                  detail::run_oabf(1U, t0, t1, edgeTangentFlow, sigma_d,
+                                   spatial, range, begin, end);
+                });
   }
 
-  return t1;
+  Mat3d result;
+  t1.convertTo(result, CV_64FC3);
+  return result;
 }
 
 Mat3d FlowBasedDoG::quantizeColors(const Mat3d& imageInLab, const double phi_q,
@@ -277,17 +382,25 @@ Mat1d FlowBasedDoG::thresholdingXDoG(const Mat1d& response,
 }
 
 Mat1d FlowBasedDoG::filterFlowBasedDoG(const Mat1d& img, const Mat2d& tfm,
+                                       const StreamlineCache& streamlines,
                                        const double sigma_e,
                                        const double sigma_r, const double tau,
                                        const double sigmaSmoothing) {
   Mat1d out(img.rows, img.cols);
 
   // compute DoG
-  detail::fdogAlongGradient(img, out, tfm, sigma_e, sigma_r, tau);
+  {
+    auto& pool = DefaultThreadPool();
+    ParallelFor(pool, 0, img.rows, detail::RowTileSize,
+                [&](const int32_t begin, const int32_t end) {
+                  detail::fdogAlongGradient(img, out, tfm, sigma_e, sigma_r,
+                                            tau, begin, end);
+                });
+  }
 
   // smooth along etf
   Mat1d outSmooth(img.rows, img.cols);
-  smoothAlongFlow(out, outSmooth, tfm, sigmaSmoothing);
+  smoothAlongFlow(out, outSmooth, streamlines, sigmaSmoothing);
 
   return outSmooth;
 }
@@ -0,0 +1,215 @@
+/**
+ * @file RecursiveGaussian.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ *
+ * @date 2020-11-19
+ *
+ */
+#include "painty/image/RecursiveGaussian.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "painty/core/ThreadPool.hxx"
+
+namespace painty {
+
+namespace {
+/**
+ * @brief Rows per task of the horizontal pass.
+ *
+ */
+constexpr auto RowTileSize = 16;
+
+/**
+ * @brief Values of a row per task of the vertical pass, which runs on whole
+ * rows to stay cache friendly.
+ *
+ */
+constexpr auto ColumnTileSize = 512;
+
+/**
+ * @brief Feedback coefficients divided by b0, B is the gain of the input.
+ *
+ */
+struct Coefficients {
+  double B  = 0.0;
+  double b1 = 0.0;
+  double b2 = 0.0;
+  double b3 = 0.0;
+};
+
+auto ComputeCoefficients(const double sigma) -> Coefficients {
+  const auto q  = (sigma >= 2.5)
+                    ? (0.98711 * sigma - 0.96330)
+                    : (3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma));
+  const auto q2 = q * q;
+  const auto q3 = q2 * q;
+  const auto b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+
+  Coefficients c;
+  c.b1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+  c.b2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+  c.b3 = (0.422205 * q3) / b0;
+  c.B  = 1.0 - (c.b1 + c.b2 + c.b3);
+  return c;
+}
+
+/**
+ * @brief Filter n values with the given stride in place. The filter has a gain
+ * of one, so the first output of each direction equals its input and serves as
+ * the replicated border.
+ *
+ */
+void FilterLine(double* data, const int32_t n, const int32_t stride,
+                const Coefficients& c) {
+  auto w1 = data[0];
+  auto w2 = w1;
+  auto w3 = w1;
+  for (auto i = 1; i < n; i++) {
+    auto& v = data[i * stride];
+    v       = c.B * v + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+    w3      = w2;
+    w2      = w1;
+    w1      = v;
+  }
+  w2 = w1;
+  w3 = w1;
+  for (auto i = n - 2; i >= 0; i--) {
+    auto& v = data[i * stride];
+    v       = c.B * v + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+    w3      = w2;
+    w2      = w1;
+    w1      = v;
+  }
+}
+
+/**
+ * @brief Filter the values [begin, end) of all rows along the columns in
+ * place, row by row.
+ *
+ */
+void FilterColumns(cv::Mat& buffer, const int32_t begin, const int32_t end,
+                   const Coefficients& c) {
+  const auto last = buffer.rows - 1;
+  for (auto y = 1; y <= last; y++) {
+    auto* v        = buffer.ptr<double>(y);
+    const auto* w1 = buffer.ptr<double>(y - 1);
+    const auto* w2 = buffer.ptr<double>(std::max(y - 2, 0));
+    const auto* w3 = buffer.ptr<double>(std::max(y - 3, 0));
+    for (auto i = begin; i < end; i++) {
+      v[i] = c.B * v[i] + c.b1 * w1[i] + c.b2 * w2[i] + c.b3 * w3[i];
+    }
+  }
+  for (auto y = last - 1; y >= 0; y--) {
+    auto* v        = buffer.ptr<double>(y);
+    const auto* w1 = buffer.ptr<double>(y + 1);
+    const auto* w2 = buffer.ptr<double>(std::min(y + 2, last));
+    const auto* w3 = buffer.ptr<double>(std::min(y + 3, last));
+    for (auto i = begin; i < end; i++) {
+      v[i] = c.B * v[i] + c.b1 * w1[i] + c.b2 * w2[i] + c.b3 * w3[i];
+    }
+  }
+}
+
+auto IsFloatingPoint(const cv::Mat& image) -> bool {
+  return (image.depth() == CV_32F) || (image.depth() == CV_64F);
+}
+}  // namespace
+
+void recursiveGaussianBlur(cv::InputArray src, cv::OutputArray dst,
+                           const double sigma) {
+  const auto input = src.getMat();
+  if (!IsFloatingPoint(input)) {
+    throw std::invalid_argument(
+      "recursiveGaussianBlur: only float and double images are supported");
+  }
+  if (sigma < 0.5) {
+    throw std::invalid_argument("recursiveGaussianBlur: sigma must be >= 0.5");
+  }
+  if (input.empty()) {
+    dst.release();
+    return;
+  }
+
+  const auto c        = ComputeCoefficients(sigma);
+  const auto channels = input.channels();
+  cv::Mat buffer;
+  input.convertTo(buffer, CV_64F);
+
+  auto& pool = DefaultThreadPool();
+  ParallelFor(pool, 0, buffer.rows, RowTileSize,
+              [&buffer, &c, channels](const int32_t begin, const int32_t end) {
+                for (auto y = begin; y < end; y++) {
+                  auto* row = buffer.ptr<double>(y);
+                  for (auto k = 0; k < channels; k++) {
+                    FilterLine(row + k, buffer.cols, channels, c);
+                  }
+                }
+              });
+  ParallelFor(pool, 0, buffer.cols * channels, ColumnTileSize,
+              [&buffer, &c](const int32_t begin, const int32_t end) {
+                FilterColumns(buffer, begin, end, c);
+              });
+
+  buffer.convertTo(dst, input.depth());
+}
+
+void gaussianBlur(cv::InputArray src, cv::OutputArray dst, const double sigma,
+                  const int borderType) {
+  if (!(sigma > 0.0)) {
+    src.copyTo(dst);
+  } else if ((sigma >= RecursiveGaussianMinSigma) &&
+             IsFloatingPoint(src.getMat())) {
+    recursiveGaussianBlur(src, dst, sigma);
+  } else {
+    cv::GaussianBlur(src, dst, cv::Size(-1, -1), sigma, 0.0, borderType);
+  }
+}
+
+void gaussianBlurMasked(cv::InputArray src, const Mat1d& mask,
+                        cv::OutputArray dst, const double sigma,
+                        const int borderType) {
+  const auto input = src.getMat();
+  if (!IsFloatingPoint(input)) {
+    throw std::invalid_argument(
+      "gaussianBlurMasked: only float and double images are supported");
+  }
+  if (mask.size() != input.size()) {
+    throw std::invalid_argument(
+      "gaussianBlurMasked: the mask must have the size of the image");
+  }
+
+  const auto channels = input.channels();
+  cv::Mat weighted;
+  input.convertTo(weighted, CV_64F);
+  Mat1d weights(mask.size());
+  for (auto y = 0; y < weighted.rows; y++) {
+    auto* row = weighted.ptr<double>(y);
+    for (auto x = 0; x < weighted.cols; x++) {
+      const auto w  = (mask(y, x) > 0.0) ? 1.0 : 0.0;
+      weights(y, x) = w;
+      for (auto k = 0; k < channels; k++) {
+        row[x * channels + k] *= w;
+      }
+    }
+  }
+
+  gaussianBlur(weighted, weighted, sigma, borderType);
+  gaussianBlur(weights, weights, sigma, borderType);
+
+  for (auto y = 0; y < weighted.rows; y++) {
+    auto* row = weighted.ptr<double>(y);
+    for (auto x = 0; x < weighted.cols; x++) {
+      const auto w = weights(y, x);
+      for (auto k = 0; k < channels; k++) {
+        row[x * channels + k] = (w > 0.0) ? (row[x * channels + k] / w) : 0.0;
+      }
+    }
+  }
+  weighted.convertTo(dst, input.depth());
+}
+
+}  // namespace painty
@@ -0,0 +1,134 @@
+/**
+ * @file RegionStatistics.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ *
+ * @date 2020-11-24
+ *
+ */
+#include "painty/image/RegionStatistics.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#include "painty/core/ThreadPool.hxx"
+
+namespace painty {
+
+RegionStatistics::RegionStatistics(const Mat1i& labels,
+                                   const int32_t labelCount,
+                                   const std::vector<cv::Mat>& images,
+                                   const int32_t bandCount)
+    : _labelCount(std::max(labelCount, 0)) {
+  for (const auto& image : images) {
+    if ((image.depth() != CV_64F) || (image.size() != labels.size())) {
+      throw std::invalid_argument(
+        "RegionStatistics needs double images of the size of the labels");
+    }
+    _offsets.push_back(_stride);
+    _channels.push_back(image.channels());
+    _stride += image.channels();
+  }
+  const auto labelsSize = static_cast<size_t>(_labelCount);
+  const auto stride     = static_cast<size_t>(_stride);
+  _counts               = std::vector<size_t>(labelsSize, 0UL);
+  _sums                 = std::vector<double>(labelsSize * stride, 0.0);
+  _squares              = std::vector<double>(labelsSize * stride, 0.0);
+
+  // partial sums per band of rows, added up in band order afterwards
+  struct Band {
+    std::vector<size_t> counts;
+    std::vector<double> sums;
+    std::vector<double> squares;
+  };
+  const auto threads = static_cast<int32_t>(
+    std::max(std::thread::hardware_concurrency(), 1U));
+  const auto rowBands = (bandCount > 0) ? bandCount : threads;
+  const auto bandSize = std::max((labels.rows + rowBands - 1) / rowBands, 1);
+  std::vector<Band> bands(
+    static_cast<size_t>((labels.rows + bandSize - 1) / bandSize));
+  auto& pool = DefaultThreadPool();
+  ParallelFor(
+    pool, 0, labels.rows, bandSize,
+    [&](const int32_t begin, const int32_t end) {
+      auto& band = bands[static_cast<size_t>(begin / bandSize)];
+      band.counts.resize(labelsSize, 0UL);
+      band.sums.resize(labelsSize * stride, 0.0);
+      band.squares.resize(labelsSize * stride, 0.0);
+      for (auto y = begin; y < end; y++) {
+        const auto* labelsRow = labels.ptr<int32_t>(y);
+        for (auto x = 0; x < labels.cols; x++) {
+          const auto label = labelsRow[x];
+          if ((label < 0) || (label >= _labelCount)) {
+            continue;
+          }
+          band.counts[static_cast<size_t>(label)]++;
+          for (size_t i = 0; i < images.size(); i++) {
+            const auto channels = _channels[i];
+            const auto* pixel   = images[i].ptr<double>(y) + x * channels;
+            const auto first    = index(i, label, 0);
+            for (auto c = 0; c < channels; c++) {
+              const auto k = first + static_cast<size_t>(c);
+              band.sums[k] += pixel[c];
+              band.squares[k] += pixel[c] * pixel[c];
+            }
+          }
+        }
+      }
+    });
+  for (const auto& band : bands) {
+    for (size_t k = 0; k < band.counts.size(); k++) {
+      _counts[k] += band.counts[k];
+    }
+    for (size_t k = 0; k < band.sums.size(); k++) {
+      _sums[k] += band.sums[k];
+      _squares[k] += band.squares[k];
+    }
+  }
+}
+
+auto RegionStatistics::labelCount() const -> int32_t {
+  return _labelCount;
+}
+
+auto RegionStatistics::index(const size_t image, const int32_t label,
+                             const int32_t channel) const -> size_t {
+  return static_cast<size_t>(label * _stride + _offsets[image] + channel);
+}
+
+auto RegionStatistics::count(const int32_t label) const -> size_t {
+  return _counts[static_cast<size_t>(label)];
+}
+
+auto RegionStatistics::sum(const size_t image, const int32_t label,
+                           const int32_t channel) const -> double {
+  return _sums[index(image, label, channel)];
+}
+
+auto RegionStatistics::mean(const size_t image, const int32_t label,
+                            const int32_t channel) const -> double {
+  const auto n = count(label);
+  return (n == 0UL) ? 0.0
+                    : (sum(image, label, channel) / static_cast<double>(n));
+}
+
+auto RegionStatistics::sumOfSquares(const size_t image,
+                                    const int32_t label) const -> double {
+  auto s = 0.0;
+  for (auto c = 0; c < _channels[image]; c++) {
+    s += _squares[index(image, label, c)];
+  }
+  return s;
+}
+
+auto RegionStatistics::rms(const size_t image, const int32_t label) const
+  -> double {
+  const auto n = count(label);
+  return (n == 0UL) ? 0.0
+                    : std::sqrt(sumOfSquares(image, label) /
+                                static_cast<double>(n));
+}
+
+}  // namespace painty
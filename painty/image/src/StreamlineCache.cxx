@@ -0,0 +1,110 @@
+/**
+ * @file StreamlineCache.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ *
+ * @date 2020-11-17
+ *
+ */
+#include "painty/image/StreamlineCache.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "painty/core/ThreadPool.hxx"
+
+namespace painty {
+
+namespace {
+/**
+ * @brief Rows per task when tracing the streamlines.
+ *
+ */
+constexpr auto RowTileSize = 16;
+
+void Trace(const Mat2d& etf, vec2 p, vec2 t, const double length,
+           std::vector<StreamlineCache::Sample>& samples) {
+  const auto sign = [](const double x) {
+    return (x <= 0.0) ? -1.0 : 1.0;
+  };
+
+  auto w = 0.0;
+  while (w < length) {
+    auto next = Interpolate(etf, p);
+    if (next.dot(t) < 0.0) {
+      next *= -1.0;
+    }
+    t = next;
+
+    // step to the border of the current cell
+    const auto dw =
+      (std::fabs(t[0U]) >= std::fabs(t[1U]))
+        ? std::fabs(((p[0U] - std::floor(p[0U])) - 0.5 - sign(t[0U])) / t[0U])
+        : std::fabs(((p[1U] - std::floor(p[1U])) - 0.5 - sign(t[1U])) / t[1U]);
+    if (!std::isfinite(dw)) {
+      break;
+    }
+    p += t * dw;
+    w += dw;
+    samples.push_back({static_cast<float>(p[0U]), static_cast<float>(p[1U]),
+                       static_cast<float>(w)});
+  }
+}
+}  // namespace
+
+StreamlineCache::StreamlineCache(const Mat2d& etf, const double length)
+    : _length(length),
+      _size(etf.size()),
+      _offsets(2UL * etf.total() + 1UL, 0UL),
+      _samples() {
+  const auto tileCount =
+    static_cast<std::size_t>((etf.rows + RowTileSize - 1) / RowTileSize);
+  std::vector<std::vector<Sample>> tileSamples(tileCount);
+
+  // count the samples of each pixel and direction, stored one entry ahead
+  auto& pool = DefaultThreadPool();
+  ParallelFor(pool, 0, etf.rows, RowTileSize,
+              [&](const int32_t begin, const int32_t end) {
+                auto& samples =
+                  tileSamples[static_cast<std::size_t>(begin / RowTileSize)];
+                for (auto y = begin; y < end; y++) {
+                  for (auto x = 0; x < etf.cols; x++) {
+                    const auto i =
+                      2UL * static_cast<std::size_t>(y * etf.cols + x);
+                    const vec2 p(x, y);
+                    for (const auto d : {0UL, 1UL}) {
+                      const auto before = samples.size();
+                      const vec2 t = (d == 0UL) ? etf(y, x) : vec2(-etf(y, x));
+                      Trace(etf, p, t, length, samples);
+                      _offsets[i + d + 1UL] = samples.size() - before;
+                    }
+                  }
+                }
+              });
+  std::partial_sum(_offsets.cbegin(), _offsets.cend(), _offsets.begin());
+
+  _samples.reserve(_offsets.back());
+  for (auto& samples : tileSamples) {
+    _samples.insert(_samples.end(), samples.cbegin(), samples.cend());
+    samples = {};
+  }
+}
+
+auto StreamlineCache::getLength() const -> double {
+  return _length;
+}
+
+auto StreamlineCache::getSize() const -> cv::Size {
+  return _size;
+}
+
+auto StreamlineCache::getSamples(const int32_t y, const int32_t x,
+                                 const Direction direction) const
+  -> std::pair<const Sample*, const Sample*> {
+  const auto i = 2UL * static_cast<std::size_t>(y * _size.width + x) +
+                 static_cast<std::size_t>(direction);
+  return {_samples.data() + _offsets[i], _samples.data() + _offsets[i + 1UL]};
+}
+
+}  // namespace painty
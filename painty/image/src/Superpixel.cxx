@@ -9,10 +9,16 @@
  */
 #include "painty/image/Superpixel.hxx"
 
+#include <limits>
+#include <numeric>
 #include <random>
+#include <stdexcept>
+#include <thread>
 
 #include "math.h"
 #include "painty/core/Color.hxx"
+#include "painty/core/SumTree.hxx"
+#include "painty/core/ThreadPool.hxx"
 
 namespace segmentation_details {
 static void drawContoursAroundSegments(painty::Mat3d& image,
@@ -137,6 +143,24 @@ namespace painty {
 
 constexpr auto EpsMask = (std::numeric_limits<double>::epsilon() * 100.0);
 
+/**
+ * @brief Side length of the square tiles the pixels are assigned on.
+ *
+ */
+constexpr auto AssignmentTileSize = 64;
+
+namespace {
+/**
+ * @brief The pixels a cluster competes for in the assignment step.
+ *
+ */
+auto ClusterWindow(const vec2& center, const int32_t radius) -> cv::Rect {
+  return cv::Rect(static_cast<int32_t>(center[0]) - radius,
+                  static_cast<int32_t>(center[1]) - radius, 2 * radius + 1,
+                  2 * radius + 1);
+}
+}  // namespace
+
 SuperpixelSegmentation::SuperPixel::SuperPixel(const vec2& center,
                                                const vec3& meanColor)
     : _center(center),
@@ -178,18 +202,75 @@ void SuperpixelSegmentation::SuperPixel::reset() {
   _area            = 0;
 }
 
-ImageRegion::ImageRegion() : label(), active(false) {}
+ImageRegion::ImageRegion()
+    : label(),
+      points(),
+      pointsBegin(0UL),
+      pointsEnd(0UL),
+      active(false) {}
 
 ImageRegion::ImageRegion(const int32_t labelArg, const Mat1i& labelsMap)
     : label(labelArg),
+      points(),
+      pointsBegin(0UL),
+      pointsEnd(0UL),
       active(true) {
+  auto buffer = std::make_shared<std::vector<vec2i>>();
   for (int32_t x = 0; x < labelsMap.cols; x++) {
     for (int32_t y = 0; y < labelsMap.rows; y++) {
       if (labelsMap(y, x) == label) {
-        points.push_back(vec2i(x, y));
+        buffer->push_back(vec2i(x, y));
       }
     }
   }
+  pointsEnd = buffer->size();
+  points    = buffer;
+}
+
+ImageRegion::ImageRegion(
+  const int32_t labelArg,
+  const std::shared_ptr<const std::vector<vec2i>>& pointBuffer,
+  const size_t begin, const size_t end)
+    : label(labelArg),
+      points(pointBuffer),
+      pointsBegin(begin),
+      pointsEnd(end),
+      active(true) {}
+
+auto ExtractImageRegions(const Mat1i& labels, const int32_t labelCount)
+  -> std::vector<ImageRegion> {
+  const auto isRegion = [labelCount](const int32_t label) {
+    return (label >= 0) && (label < labelCount);
+  };
+
+  // count, prefix sum and scatter the points sorted by label
+  std::vector<size_t> offsets(static_cast<size_t>(labelCount) + 1UL, 0UL);
+  for (const auto label : labels) {
+    if (isRegion(label)) {
+      offsets[static_cast<size_t>(label) + 1UL]++;
+    }
+  }
+  std::partial_sum(offsets.cbegin(), offsets.cend(), offsets.begin());
+
+  auto buffer = std::make_shared<std::vector<vec2i>>(offsets.back());
+  auto next   = offsets;
+  for (int32_t y = 0; y < labels.rows; y++) {
+    for (int32_t x = 0; x < labels.cols; x++) {
+      const auto label = labels(y, x);
+      if (isRegion(label)) {
+        (*buffer)[next[static_cast<size_t>(label)]++] = vec2i(x, y);
+      }
+    }
+  }
+
+  std::vector<ImageRegion> regions;
+  regions.reserve(static_cast<size_t>(labelCount));
+  const std::shared_ptr<const std::vector<vec2i>> points = buffer;
+  for (auto label = 0; label < labelCount; label++) {
+    regions.emplace_back(label, points, offsets[static_cast<size_t>(label)],
+                         offsets[static_cast<size_t>(label) + 1UL]);
+  }
+  return regions;
 }
 
 void ImageRegion::setActive(bool activeArg) {
@@ -208,64 +289,63 @@ void ImageRegion::setLabel(const int32_t inlabel) {
   this->label = inlabel;
 }
 
-std::vector<vec2i>::const_iterator ImageRegion::cbegin() {
-  return points.cbegin();
+const vec2i* ImageRegion::cbegin() const {
+  return begin();
 }
 
-std::vector<vec2i>::const_iterator ImageRegion::cend() {
-  return points.cend();
+const vec2i* ImageRegion::cend() const {
+  return end();
+}
+
+const vec2i* ImageRegion::begin() const {
+  return empty() ? nullptr : (points->data() + pointsBegin);
+}
+
+const vec2i* ImageRegion::end() const {
+  return empty() ? nullptr : (points->data() + pointsEnd);
+}
+
+size_t ImageRegion::size() const {
+  return pointsEnd - pointsBegin;
+}
+
+bool ImageRegion::empty() const {
+  return pointsEnd == pointsBegin;
 }
 
 double ImageRegion::getInscribedCircle(vec2& incenter) const {
-  cv::Rect2i bound = getBoundingRectangle();
-
-  // need to pad 1 pix for dist transform to work correctly
-  const int32_t pad = 10;
-  bound.x -= pad;
-  bound.y -= pad;
-  bound.width += pad * 2;
-  bound.height += pad * 2;
-
-  Mat1d distances = getDistanceTransform(bound);
-
-  // find max in distance
-  double maxDist = 0.0;
-  for (const auto& p : points) {
-    double d = distances(p[1] - bound.y, p[0] - bound.x);
-    if (d > maxDist) {
-      maxDist     = d;
-      incenter[0] = p[0];
-      incenter[1] = p[1];
-    }
+  if (empty()) {
+    return 0.0;
   }
-
-  // find radius
-  vec2 imP(incenter[0] - bound.x, incenter[1] - bound.y);
-  double mindDist = std::numeric_limits<double>::max();
-  for (int32_t x = 0; x < distances.cols; x++) {
-    for (int32_t y = 0; y < distances.rows; y++) {
-      if (distances(y, x) <= 0.0) {
-        double d = (imP - vec2(x, y)).norm();
-        if (d < mindDist) {
-          mindDist = d;
-        }
-      }
-    }
+  // the pixels around the bounding rectangle belong to other regions
+  const auto bound = getBoundingRectangle();
+  Mat1i labelsMap(bound.size(), -1);
+  for (const auto& p : *this) {
+    labelsMap(p[1] - bound.y, p[0] - bound.x) = 0;
   }
-  // subtract 1 since we found the distance to an outside pixel
-  mindDist -= 1;
-
-  return mindDist;
+  const auto circle = ComputeInscribedCircles(labelsMap, 1).front();
+  incenter          = circle.center + vec2(bound.x, bound.y);
+  return circle.radius;
 }
 
 cv::Rect2i ImageRegion::getBoundingRectangle() const {
-  return cv::boundingRect(points);
+  if (empty()) {
+    return {};
+  }
+  vec2i minimum = *begin();
+  vec2i maximum = *begin();
+  for (const auto& p : *this) {
+    minimum = minimum.cwiseMin(p);
+    maximum = maximum.cwiseMax(p);
+  }
+  return {minimum[0], minimum[1], maximum[0] - minimum[0] + 1,
+          maximum[1] - minimum[1] + 1};
 }
 
 Mat1d ImageRegion::getDistanceTransform(
   const cv::Rect2i& boundingRectangle) const {
   Mat1u seg(boundingRectangle.size(), 0);
-  for (const auto& p : points) {
+  for (const auto& p : *this) {
     seg(p[1] - boundingRectangle.y, p[0] - boundingRectangle.x) = 255;
   }
   Mat1f distances(boundingRectangle.size());
@@ -275,19 +355,148 @@ Mat1d ImageRegion::getDistanceTransform(
   return distancesScaled;
 }
 
+namespace {
+/**
+ * @brief Lower envelope of the parabolas (q - i)^2 + f[i], evaluated at all
+ * q in [0, n).
+ *
+ * @param f heights of the n parabolas
+ * @param d squared distances
+ * @param v buffer of n positions
+ * @param z buffer of n + 1 intersections
+ */
+void LowerEnvelope(const double* f, const int32_t n, double* d, int32_t* v,
+                   double* z) {
+  const auto intersection = [f](const int32_t q, const int32_t p) {
+    return ((f[q] + q * q) - (f[p] + p * p)) / (2.0 * (q - p));
+  };
+  auto k = 0;
+  v[0]   = 0;
+  z[0]   = -std::numeric_limits<double>::infinity();
+  z[1]   = std::numeric_limits<double>::infinity();
+  for (auto q = 1; q < n; q++) {
+    auto s = intersection(q, v[k]);
+    while (s <= z[k]) {
+      k--;
+      s = intersection(q, v[k]);
+    }
+    k++;
+    v[k]     = q;
+    z[k]     = s;
+    z[k + 1] = std::numeric_limits<double>::infinity();
+  }
+  k = 0;
+  for (auto q = 0; q < n; q++) {
+    while (z[k + 1] < q) {
+      k++;
+    }
+    d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+  }
+}
+
+/**
+ * @brief Rows per task of the distance transform.
+ *
+ */
+constexpr auto DistanceRowTileSize = 32;
+}  // namespace
+
+auto ComputeLabelDistances(const Mat1i& labels) -> Mat1d {
+  // distance to the end of the run of equal labels in each column
+  Mat1i up(labels.size());
+  Mat1i down(labels.size());
+  for (auto y = 0; y < labels.rows; y++) {
+    for (auto x = 0; x < labels.cols; x++) {
+      up(y, x) = ((y > 0) && (labels(y - 1, x) == labels(y, x)))
+                   ? (up(y - 1, x) + 1)
+                   : 1;
+    }
+  }
+  for (auto y = labels.rows - 1; y >= 0; y--) {
+    for (auto x = 0; x < labels.cols; x++) {
+      down(y, x) =
+        ((y < (labels.rows - 1)) && (labels(y + 1, x) == labels(y, x)))
+          ? (down(y + 1, x) + 1)
+          : 1;
+    }
+  }
+
+  // the run of equal labels in a row is framed by two zero parabolas
+  Mat1d distances(labels.size());
+  auto& pool = DefaultThreadPool();
+  ParallelFor(
+    pool, 0, labels.rows, DistanceRowTileSize,
+    [&](const int32_t begin, const int32_t end) {
+      const auto n = static_cast<size_t>(labels.cols) + 2UL;
+      std::vector<double> f(n);
+      std::vector<double> d(n);
+      std::vector<int32_t> v(n);
+      std::vector<double> z(n + 1UL);
+      for (auto y = begin; y < end; y++) {
+        auto a = 0;
+        while (a < labels.cols) {
+          auto b = a;
+          while (((b + 1) < labels.cols) &&
+                 (labels(y, b + 1) == labels(y, a))) {
+            b++;
+          }
+          const auto length = b - a + 1;
+          f[0U]             = 0.0;
+          f[static_cast<size_t>(length) + 1UL] = 0.0;
+          for (auto x = a; x <= b; x++) {
+            const auto g = std::min(up(y, x), down(y, x));
+            f[static_cast<size_t>(x - a) + 1UL] = static_cast<double>(g * g);
+          }
+          LowerEnvelope(f.data(), length + 2, d.data(), v.data(), z.data());
+          for (auto x = a; x <= b; x++) {
+            distances(y, x) = d[static_cast<size_t>(x - a) + 1UL];
+          }
+          a = b + 1;
+        }
+      }
+    });
+  return distances;
+}
+
+auto ComputeInscribedCircles(const Mat1i& labels, const int32_t labelCount)
+  -> std::vector<InscribedCircle> {
+  const auto distances = ComputeLabelDistances(labels);
+  std::vector<InscribedCircle> circles(static_cast<size_t>(labelCount));
+  std::vector<double> maxima(circles.size(), 0.0);
+  for (auto y = 0; y < labels.rows; y++) {
+    for (auto x = 0; x < labels.cols; x++) {
+      const auto label = labels(y, x);
+      if ((label < 0) || (label >= labelCount)) {
+        continue;
+      }
+      const auto i = static_cast<size_t>(label);
+      if (distances(y, x) > maxima[i]) {
+        maxima[i]         = distances(y, x);
+        circles[i].center = vec2(x, y);
+      }
+    }
+  }
+  for (size_t i = 0; i < circles.size(); i++) {
+    if (maxima[i] > 0.0) {
+      circles[i].radius = std::sqrt(maxima[i]) - 1.0;
+    }
+  }
+  return circles;
+}
+
 vec2 ImageRegion::getSpatialMean() const {
   vec2 mean = vec2::Zero();
 
-  if (points.empty()) {
+  if (empty()) {
     return mean;
   }
 
-  for (const vec2i& p : points) {
+  for (const vec2i& p : *this) {
     mean[0] += p[0];
     mean[1] += p[1];
   }
-  return vec2(mean[0] / static_cast<double>(points.size()),
-              mean[1] / static_cast<double>(points.size()));
+  return vec2(mean[0] / static_cast<double>(size()),
+              mean[1] / static_cast<double>(size()));
 }
 
 void SuperpixelSegmentation::extractWithDiff(const Mat3d& targetLabArg,
@@ -302,48 +511,49 @@ void SuperpixelSegmentation::extractWithDiff(const Mat3d& targetLabArg,
   const int32_t N = _targetLab.cols * _targetLab.rows;
   const int32_t K = static_cast<int32_t>(N / (std::pow(cellWidth, 2)));
   const int32_t S = static_cast<int32_t>(std::sqrt(N / K));
+  _cellWidth      = cellWidth;
+  _gridStep       = S;
+  _assignment.release();
+  _distances.release();
 
   _superPixels.clear();
+  auto& pool = DefaultThreadPool();
 
   if ((!_difference.empty()) &&
       (_extractionStrategy == SLICO_POISSON_WEIGHTED)) {
-    //poisson disc distribution weighted by distribution energy
-    std::vector<vec2> samples;
-    Mat1d p = _difference.clone();
-
-    std::vector<double> intervals(p.total());
-    for (size_t i = 0; i < intervals.size(); ++i) {
-      intervals[i] = static_cast<double>(i);
+    // poisson disc distribution weighted by distribution energy, the weights
+    // of a disc around each sample are cleared so no draw is rejected
+    std::vector<double> weights(_difference.total(), 0.0);
+    for (size_t i = 0; i < weights.size(); ++i) {
+      const auto index = static_cast<int32_t>(i);
+      weights[i]       = (_mask(index) > 0.0) ? _difference(index) : 0.0;
     }
-    std::piecewise_linear_distribution<double> distribution =
-      std::piecewise_linear_distribution<double>(intervals.begin(),
-                                                 intervals.end(), p.begin());
-    const auto maxSamples = K;
-    samples.reserve(static_cast<size_t>(maxSamples));
+    SumTree distribution(weights);
+
+    const auto maxSamples = static_cast<size_t>(K);
+    const auto radius     = S / 2;
+    std::vector<vec2> samples;
+    samples.reserve(maxSamples);
     std::default_random_engine generator;
-    vec2 sample;
-    bool stop = false;
-    for (int32_t j = 0; (j < maxSamples) && (!stop); ++j) {
-      int32_t index    = 0;
-      int32_t nrTrials = 0;
-      do {
-        index = static_cast<int32_t>(distribution(generator));
-        if (nrTrials++ >= 1000) {
-          stop = true;
-        }
-      } while (p(index) <= 0.0);
-
-      if (p(index) > 0.0) {
-        sample << index % p.cols, index / p.cols;
-
-        if (_mask(index) > 0.0) {
-          // add poisson disc
-          cv::circle(p,
-                     cv::Point(static_cast<int32_t>(sample[0]),
-                               static_cast<int32_t>(sample[1])),
-                     S / 2, cv::Scalar(0.0), -1, 8);
-          samples.push_back(sample);
+    while ((samples.size() < maxSamples) && (distribution.total() > 0.0)) {
+      const auto index = static_cast<int32_t>(distribution.sample(generator));
+      const auto x     = index % _difference.cols;
+      const auto y     = index / _difference.cols;
+      samples.emplace_back(x, y);
+
+      // add poisson disc
+      for (auto dy = -radius; dy <= radius; dy++) {
+        const auto row = y + dy;
+        if ((row < 0) || (row >= _difference.rows)) {
+          continue;
         }
+        const auto dx    = static_cast<int32_t>(
+          std::sqrt(static_cast<double>(radius * radius - dy * dy)));
+        const auto begin = std::max(x - dx, 0);
+        const auto end   = std::min(x + dx + 1, _difference.cols);
+        distribution.fill(static_cast<size_t>(row * _difference.cols + begin),
+                          static_cast<size_t>(row * _difference.cols + end),
+                          0.0);
       }
     }
     _superPixels.reserve(samples.size());
@@ -395,7 +605,7 @@ void SuperpixelSegmentation::extractWithDiff(const Mat3d& targetLabArg,
         la++;
       }
     }
-    computeStats(_superPixels, _labels);
+    computeStats(pool, _superPixels, _labels, {});
     return;
   }
 
@@ -403,58 +613,109 @@ void SuperpixelSegmentation::extractWithDiff(const Mat3d& targetLabArg,
   perturbClusterCenters(_superPixels);
 
   // run the segmentation algorithm
-  Mat<int32_t> newLabels(_targetLab.size(), -1);
-  Mat1d distances(_targetLab.size(), std::numeric_limits<double>::max());
+  _assignment = Mat<int32_t>(_targetLab.size(), -1);
+  _distances  = Mat1d(_targetLab.size(), std::numeric_limits<double>::max());
+  iterate(pool, {});
+}
+
+void SuperpixelSegmentation::updateWithDiff(const Mat1d& difference,
+                                            const double minChange) {
+  if (_targetLab.empty()) {
+    throw std::runtime_error(
+      "SuperpixelSegmentation::updateWithDiff: nothing extracted yet");
+  }
+  if (_assignment.empty() || _difference.empty() ||
+      (difference.size() != _difference.size())) {
+    extractWithDiff(_targetLab, difference, _mask, _cellWidth);
+    return;
+  }
+  auto& pool = DefaultThreadPool();
 
+  // mean absolute change of the difference in the window of each cluster
+  Mat1d change(difference.size());
+  for (int32_t i = 0; i < static_cast<int32_t>(change.total()); i++) {
+    change(i) = std::abs(difference(i) - _difference(i));
+  }
+  Mat1d changeSums;
+  cv::integral(change, changeSums, CV_64F);
+  _difference = difference;
+
+  const auto radius = 2 * _gridStep;
+  const cv::Rect image(0, 0, _assignment.cols, _assignment.rows);
+  std::vector<uint8_t> active(_superPixels.size(), 0U);
+  auto nrActive = 0UL;
+  for (size_t i = 0; i < _superPixels.size(); i++) {
+    const auto w = ClusterWindow(_superPixels[i]._center, radius) & image;
+    if (w.empty()) {
+      continue;
+    }
+    const auto sum = changeSums(w.y + w.height, w.x + w.width) -
+                     changeSums(w.y, w.x + w.width) -
+                     changeSums(w.y + w.height, w.x) + changeSums(w.y, w.x);
+    if ((sum / static_cast<double>(w.area())) > minChange) {
+      active[i] = 1U;
+      nrActive++;
+    }
+  }
+
+  // pixels that can not be assigned anymore are dropped, the pixels of active
+  // clusters in reach of them compete again
+  for (auto y = 0; y < _assignment.rows; y++) {
+    for (auto x = 0; x < _assignment.cols; x++) {
+      if (!isAssignable(x, y)) {
+        _assignment(y, x) = -1;
+        _distances(y, x)  = std::numeric_limits<double>::max();
+      }
+    }
+  }
+  for (size_t i = 0; i < _superPixels.size(); i++) {
+    if (active[i] == 0U) {
+      continue;
+    }
+    const auto w = ClusterWindow(_superPixels[i]._center, radius) & image;
+    for (auto y = w.y; y < (w.y + w.height); y++) {
+      for (auto x = w.x; x < (w.x + w.width); x++) {
+        const auto label = _assignment(y, x);
+        if ((label >= 0) && (active[static_cast<size_t>(label)] != 0U)) {
+          _assignment(y, x) = -1;
+          _distances(y, x)  = std::numeric_limits<double>::max();
+        }
+      }
+    }
+  }
+
+  if (nrActive > 0UL) {
+    iterate(pool, active);
+  } else {
+    relabel();
+  }
+}
+
+void SuperpixelSegmentation::iterate(ThreadPool& pool,
+                                     const std::vector<uint8_t>& active) {
   auto error                   = std::numeric_limits<double>::max();
   auto iteration               = 0U;
   constexpr auto MaxIterations = 100U;
   constexpr auto MaxError      = 0.001;
   while ((error > MaxError) && (iteration++ < MaxIterations)) {
-    for (auto& c : _superPixels) {
-      c.reset();
-    }
-
-    const int32_t size = 2 * S;
     for (size_t i = 0; i < _superPixels.size(); i++) {
-      SuperPixel& cluster = _superPixels[i];
-
-      vec2i can;
-      double cdist = 0.0;
-      double ndist = 0.0;
-
-      for (int32_t x = static_cast<int32_t>(cluster._center[0]) - size;
-           x <= static_cast<int32_t>(cluster._center[0]) + size; x++) {
-        for (int32_t y = static_cast<int32_t>(cluster._center[1]) - size;
-             y <= static_cast<int32_t>(cluster._center[1]) + size; y++) {
-          if (x < 0 || y < 0 || y >= distances.rows || x >= distances.cols) {
-            continue;
-          }
-
-          if (fuzzyCompare(_mask(y, x), 0.0, EpsMask) ||
-              (!_difference.empty() && (_difference(y, x) <= 0.0))) {
-            newLabels(y, x) = -1;
-            distances(y, x) = std::numeric_limits<double>::max();
-            continue;
-          }
-
-          can[0] = x;
-          can[1] = y;
-          cdist  = distances(y, x);
-          ndist  = distance(cluster, can);
-
-          if (ndist < cdist) {
-            distances(y, x) = ndist;
-            newLabels(y, x) = static_cast<int32_t>(i);
-          }
-        }
+      if (active.empty() || (active[i] != 0U)) {
+        _superPixels[i].reset();
       }
     }
-    error = computeStats(_superPixels, newLabels);
+
+    assignPixels(pool, 2 * _gridStep, _assignment, _distances, active);
+    error = computeStats(pool, _superPixels, _assignment, active);
   }
+  relabel();
+}
+
+void SuperpixelSegmentation::relabel() {
   int32_t newK = 0;
   _labels      = segmentation_details::enforceLabelConnectivity(
-    newLabels, newK, static_cast<int32_t>(double(N) / double(S * S)));
+    _assignment, newK,
+    static_cast<int32_t>(static_cast<double>(_assignment.total()) /
+                         static_cast<double>(_gridStep * _gridStep)));
 }
 
 void SuperpixelSegmentation::extract(const Mat3d& targetLabArg,
@@ -531,26 +792,66 @@ void SuperpixelSegmentation::perturbClusterCenters(
 }
 
 double SuperpixelSegmentation::computeStats(
+  ThreadPool& pool,
   std::vector<SuperpixelSegmentation::SuperPixel>& superPixels,
-  Mat<int32_t>& labels) const {
-  for (int32_t x = 0; x < labels.cols; ++x) {
-    for (int32_t y = 0; y < labels.rows; ++y) {
-      int32_t clusterID = labels(y, x);
-      if (fuzzyCompare(_mask(y, x), 0.0, EpsMask) || clusterID == -1) {
+  Mat<int32_t>& labels, const std::vector<uint8_t>& active) const {
+  const auto isActive = [&active](const size_t i) {
+    return active.empty() || (active[i] != 0U);
+  };
+  // partial sums per band of rows, added up in band order afterwards
+  struct Sums {
+    vec2 center     = vec2::Zero();
+    vec3 meanColor  = vec3::Zero();
+    double meanDiff = 0.0;
+    int32_t area    = 0;
+  };
+  const auto bandCount = static_cast<int32_t>(
+    std::max(std::thread::hardware_concurrency(), 1U));
+  const auto bandSize = std::max((labels.rows + bandCount - 1) / bandCount, 1);
+  std::vector<std::vector<Sums>> bands(
+    static_cast<size_t>((labels.rows + bandSize - 1) / bandSize));
+  ParallelFor(
+    pool, 0, labels.rows, bandSize,
+    [&](const int32_t begin, const int32_t end) {
+      auto& sums = bands[static_cast<size_t>(begin / bandSize)];
+      sums.resize(superPixels.size());
+      for (int32_t y = begin; y < end; ++y) {
+        for (int32_t x = 0; x < labels.cols; ++x) {
+          int32_t clusterID = labels(y, x);
+          if (fuzzyCompare(_mask(y, x), 0.0, EpsMask) || clusterID == -1) {
+            continue;
+          }
+
+          auto& center = sums[static_cast<size_t>(clusterID)];
+          center.meanColor += _targetLab(y, x);
+          center.meanDiff += (_difference.empty()) ? 0.0 : _difference(y, x);
+          center.center[0] += x;
+          center.center[1] += y;
+          center.area++;
+        }
+      }
+    });
+  for (const auto& sums : bands) {
+    for (size_t i = 0; i < sums.size(); i++) {
+      if (!isActive(i)) {
         continue;
       }
-
-      SuperPixel& center = superPixels[static_cast<size_t>(clusterID)];
-      center._meanColorT += _targetLab(y, x);
-      center._meanDiffT += (_difference.empty()) ? 0.0 : _difference(y, x);
-      center._centerT[0] += x;
-      center._centerT[1] += y;
-      center._area++;
+      auto& superPixel = superPixels[i];
+      superPixel._meanColorT += sums[i].meanColor;
+      superPixel._meanDiffT += sums[i].meanDiff;
+      superPixel._centerT += sums[i].center;
+      superPixel._area += sums[i].area;
     }
   }
 
-  double error = 0.;
-  for (auto& superPixel : superPixels) {
+  double error   = 0.;
+  auto nrUpdated = 0UL;
+  for (size_t i = 0; i < superPixels.size(); i++) {
+    auto& superPixel = superPixels[i];
+    if (!isActive(i)) {
+      continue;
+    }
+    nrUpdated++;
     if (superPixel._area == 0) {
       continue;
     }
@@ -570,63 +871,142 @@ double SuperpixelSegmentation::computeStats(
     superPixel._maxSpatialDist = superPixel._maxSpatialDistT;
   }
 
-  return error / static_cast<double>(superPixels.size());
+  return (nrUpdated > 0UL) ? (error / static_cast<double>(nrUpdated)) : 0.0;
 }
 
-double SuperpixelSegmentation::distance(
-  SuperpixelSegmentation::SuperPixel& superPixel, const vec2i& pos2) const {
-  if (_useDiffWeight) {
-    const double dc =
-      (superPixel._meanColor - _targetLab(pos2[1], pos2[0])).norm();
-    const double ds = (superPixel._center - vec2(pos2[0], pos2[1])).norm();
-    const double dd =
-      (_difference.empty())
-        ? 0.0
-        : std::sqrt(std::pow(
-            superPixel._meanDiff - _difference(pos2[1], pos2[0]), 2.0));
+void SuperpixelSegmentation::assignPixels(
+  ThreadPool& pool, const int32_t radius, Mat<int32_t>& labels,
+  Mat1d& distances, const std::vector<uint8_t>& active) {
+  const cv::Rect image(0, 0, labels.cols, labels.rows);
+  const auto windowOf = [radius](const SuperPixel& superPixel) {
+    return ClusterWindow(superPixel._center, radius);
+  };
+
+  // the clusters whose windows overlap a tile, in ascending order, so ties
+  // are resolved as if the clusters were visited one after another
+  const auto tilesX =
+    (image.width + AssignmentTileSize - 1) / AssignmentTileSize;
+  const auto tilesY =
+    (image.height + AssignmentTileSize - 1) / AssignmentTileSize;
+  std::vector<std::vector<size_t>> tileClusters(
+    static_cast<size_t>(tilesX * tilesY));
+  // only tiles reached by an active cluster are visited, frozen clusters
+  // still compete there
+  std::vector<uint8_t> tileActive(
+    tileClusters.size(), static_cast<uint8_t>(active.empty() ? 1U : 0U));
+  for (size_t i = 0; i < _superPixels.size(); i++) {
+    const auto window = windowOf(_superPixels[i]) & image;
+    if (window.empty()) {
+      continue;
+    }
+    const auto tx1 = (window.x + window.width - 1) / AssignmentTileSize;
+    const auto ty1 = (window.y + window.height - 1) / AssignmentTileSize;
+    for (auto ty = window.y / AssignmentTileSize; ty <= ty1; ty++) {
+      for (auto tx = window.x / AssignmentTileSize; tx <= tx1; tx++) {
+        const auto t = static_cast<size_t>(ty * tilesX + tx);
+        tileClusters[t].push_back(i);
+        if (!active.empty() && (active[i] != 0U)) {
+          tileActive[t] = 1U;
+        }
+      }
+    }
+  }
+
+  // labels and distances are only written inside the own tile, the maximum
+  // squared distances go to per tile partials
+  std::vector<std::vector<vec3>> tileMaxima(tileClusters.size());
+  ParallelFor(
+    pool, 0, tilesX * tilesY, 1, [&](const int32_t begin, const int32_t end) {
+      for (auto t = begin; t < end; t++) {
+        if (tileActive[static_cast<size_t>(t)] == 0U) {
+          continue;
+        }
+        const auto& clusters = tileClusters[static_cast<size_t>(t)];
+        auto& maxima         = tileMaxima[static_cast<size_t>(t)];
+        maxima.assign(clusters.size(), vec3::Zero());
+        const cv::Rect tile((t % tilesX) * AssignmentTileSize,
+                            (t / tilesX) * AssignmentTileSize,
+                            AssignmentTileSize, AssignmentTileSize);
+        for (size_t j = 0; j < clusters.size(); j++) {
+          const auto& cluster = _superPixels[clusters[j]];
+          const auto window   = windowOf(cluster) & tile & image;
+          // SLICO, the distances are normalized by the maxima of the last
+          // iteration
+          const vec3 weights(
+            1.0 / (cluster._maxColorDist * cluster._maxColorDist),
+            1.0 / (cluster._maxDiffDist * cluster._maxDiffDist),
+            1.0 / (cluster._maxSpatialDist * cluster._maxSpatialDist));
+          for (auto y = window.y; y < (window.y + window.height); y++) {
+            for (auto x = window.x; x < (window.x + window.width); x++) {
+              if (!isAssignable(x, y)) {
+                continue;
+              }
+              const auto d = squaredDistances(cluster, x, y);
+              maxima[j]    = maxima[j].cwiseMax(d);
 
-    superPixel._maxColorDistT   = std::max(superPixel._maxColorDistT, dc);
-    superPixel._maxDiffDistT    = std::max(superPixel._maxDiffDistT, dd);
-    superPixel._maxSpatialDistT = std::max(superPixel._maxSpatialDistT, ds);
-    // SLICO
-    return std::sqrt(std::pow(dc / superPixel._maxColorDist, 2.0F) +
-                     std::pow(dd / superPixel._maxDiffDist, 2.0F) +
-                     std::pow(ds / superPixel._maxSpatialDist, 2.0F));
+              const auto dist = weights.dot(d);
+              if (dist < distances(y, x)) {
+                distances(y, x) = dist;
+                labels(y, x)    = static_cast<int32_t>(clusters[j]);
+              }
+            }
+          }
+        }
+      }
+    });
+
+  for (size_t t = 0; t < tileClusters.size(); t++) {
+    for (size_t j = 0; j < tileMaxima[t].size(); j++) {
+      auto& cluster       = _superPixels[tileClusters[t][j]];
+      const auto& maximum = tileMaxima[t][j];
+      cluster._maxColorDistT =
+        std::max(cluster._maxColorDistT, std::sqrt(maximum[0]));
+      cluster._maxDiffDistT =
+        std::max(cluster._maxDiffDistT, std::sqrt(maximum[1]));
+      cluster._maxSpatialDistT =
+        std::max(cluster._maxSpatialDistT, std::sqrt(maximum[2]));
+    }
   }
-  const double dc =
-    (superPixel._meanColor - _targetLab(pos2[1], pos2[0])).norm();
-  const double ds = (superPixel._center - vec2(pos2[0], pos2[1])).norm();
+}
+
+vec3 SuperpixelSegmentation::squaredDistances(
+  const SuperpixelSegmentation::SuperPixel& superPixel, const int32_t x,
+  const int32_t y) const {
+  const auto dd = (!_useDiffWeight || _difference.empty())
+                    ? 0.0
+                    : (superPixel._meanDiff - _difference(y, x));
+  return {(superPixel._meanColor - _targetLab(y, x)).squaredNorm(), dd * dd,
+          (superPixel._center - vec2(x, y)).squaredNorm()};
+}
 
-  superPixel._maxColorDistT   = std::max(superPixel._maxColorDistT, dc);
-  superPixel._maxSpatialDistT = std::max(superPixel._maxSpatialDistT, ds);
-  // SLICO
-  return std::sqrt(std::pow(dc / superPixel._maxColorDist, 2.0) +
-                   std::pow(ds / superPixel._maxSpatialDist, 2.0));
+bool SuperpixelSegmentation::isAssignable(const int32_t x,
+                                          const int32_t y) const {
+  return !fuzzyCompare(_mask(y, x), 0.0, EpsMask) &&
+         (_difference.empty() || (_difference(y, x) > 0.0));
 }
 
 const Mat1i& SuperpixelSegmentation::getRegions(
   std::map<int32_t, ImageRegion>& regions) {
-  std::vector<std::pair<ImageRegion, double>> regionsS;
-  for (int32_t label = 0; label < static_cast<int32_t>(_superPixels.size());
-       label++) {
-    ImageRegion r(label, _labels);
-    double m = (_difference.empty()) ? 0.0 : r.computeMean(_difference);
-    regionsS.emplace_back(std::move(r), m);
+  const auto labelCount = static_cast<int32_t>(_superPixels.size());
+
+  // shuffle the labels, the new label of order[i] is i
+  std::vector<int32_t> order(static_cast<size_t>(labelCount));
+  std::iota(order.begin(), order.end(), 0);
+  std::random_shuffle(order.begin(), order.end());
+  std::vector<int32_t> permutation(order.size());
+  for (auto i = 0; i < labelCount; i++) {
+    permutation[static_cast<size_t>(order[static_cast<size_t>(i)])] = i;
+  }
+  for (auto& label : _labels) {
+    if ((label >= 0) && (label < labelCount)) {
+      label = permutation[static_cast<size_t>(label)];
+    }
   }
-
-  //    std::sort(regionsS.begin(), regionsS.end(), [](std::pair<ImageRegion, double> &a, std::pair<ImageRegion, double> &b) {
-  //        return std::get<1>(a) > std::get<1>(b);
-  //    });
-
-  std::random_shuffle(regionsS.begin(), regionsS.end());
 
   regions.clear();
-  int32_t newLabel = 0;
-  for (auto& t : regionsS) {
-    ImageRegion& region = std::get<0>(t);
-    region.setLabel(newLabel++);
-    region.fill(_labels, region.getLabel());
-    regions.emplace(std::make_pair(region.getLabel(), std::move(region)));
+  for (auto& region : ExtractImageRegions(_labels, labelCount)) {
+    const auto label = region.getLabel();
+    regions.emplace(label, std::move(region));
   }
   return _labels;
 }
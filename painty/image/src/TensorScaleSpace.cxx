@@ -0,0 +1,70 @@
+/**
+ * @file TensorScaleSpace.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ *
+ * @date 2020-11-18
+ *
+ */
+#include "painty/image/TensorScaleSpace.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "painty/image/EdgeTangentFlow.hxx"
+#include "painty/image/RecursiveGaussian.hxx"
+
+namespace painty {
+
+TensorScaleSpace::TensorScaleSpace(const Mat3d& image, const Mat1d& mask)
+    : _image(image),
+      _mask(mask),
+      _levels() {
+  _levels.emplace(0.0, tensor::ComputeGradientProducts(image, mask, 0.0,
+                                                       !mask.empty()));
+}
+
+void TensorScaleSpace::addLevels(std::vector<double> sigmas) {
+  std::sort(sigmas.begin(), sigmas.end());
+  for (const auto sigma : sigmas) {
+    getLevel(sigma);
+  }
+}
+
+auto TensorScaleSpace::getTensors(const double outerSigma) -> Mat3d {
+  Mat<vec3f> tensors;
+  if (outerSigma > 0.0) {
+    tensors = tensor::NormalizeGradientProducts(getLevel(outerSigma),
+                                                !_mask.empty());
+  } else {
+    // the products are not masked without blur
+    tensors = tensor::ComputeTensorsFused(_image, _mask, 0.0, 0.0);
+  }
+  Mat3d result;
+  tensors.convertTo(result, CV_64FC3);
+  return result;
+}
+
+auto TensorScaleSpace::getLevelCount() const -> std::size_t {
+  return _levels.size();
+}
+
+auto TensorScaleSpace::getLevel(const double sigma) -> const Mat<vec4f>& {
+  if (sigma <= 0.0) {
+    return _levels.begin()->second;
+  }
+  const auto next = _levels.lower_bound(sigma);
+  if ((next != _levels.end()) && !(next->first > sigma)) {
+    return next->second;
+  }
+
+  // the unblurred level is always present
+  const auto& finer = *std::prev(next);
+  Mat<vec4f> level;
+  gaussianBlur(finer.second, level,
+               std::sqrt(sigma * sigma - finer.first * finer.first));
+  return _levels.emplace(sigma, level).first->second;
+}
+
+}  // namespace painty
@@ -0,0 +1,86 @@
+/**
+ * @file BilateralGridTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-16
+ *
+ */
+#include <random>
+
+#include "gtest/gtest.h"
+#include "painty/image/BilateralGrid.hxx"
+#include "painty/image/Convolution.hxx"
+
+TEST(BilateralGridTest, PreservesEdges) {
+  // a noisy step in luminance, larger than a tile
+  constexpr auto Rows = 300;
+  constexpr auto Cols = 520;
+  std::mt19937 generator(42U);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  painty::Mat3d image(Rows, Cols);
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      const auto L = (x < Cols / 2) ? 30.0 : 70.0;
+      image(y, x)  = {L + noise(generator), 10.0 + noise(generator),
+                     -5.0 + noise(generator)};
+    }
+  }
+
+  const auto filtered = painty::filterBilateralGrid(image, 4.0, 5.0);
+  ASSERT_EQ(filtered.size(), image.size());
+
+  auto maxError = 0.0;
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      const auto L = (x < Cols / 2) ? 30.0 : 70.0;
+      maxError =
+        std::max(maxError, (filtered(y, x) - painty::vec3(L, 10.0, -5.0))
+                             .cwiseAbs()
+                             .maxCoeff());
+    }
+  }
+  // the noise is smoothed, the step is kept
+  EXPECT_LT(maxError, 1.5);
+
+  const auto smoothed = painty::smoothOABF(
+    image, painty::Mat1d(), 4.0, 5.0, 3.0, 2U,
+    painty::SmoothingFilter::BilateralGrid);
+  EXPECT_EQ(smoothed.size(), image.size());
+
+  EXPECT_THROW(painty::filterBilateralGrid(image, 0.0, 5.0),
+               std::invalid_argument);
+}
+
+TEST(BilateralGridTest, Mask) {
+  constexpr auto Rows = 100;
+  constexpr auto Cols = 120;
+  std::mt19937 generator(7U);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  painty::Mat3d image(Rows, Cols);
+  painty::Mat1d mask(Rows, Cols, 1.0);
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      // masked out pixels of the same luminance but a far off color
+      const auto inside = ((x / 10) % 2) == 0;
+      image(y, x)       = {50.0 + noise(generator), inside ? 10.0 : 60.0, 0.0};
+      mask(y, x)        = inside ? 1.0 : 0.0;
+    }
+  }
+
+  const auto filtered = painty::filterBilateralGrid(image, 4.0, 5.0, mask);
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      if (mask(y, x) > 0.0) {
+        EXPECT_NEAR(filtered(y, x)[1U], 10.0, 0.001);
+      } else {
+        EXPECT_EQ(filtered(y, x), image(y, x));
+      }
+    }
+  }
+
+  EXPECT_THROW(
+    painty::filterBilateralGrid(image, 4.0, 5.0, painty::Mat1d(10, 10, 1.0)),
+    std::invalid_argument);
+}
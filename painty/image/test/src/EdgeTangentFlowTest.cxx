@@ -60,3 +60,57 @@ TEST(MatTest, EdgeTangentFlowTest) {
   }
   // const auto vis = painty::lineIntegralConv(etf, 80.0);
 }
+
+TEST(MatTest, LineIntegralConvTest) {
+  const painty::Mat2d etf(200, 240, painty::vec2(1.0, 0.0));
+  const auto lic = painty::lineIntegralConv(etf, 5.0);
+  ASSERT_EQ(lic.size(), etf.size());
+
+  // the noise is smoothed along the rows only
+  auto alongFlow  = 0.0;
+  auto acrossFlow = 0.0;
+  for (auto y = 0; y < (lic.rows - 1); y++) {
+    for (auto x = 0; x < (lic.cols - 1); x++) {
+      EXPECT_GE(lic(y, x), 0.0);
+      EXPECT_LE(lic(y, x), 1.0);
+      alongFlow += std::abs(lic(y, x + 1) - lic(y, x));
+      acrossFlow += std::abs(lic(y + 1, x) - lic(y, x));
+    }
+  }
+  EXPECT_LT(alongFlow, 0.5 * acrossFlow);
+}
+
+TEST(MatTest, ComputeTensorsFusedTest) {
+  painty::Mat3d image;
+  painty::io::imRead("./data/test_images/field.jpg", image, true);
+  image = painty::ScaledMat(image, image.rows / 4, image.cols / 4);
+  const auto lab = painty::convertColor(
+    image, painty::ColorConverter<double>::Conversion::rgb_2_CIELab);
+  painty::Mat1d mask(lab.size(), 1.0);
+  mask(cv::Rect(0, 0, mask.cols / 3, mask.rows / 3)) = 0.0;
+
+  for (const auto& m : {painty::Mat1d(), mask}) {
+    for (const auto innerSigma : {0.0, 1.0}) {
+      const auto tensors =
+        painty::tensor::ComputeTensors(lab, m, innerSigma, 2.0);
+      const auto etf = painty::ComputeEdgeTangentFlow(tensors);
+
+      painty::Mat<painty::vec2f> etfFused;
+      const auto fused =
+        painty::tensor::ComputeTensorsFused(lab, m, innerSigma, 2.0, &etfFused);
+      ASSERT_EQ(fused.size(), tensors.size());
+      ASSERT_EQ(etfFused.size(), tensors.size());
+
+      for (auto i = 0; i < static_cast<int32_t>(tensors.total()); i++) {
+        const auto& t = tensors(i);
+        EXPECT_NEAR(static_cast<double>(fused(i)[0U]), t[0U], 1e-4);
+        EXPECT_NEAR(static_cast<double>(fused(i)[1U]), t[1U], 1e-4);
+        EXPECT_NEAR(static_cast<double>(fused(i)[2U]), t[2U], 1e-4);
+        // the direction is only defined for anisotropic tensors
+        if (((t[0U] - t[2U]) * (t[0U] - t[2U]) + 4.0 * t[1U] * t[1U]) > 1e-4) {
+          EXPECT_GT(std::abs(etfFused(i).cast<double>().dot(etf(i))), 0.999);
+        }
+      }
+    }
+  }
+}
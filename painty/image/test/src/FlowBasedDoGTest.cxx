@@ -7,11 +7,55 @@
  * @date 2020-08-26
  *
  */
+#include <cmath>
+
 #include "gtest/gtest.h"
 #include "painty/image/EdgeTangentFlow.hxx"
 #include "painty/image/FlowBasedDoG.hxx"
 #include "painty/io/ImageIO.hxx"
 
+namespace {
+/**
+ * @brief The serial double precision filter pass the optimized version is
+ * validated against.
+ *
+ */
+void ReferenceOabfPass(const uint32_t pass, const painty::Mat3d& source,
+                       painty::Mat3d& target, const painty::Mat2d& tfm,
+                       const double sigma_d, const double sigma_r) {
+  for (auto y = 0; y < source.rows; y++) {
+    for (auto x = 0; x < source.cols; x++) {
+      const painty::vec2 uv(x, y);
+      const auto tangent = painty::Interpolate(tfm, uv);
+      auto t =
+        (pass == 0U) ? painty::vec2(tangent[1U], -tangent[0U]) : tangent;
+      if (std::abs(t[0U]) >= std::abs(t[1U])) {
+        t[1U] = t[1U] / t[0U];
+        t[0U] = 1.0;
+      } else {
+        t[0U] = t[0U] / t[1U];
+        t[1U] = 1.0;
+      }
+      const auto center    = painty::Interpolate(source, uv);
+      auto sum             = center;
+      auto norm            = 1.0;
+      const auto halfWidth = (2.0 * sigma_d) / t.norm();
+      for (auto d = 1; d <= halfWidth; d++) {
+        for (const auto sign : {-1.0, 1.0}) {
+          const auto c  = painty::Interpolate(source, uv + sign * d * t);
+          const auto e  = (c - center).norm();
+          const auto kd = std::exp(-(d * d) / (2.0 * sigma_d * sigma_d));
+          const auto ke = std::exp(-(e * e) / (2.0 * sigma_r * sigma_r));
+          norm += kd * ke;
+          sum += kd * ke * c;
+        }
+      }
+      target(y, x) = sum / norm;
+    }
+  }
+}
+}  // namespace
+
 TEST(FDoGTest, FDoGTestFunc) {
   painty::Mat3d image;
   // load an image as linear rgb
@@ -23,3 +67,39 @@ TEST(FDoGTest, FDoGTestFunc) {
 
   painty::io::imSave("./data/test_images/field_oabf.jpg", fdogRes, true);
 }
+
+TEST(FDoGTest, OrientationAlignedBilateralFilter) {
+  painty::Mat3d image;
+  painty::io::imRead("./data/test_images/field.jpg", image, true);
+  image = painty::ScaledMat(image, image.rows / 8, image.cols / 8);
+  const auto Lab = painty::convertColor(
+    image, painty::ColorConverter<double>::Conversion::rgb_2_CIELab);
+  const auto etf = painty::ComputeEdgeTangentFlow(
+    painty::tensor::ComputeTensors(Lab, painty::Mat1d(), 0.0, 3.0));
+
+  constexpr auto SigmaD     = 3.0;
+  constexpr auto SigmaR     = 4.25;
+  constexpr auto Iterations = 2U;
+
+  painty::Mat3d t0(Lab.size());
+  auto t1 = Lab.clone();
+  for (auto i = 0U; i < Iterations; i++) {
+    ReferenceOabfPass(0U, t1, t0, etf, SigmaD, SigmaR);
+    ReferenceOabfPass(1U, t0, t1, etf, SigmaD, SigmaR);
+  }
+
+  const auto oabf = painty::FlowBasedDoG::filterBilateralOrientationAligned(
+    Lab, etf, SigmaD, SigmaR, Iterations);
+  ASSERT_EQ(oabf.size(), t1.size());
+  auto maxError = 0.0;
+  for (auto i = 0; i < static_cast<int32_t>(oabf.total()); i++) {
+    maxError = std::max(maxError, (oabf(i) - t1(i)).cwiseAbs().maxCoeff());
+  }
+  // float precision and the tabulated range kernel, CIELab L is in [0, 100]
+  EXPECT_LT(maxError, 0.05);
+
+  const auto unfiltered =
+    painty::FlowBasedDoG::filterBilateralOrientationAligned(Lab, etf, SigmaD,
+                                                            SigmaR, 0U);
+  EXPECT_EQ(cv::norm(unfiltered, Lab, cv::NORM_INF), 0.0);
+}
@@ -0,0 +1,97 @@
+/**
+ * @file RecursiveGaussianTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-19
+ *
+ */
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+#include "painty/image/RecursiveGaussian.hxx"
+
+namespace {
+/**
+ * @brief Blocks of 0 and 1 in the first channel, scaled in the others.
+ *
+ */
+auto Checkerboard(const int32_t rows, const int32_t cols, const int32_t block)
+  -> painty::Mat<painty::vec3f> {
+  painty::Mat<painty::vec3f> image(rows, cols);
+  for (auto y = 0; y < rows; y++) {
+    for (auto x = 0; x < cols; x++) {
+      const auto v = static_cast<float>(((y / block) + (x / block)) % 2);
+      image(y, x)  = {v, 0.5F * v, -v};
+    }
+  }
+  return image;
+}
+}  // namespace
+
+TEST(RecursiveGaussianTest, MatchesGaussianBlur) {
+  constexpr auto Sigma = 10.0;
+  const auto image     = Checkerboard(240, 260, 40);
+
+  painty::Mat<painty::vec3f> expected;
+  cv::GaussianBlur(image, expected, cv::Size(-1, -1), Sigma, 0.0,
+                   cv::BORDER_REFLECT);
+  painty::Mat<painty::vec3f> blurred;
+  painty::recursiveGaussianBlur(image, blurred, Sigma);
+  ASSERT_EQ(blurred.size(), image.size());
+
+  // the borders are replicated instead of reflected
+  const auto margin = static_cast<int32_t>(4.0 * Sigma);
+  for (auto y = margin; y < (image.rows - margin); y++) {
+    for (auto x = margin; x < (image.cols - margin); x++) {
+      for (auto k = 0U; k < 3U; k++) {
+        EXPECT_NEAR(blurred(y, x)[k], expected(y, x)[k], 0.04F);
+      }
+    }
+  }
+
+  // gaussianBlur dispatches on sigma, in place
+  auto inPlace = image.clone();
+  painty::gaussianBlur(inPlace, inPlace, Sigma);
+  EXPECT_LT(cv::norm(inPlace, blurred, cv::NORM_INF), 1e-6);
+  painty::gaussianBlur(image, inPlace, 2.0);
+  cv::GaussianBlur(image, expected, cv::Size(-1, -1), 2.0, 0.0,
+                   cv::BORDER_REFLECT);
+  EXPECT_LT(cv::norm(inPlace, expected, cv::NORM_INF), 1e-6);
+
+  EXPECT_THROW(painty::recursiveGaussianBlur(image, blurred, 0.2),
+               std::invalid_argument);
+}
+
+TEST(RecursiveGaussianTest, PreservesConstants) {
+  const painty::Mat1d image(50, 70, 0.3);
+  painty::Mat1d blurred;
+  painty::recursiveGaussianBlur(image, blurred, 30.0);
+  for (const auto v : blurred) {
+    EXPECT_NEAR(v, 0.3, 1e-9);
+  }
+}
+
+TEST(RecursiveGaussianTest, Masked) {
+  // pixels outside the mask must not bleed into the masked area
+  painty::Mat3d image(120, 100, painty::vec3(1.0, 2.0, 3.0));
+  painty::Mat1d mask(image.size(), 1.0);
+  for (auto y = 0; y < image.rows; y++) {
+    for (auto x = 0; x < (image.cols / 2); x++) {
+      image(y, x) = {100.0, -50.0, 7.0};
+      mask(y, x)  = 0.0;
+    }
+  }
+  for (const auto sigma : {2.0, 20.0}) {
+    painty::Mat3d blurred;
+    painty::gaussianBlurMasked(image, mask, blurred, sigma);
+    for (auto y = 0; y < image.rows; y++) {
+      for (auto x = image.cols / 2; x < image.cols; x++) {
+        EXPECT_NEAR(blurred(y, x)[0U], 1.0, 1e-6);
+        EXPECT_NEAR(blurred(y, x)[1U], 2.0, 1e-6);
+        EXPECT_NEAR(blurred(y, x)[2U], 3.0, 1e-6);
+      }
+    }
+  }
+}
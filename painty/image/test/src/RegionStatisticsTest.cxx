@@ -0,0 +1,71 @@
+/**
+ * @file RegionStatisticsTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-24
+ *
+ */
+#include <cmath>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+#include "painty/image/RegionStatistics.hxx"
+#include "painty/image/Superpixel.hxx"
+
+TEST(RegionStatisticsTest, MatchesImageRegion) {
+  painty::Mat1i labels(45, 60);
+  painty::Mat1d scalar(labels.size());
+  painty::Mat3d color(labels.size());
+  for (auto y = 0; y < labels.rows; y++) {
+    for (auto x = 0; x < labels.cols; x++) {
+      labels(y, x) = ((x * y) % 13 == 0) ? -1 : ((x / 15) + 4 * (y / 15));
+      scalar(y, x) = std::sin(0.1 * x) - 0.02 * y;
+      color(y, x)  = painty::vec3(0.5 * x, y, std::cos(0.2 * (x + y)));
+    }
+  }
+  // label 12 is empty
+  const auto count   = 13;
+  const auto regions = painty::ExtractImageRegions(labels, count);
+
+  // the default, a single band, several bands and one band per row
+  for (const auto bandCount : {0, 1, 7, labels.rows}) {
+    const painty::RegionStatistics stats(labels, count, {scalar, color},
+                                         bandCount);
+    EXPECT_EQ(stats.labelCount(), count);
+    for (auto label = 0; label < count; label++) {
+      const auto& region = regions[static_cast<size_t>(label)];
+      EXPECT_EQ(stats.count(label), region.size());
+      if (region.empty()) {
+        EXPECT_NEAR(stats.rms(0U, label), 0.0, 1e-12);
+        EXPECT_NEAR(stats.mean(1U, label, 2), 0.0, 1e-12);
+        continue;
+      }
+      EXPECT_NEAR(stats.sum(0U, label, 0), region.computeSum(scalar), 1e-9);
+      EXPECT_NEAR(stats.mean(0U, label, 0), region.computeMean(scalar),
+                  1e-9);
+      EXPECT_NEAR(stats.rms(0U, label), region.computeRms(scalar), 1e-9);
+      EXPECT_NEAR(
+        (stats.mean<3>(1U, label) - region.computeMean(color)).norm(), 0.0,
+        1e-9);
+      auto squares = 0.0;
+      for (const auto& p : region) {
+        squares += color(p[1], p[0]).squaredNorm();
+      }
+      EXPECT_NEAR(stats.sumOfSquares(1U, label), squares, 1e-6);
+      EXPECT_NEAR(stats.rms(1U, label),
+                  std::sqrt(squares / static_cast<double>(region.size())),
+                  1e-9);
+    }
+    EXPECT_EQ(stats.count(12), 0UL);
+  }
+}
+
+TEST(RegionStatisticsTest, Invalid) {
+  const painty::Mat1i labels(4, 4, 0);
+  EXPECT_THROW(painty::RegionStatistics(labels, 1, {painty::Mat1f(4, 4)}),
+               std::invalid_argument);
+  EXPECT_THROW(painty::RegionStatistics(labels, 1, {painty::Mat1d(4, 5)}),
+               std::invalid_argument);
+}
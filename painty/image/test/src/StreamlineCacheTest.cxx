@@ -0,0 +1,69 @@
+/**
+ * @file StreamlineCacheTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-17
+ *
+ */
+#include "gtest/gtest.h"
+#include "painty/image/EdgeTangentFlow.hxx"
+#include "painty/image/FlowBasedDoG.hxx"
+#include "painty/image/StreamlineCache.hxx"
+
+TEST(StreamlineCacheTest, HorizontalFlow) {
+  const painty::Mat2d etf(20, 30, painty::vec2(1.0, 0.0));
+  const painty::StreamlineCache streamlines(etf, 6.0);
+  EXPECT_EQ(streamlines.getSize(), etf.size());
+  EXPECT_EQ(streamlines.getLength(), 6.0);
+
+  // steps from cell border to cell border, the last one reaches the length
+  const auto forward = streamlines.getSamples(
+    7, 10, painty::StreamlineCache::Direction::Forward);
+  ASSERT_EQ(forward.second - forward.first, 6);
+  for (auto i = 0; i < 6; i++) {
+    EXPECT_FLOAT_EQ(forward.first[i].x, 11.5F + static_cast<float>(i));
+    EXPECT_FLOAT_EQ(forward.first[i].y, 7.0F);
+    EXPECT_FLOAT_EQ(forward.first[i].arcLength, 1.5F + static_cast<float>(i));
+  }
+  const auto backward = streamlines.getSamples(
+    7, 10, painty::StreamlineCache::Direction::Backward);
+  ASSERT_EQ(backward.second - backward.first, 7);
+  EXPECT_FLOAT_EQ(backward.first[0].x, 9.5F);
+  EXPECT_FLOAT_EQ(backward.first[6].arcLength, 6.5F);
+}
+
+TEST(StreamlineCacheTest, SharedBySmoothing) {
+  painty::Mat1d image(40, 50);
+  painty::Mat2d etf(image.size());
+  for (auto y = 0; y < image.rows; y++) {
+    for (auto x = 0; x < image.cols; x++) {
+      image(y, x)  = std::sin(0.3 * x) * std::cos(0.2 * y);
+      const auto a = 0.05 * (x + y);
+      etf(y, x)    = {std::cos(a), std::sin(a)};
+    }
+  }
+
+  // streamlines of exactly the kernel support and longer ones agree
+  painty::Mat1d exact;
+  painty::FlowBasedDoG::smoothAlongFlow(
+    image, exact, painty::StreamlineCache(etf, 6.0), 3.0);
+
+  const painty::StreamlineCache streamlines(etf, 8.0);
+  painty::Mat1d cached;
+  painty::FlowBasedDoG::smoothAlongFlow(image, cached, streamlines, 3.0);
+  painty::Mat1d cachedSmaller;
+  painty::FlowBasedDoG::smoothAlongFlow(image, cachedSmaller, streamlines,
+                                        2.0);
+  ASSERT_EQ(exact.size(), image.size());
+  EXPECT_LT(cv::norm(exact, cached, cv::NORM_INF), 1e-6);
+  EXPECT_GT(cv::norm(cached, cachedSmaller, cv::NORM_INF), 0.0);
+
+  EXPECT_THROW(painty::FlowBasedDoG::smoothAlongFlow(image, cached,
+                                                     streamlines, 5.0),
+               std::invalid_argument);
+
+  const auto lic = painty::lineIntegralConv(streamlines, 3.0);
+  EXPECT_EQ(lic.size(), image.size());
+}
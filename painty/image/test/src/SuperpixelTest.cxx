@@ -7,6 +7,11 @@
  * @date 2020-08-26
  *
  */
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+
 #include "gtest/gtest.h"
 #include "painty/core/Color.hxx"
 #include "painty/image/Superpixel.hxx"
@@ -39,3 +44,181 @@ TEST(SuperPixelTest, SuperPixelExecuteTest) {
 
   // TODO load a segmented image and compare it to
 }
+
+TEST(SuperPixelTest, SlicFollowsEdges) {
+  // two flat halves, larger than an assignment tile
+  constexpr auto Rows = 150;
+  constexpr auto Cols = 200;
+  constexpr auto Edge = 110;
+  painty::Mat3d lab(Rows, Cols);
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      lab(y, x) = (x < Edge) ? painty::vec3(20.0, 5.0, 5.0)
+                             : painty::vec3(80.0, -5.0, 10.0);
+    }
+  }
+
+  painty::SuperpixelSegmentation segmentation;
+  segmentation.setExtractionStrategy(
+    painty::SuperpixelSegmentation::ExtractionStrategy::SLICO_GRID);
+  segmentation.extractWithDiff(lab, painty::Mat1d(lab.size(), 1.0),
+                               painty::Mat1d(), 20);
+  std::map<int32_t, painty::ImageRegion> regions;
+  const auto& labels = segmentation.getRegions(regions);
+
+  // every pixel is assigned and hardly any region crosses the edge
+  std::map<int32_t, std::pair<int32_t, int32_t>> sides;
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      ASSERT_GE(labels(y, x), 0);
+      auto& side = sides[labels(y, x)];
+      ((x < Edge) ? side.first : side.second)++;
+    }
+  }
+  auto crossing = 0;
+  for (const auto& side : sides) {
+    crossing += std::min(side.second.first, side.second.second);
+  }
+  EXPECT_LT(crossing, (Rows * Cols) / 100);
+}
+
+namespace {
+/**
+ * @brief Whether two labelings split the pixels of a rectangle equally.
+ *
+ */
+auto SamePartition(const painty::Mat1i& a, const painty::Mat1i& b,
+                   const cv::Rect& rect) -> bool {
+  for (auto y = rect.y; y < (rect.y + rect.height - 1); y++) {
+    for (auto x = rect.x; x < (rect.x + rect.width - 1); x++) {
+      if (((a(y, x) == a(y, x + 1)) != (b(y, x) == b(y, x + 1))) ||
+          ((a(y, x) == a(y + 1, x)) != (b(y, x) == b(y + 1, x)))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+}  // namespace
+
+TEST(SuperPixelTest, WarmStart) {
+  constexpr auto Rows = 160;
+  constexpr auto Cols = 300;
+  painty::Mat3d lab(Rows, Cols);
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      lab(y, x) = {50.0 + 30.0 * std::sin(x / 15.0) * std::cos(y / 20.0),
+                   20.0 * std::sin(y / 9.0), 10.0 * std::cos(x / 7.0)};
+    }
+  }
+  painty::Mat1d difference(lab.size(), 1.0);
+
+  painty::SuperpixelSegmentation segmentation;
+  segmentation.setExtractionStrategy(
+    painty::SuperpixelSegmentation::ExtractionStrategy::SLICO_GRID);
+  EXPECT_THROW(segmentation.updateWithDiff(difference, 0.5),
+               std::runtime_error);
+  segmentation.extractWithDiff(lab, difference, painty::Mat1d(), 20);
+  std::map<int32_t, painty::ImageRegion> regions;
+  const painty::Mat1i cold = segmentation.getRegions(regions).clone();
+
+  // nothing changed, nothing moves
+  segmentation.updateWithDiff(difference, 0.5);
+  const painty::Mat1i unchanged = segmentation.getRegions(regions).clone();
+  EXPECT_TRUE(SamePartition(cold, unchanged, cv::Rect(0, 0, Cols, Rows)));
+
+  // strokes landed on the left, the right keeps its superpixels
+  difference(cv::Rect(0, 0, 60, Rows)) = 10.0;
+  segmentation.updateWithDiff(difference, 0.5);
+  const painty::Mat1i warm = segmentation.getRegions(regions).clone();
+  for (const auto label : warm) {
+    EXPECT_GE(label, 0);
+  }
+  EXPECT_TRUE(SamePartition(cold, warm, cv::Rect(220, 0, Cols - 220, Rows)));
+}
+
+TEST(SuperPixelTest, ExtractImageRegions) {
+  painty::Mat1i labels(40, 50);
+  for (auto y = 0; y < labels.rows; y++) {
+    for (auto x = 0; x < labels.cols; x++) {
+      labels(y, x) = ((x + y) % 7 == 0) ? -1 : ((x / 10) + 5 * (y / 20));
+    }
+  }
+  // label 12 is out of range, labels 10 and 11 are empty
+  labels(0, 1)     = 12;
+  const auto count = 12;
+
+  const auto regions = painty::ExtractImageRegions(labels, count);
+  ASSERT_EQ(regions.size(), static_cast<size_t>(count));
+  auto total = 0UL;
+  for (auto label = 0; label < count; label++) {
+    const auto& region = regions[static_cast<size_t>(label)];
+    EXPECT_EQ(region.getLabel(), label);
+    EXPECT_TRUE(region.isActive());
+    const painty::ImageRegion scanned(label, labels);
+    EXPECT_EQ(region.size(), scanned.size());
+    for (const auto& p : region) {
+      EXPECT_EQ(labels(p[1], p[0]), label);
+    }
+    total += region.size();
+  }
+  EXPECT_TRUE(regions[10U].empty());
+  EXPECT_TRUE(regions[11U].empty());
+  EXPECT_EQ(regions[0U].getBoundingRectangle(), cv::Rect2i(0, 0, 10, 20));
+
+  auto outside = 0UL;
+  for (const auto label : labels) {
+    outside += ((label < 0) || (label >= count)) ? 1UL : 0UL;
+  }
+  EXPECT_EQ(total + outside, labels.total());
+}
+
+TEST(SuperPixelTest, InscribedCircles) {
+  painty::Mat1i labels(36, 48, 0);
+  for (auto y = 0; y < labels.rows; y++) {
+    for (auto x = 0; x < labels.cols; x++) {
+      const auto dx = x - 30;
+      const auto dy = y - 17;
+      if ((dx * dx + dy * dy) <= 100) {
+        labels(y, x) = 1;
+      } else if ((x < 12) && (y > 20)) {
+        labels(y, x) = 2;
+      } else if (((x * 7 + y * 3) % 11) == 0) {
+        labels(y, x) = -1;
+      }
+    }
+  }
+
+  // brute force distances to the pixels of other labels and the border
+  const auto distances = painty::ComputeLabelDistances(labels);
+  for (auto y = 0; y < labels.rows; y++) {
+    for (auto x = 0; x < labels.cols; x++) {
+      auto expected = std::min(std::min(x + 1, labels.cols - x),
+                               std::min(y + 1, labels.rows - y));
+      expected *= expected;
+      for (auto j = 0; j < labels.rows; j++) {
+        for (auto i = 0; i < labels.cols; i++) {
+          if (labels(j, i) != labels(y, x)) {
+            expected =
+              std::min(expected, (i - x) * (i - x) + (j - y) * (j - y));
+          }
+        }
+      }
+      EXPECT_NEAR(distances(y, x), static_cast<double>(expected), 1e-9);
+    }
+  }
+
+  const auto circles = painty::ComputeInscribedCircles(labels, 4);
+  ASSERT_EQ(circles.size(), 4UL);
+  EXPECT_NEAR(circles[1U].center[0], 30.0, 1e-9);
+  EXPECT_NEAR(circles[1U].center[1], 17.0, 1e-9);
+  EXPECT_NEAR(circles[1U].radius, std::sqrt(101.0) - 1.0, 1e-9);
+  EXPECT_NEAR(circles[2U].radius, 5.0, 1e-9);
+  EXPECT_NEAR(circles[3U].radius, 0.0, 1e-9);
+
+  // the region's own query agrees with the label map query
+  const painty::ImageRegion region(2, labels);
+  painty::vec2 incenter = painty::vec2::Zero();
+  EXPECT_NEAR(region.getInscribedCircle(incenter), circles[2U].radius, 1e-9);
+  EXPECT_NEAR((incenter - circles[2U].center).norm(), 0.0, 1e-9);
+}
@@ -0,0 +1,42 @@
+/**
+ * @file TensorScaleSpaceTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-18
+ *
+ */
+#include "gtest/gtest.h"
+#include "painty/image/EdgeTangentFlow.hxx"
+#include "painty/image/TensorScaleSpace.hxx"
+#include "painty/io/ImageIO.hxx"
+
+TEST(TensorScaleSpaceTest, MatchesDirectComputation) {
+  painty::Mat3d image;
+  painty::io::imRead("./data/test_images/field.jpg", image, true);
+  image = painty::ScaledMat(image, image.rows / 4, image.cols / 4);
+  const auto lab = painty::convertColor(
+    image, painty::ColorConverter<double>::Conversion::rgb_2_CIELab);
+  painty::Mat1d mask(lab.size(), 1.0);
+  mask(cv::Rect(0, 0, mask.cols / 3, mask.rows / 3)) = 0.0;
+
+  for (const auto& m : {painty::Mat1d(), mask}) {
+    painty::TensorScaleSpace scaleSpace(lab, m);
+    EXPECT_EQ(scaleSpace.getLevelCount(), 1UL);
+    scaleSpace.addLevels({4.0, 1.0, 2.0});
+    EXPECT_EQ(scaleSpace.getLevelCount(), 4UL);
+
+    // descending like the brush sizes, 3 is added from 2
+    for (const auto sigma : {4.0, 3.0, 2.0, 1.0, 0.0}) {
+      const auto expected =
+        painty::tensor::ComputeTensors(lab, m, 0.0, sigma);
+      const auto tensors = scaleSpace.getTensors(sigma);
+      ASSERT_EQ(tensors.size(), expected.size());
+      for (auto i = 0; i < static_cast<int32_t>(tensors.total()); i++) {
+        EXPECT_LT((tensors(i) - expected(i)).cwiseAbs().maxCoeff(), 5e-3);
+      }
+    }
+    EXPECT_EQ(scaleSpace.getLevelCount(), 5UL);
+  }
+}
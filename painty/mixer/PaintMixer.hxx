@@ -21,7 +21,7 @@ namespace painty {
  */
 class PaintMixer {
  public:
-  PaintMixer(const Palette& basePalette);
+  PaintMixer(const Palette& basePalette, uint32_t solverThreads = 0U);
 
   auto mixFromInputPicture(const Mat<vec3>& sRGBPicture, uint32_t count) const
     -> Palette;
@@ -54,6 +54,13 @@ class PaintMixer {
    *
    */
   Palette _basePalette;
+
+  /**
+   * @brief Threads used by each solve, one per hardware thread if 0. Set to 1
+   * when the mixer is used from multiple threads already.
+   *
+   */
+  uint32_t _solverThreads = 0U;
 };
 
 }  // namespace painty
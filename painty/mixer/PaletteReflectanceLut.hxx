@@ -0,0 +1,86 @@
+/**
+ * @file PaletteReflectanceLut.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-30
+ *
+ */
+#pragma once
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#include "painty/core/Vec.hxx"
+#include "painty/mixer/Palette.hxx"
+
+namespace painty {
+/**
+ * @brief The CIELab colors of all paints of a palette applied at a fixed
+ * thickness over a grid of substrate reflectances R0 in [0, 1]^3.
+ *
+ * The nodes along each channel are spaced quadratically, (i / (n - 1))^2, so
+ * that dark substrates, where CIELab changes fastest, get the most nodes.
+ * The colors of a grid node are stored channel by channel, each channel holds
+ * the values of all paints contiguously, so the distance search over the
+ * paints reads the eight nodes around R0 as contiguous rows and allocates
+ * nothing.
+ *
+ */
+class PaletteReflectanceLut {
+ public:
+  static constexpr auto DefaultResolution = 17;
+
+  /**
+   * @brief Construct a new Palette Reflectance Lut object
+   *
+   * @param palette the paints
+   * @param thickness the layer thickness of the paints
+   * @param resolution number of grid nodes per channel of R0, at least 2
+   */
+  PaletteReflectanceLut(const Palette& palette, double thickness,
+                        int32_t resolution = DefaultResolution);
+
+  auto size() const -> size_t;
+
+  /**
+   * @brief Trilinearly interpolated CIELab color of a paint over R0.
+   *
+   * @param R0 linear rgb substrate reflectance, clamped to [0, 1]
+   */
+  auto lookup(const vec3& R0, size_t paint) const -> vec3;
+
+  /**
+   * @brief The paint whose color over R0 is closest to the target.
+   *
+   * @param targetLab target color in CIELab
+   * @param R0 linear rgb substrate reflectance
+   * @param R0_Lab the substrate in CIELab, callers usually have it at hand
+   * @return std::nullopt if no paint is closer to the target than R0
+   */
+  auto findBestPaintIndex(const vec3& targetLab, const vec3& R0,
+                          const vec3& R0_Lab) const -> std::optional<size_t>;
+
+ private:
+  /**
+   * @brief The eight grid nodes around R0 and their trilinear weights.
+   *
+   */
+  struct Cell {
+    std::array<const double*, 8U> nodes = {};
+    std::array<double, 8U> weights      = {};
+  };
+
+  auto cell(const vec3& R0) const -> Cell;
+
+  size_t _paintCount  = 0UL;
+  int32_t _resolution = DefaultResolution;
+
+  /**
+   * @brief Index ((node * 3) + channel) * paints + paint, nodes ordered by
+   * blue, green and red.
+   *
+   */
+  std::vector<double> _lab;
+};
+}  // namespace painty
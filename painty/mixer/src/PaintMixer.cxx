@@ -10,6 +10,7 @@
 
 #include <ceres/ceres.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <stdexcept>
 #include <thread>
@@ -281,9 +282,15 @@ static constexpr auto Eps = 10e-6;
  * @brief Construct a new Paint Mixer::Paint Mixer object
  *
  * @param basePalette the underlying base palette.
+ * @param solverThreads threads used by each solve, one per hardware thread
+ * if 0.
  */
-PaintMixer::PaintMixer(const Palette& basePalette)
-    : _basePalette(basePalette) {}
+PaintMixer::PaintMixer(const Palette& basePalette,
+                       const uint32_t solverThreads)
+    : _basePalette(basePalette),
+      _solverThreads((solverThreads > 0U)
+                       ? solverThreads
+                       : std::max(std::thread::hardware_concurrency(), 1U)) {}
 
 /**
  * @brief Mix a palette from an input RGB image. The image is analyzed using a
@@ -399,8 +406,7 @@ auto PaintMixer::getWeightsForMixingTargetPaint(const PaintCoeff& paint) const
 
   ::ceres::Solver::Options options;
   // options.minimizer_progress_to_stdout = true;
-  const auto nThreads =
-    static_cast<int32_t>(std::thread::hardware_concurrency());
+  const auto nThreads               = static_cast<int32_t>(_solverThreads);
   options.num_threads               = nThreads;
   options.num_linear_solver_threads = nThreads;
   options.max_num_iterations        = 1000;
@@ -490,8 +496,7 @@ auto PaintMixer::getMixtureWeightsForReflectance(
 
   ::ceres::Solver::Options options;
   // options.minimizer_progress_to_stdout = true;
-  const auto nThreads =
-    static_cast<int32_t>(std::thread::hardware_concurrency());
+  const auto nThreads               = static_cast<int32_t>(_solverThreads);
   options.num_threads               = nThreads;
   options.num_linear_solver_threads = nThreads;
   options.max_num_iterations        = 1000;
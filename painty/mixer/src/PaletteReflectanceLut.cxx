@@ -0,0 +1,136 @@
+/**
+ * @file PaletteReflectanceLut.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-30
+ *
+ */
+#include "painty/mixer/PaletteReflectanceLut.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "painty/core/Color.hxx"
+#include "painty/core/KubelkaMunk.hxx"
+
+namespace painty {
+
+PaletteReflectanceLut::PaletteReflectanceLut(const Palette& palette,
+                                             const double thickness,
+                                             const int32_t resolution)
+    : _paintCount(palette.size()), _resolution(resolution) {
+  if (resolution < 2) {
+    throw std::invalid_argument("PaletteReflectanceLut resolution < 2");
+  }
+  const auto axis  = static_cast<size_t>(_resolution);
+  const auto scale = 1.0 / static_cast<double>(_resolution - 1);
+  _lab = std::vector<double>(axis * axis * axis * 3UL * _paintCount, 0.0);
+
+  // quadratic node spacing, see cell()
+  const auto value = [scale](const int32_t i) {
+    const auto u = static_cast<double>(i) * scale;
+    return u * u;
+  };
+  ColorConverter<double> converter;
+  for (auto b = 0; b < _resolution; b++) {
+    for (auto g = 0; g < _resolution; g++) {
+      for (auto r = 0; r < _resolution; r++) {
+        const vec3 R0(value(r), value(g), value(b));
+        const auto node =
+          (static_cast<size_t>(b) * axis + static_cast<size_t>(g)) * axis +
+          static_cast<size_t>(r);
+        for (size_t i = 0UL; i < _paintCount; i++) {
+          vec3 lab;
+          converter.rgb2lab(
+            ComputeReflectance(palette[i].K, palette[i].S, R0, thickness),
+            lab);
+          for (auto c = 0U; c < 3U; c++) {
+            _lab[(node * 3UL + c) * _paintCount + i] = lab[c];
+          }
+        }
+      }
+    }
+  }
+}
+
+auto PaletteReflectanceLut::size() const -> size_t {
+  return _paintCount;
+}
+
+auto PaletteReflectanceLut::cell(const vec3& R0) const -> Cell {
+  // cell and position in the cell along each axis, the nodes are uniform in
+  // the square root of R0
+  std::array<size_t, 3U> index  = {};
+  std::array<double, 3U> offset = {};
+  for (auto a = 0U; a < 3U; a++) {
+    const auto t = std::sqrt(std::clamp(R0[a], 0.0, 1.0)) *
+                   static_cast<double>(_resolution - 1);
+    const auto i =
+      std::min(static_cast<int32_t>(std::floor(t)), _resolution - 2);
+    index[a]  = static_cast<size_t>(i);
+    offset[a] = t - static_cast<double>(i);
+  }
+
+  const auto axis   = static_cast<size_t>(_resolution);
+  const auto stride = 3UL * _paintCount;
+  Cell result;
+  for (auto corner = 0U; corner < 8U; corner++) {
+    const auto dr = corner & 1U;
+    const auto dg = (corner >> 1U) & 1U;
+    const auto db = (corner >> 2U) & 1U;
+    const auto node =
+      ((index[2U] + db) * axis + (index[1U] + dg)) * axis + (index[0U] + dr);
+    result.nodes[corner]   = _lab.data() + node * stride;
+    result.weights[corner] = ((dr != 0U) ? offset[0U] : (1.0 - offset[0U])) *
+                             ((dg != 0U) ? offset[1U] : (1.0 - offset[1U])) *
+                             ((db != 0U) ? offset[2U] : (1.0 - offset[2U]));
+  }
+  return result;
+}
+
+auto PaletteReflectanceLut::lookup(const vec3& R0, const size_t paint) const
+  -> vec3 {
+  if (paint >= _paintCount) {
+    throw std::out_of_range("PaletteReflectanceLut paint out of range");
+  }
+  const auto around = cell(R0);
+  vec3 lab          = vec3::Zero();
+  for (auto c = 0U; c < 3U; c++) {
+    const auto k = c * _paintCount + paint;
+    for (auto corner = 0U; corner < 8U; corner++) {
+      lab[c] += around.weights[corner] * around.nodes[corner][k];
+    }
+  }
+  return lab;
+}
+
+auto PaletteReflectanceLut::findBestPaintIndex(const vec3& targetLab,
+                                               const vec3& R0,
+                                               const vec3& R0_Lab) const
+  -> std::optional<size_t> {
+  const auto around = cell(R0);
+
+  auto d = (R0_Lab - targetLab).squaredNorm();
+
+  std::optional<size_t> bestIndex = std::nullopt;
+  for (size_t i = 0UL; i < _paintCount; i++) {
+    auto distance = 0.0;
+    for (auto c = 0U; c < 3U; c++) {
+      const auto k = c * _paintCount + i;
+      auto value   = 0.0;
+      for (auto corner = 0U; corner < 8U; corner++) {
+        value += around.weights[corner] * around.nodes[corner][k];
+      }
+      const auto delta = value - targetLab[c];
+      distance += delta * delta;
+    }
+    if (distance < d) {
+      d         = distance;
+      bestIndex = i;
+    }
+  }
+  return bestIndex;
+}
+
+}  // namespace painty
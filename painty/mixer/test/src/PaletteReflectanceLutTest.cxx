@@ -0,0 +1,98 @@
+/**
+ * @file PaletteReflectanceLutTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-30
+ *
+ */
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+#include "painty/core/Color.hxx"
+#include "painty/core/KubelkaMunk.hxx"
+#include "painty/mixer/PaletteReflectanceLut.hxx"
+
+namespace {
+auto ExactLab(const painty::PaintCoeff& paint, const painty::vec3& R0,
+              const double thickness) -> painty::vec3 {
+  painty::ColorConverter<double> converter;
+  painty::vec3 lab;
+  converter.rgb2lab(
+    painty::ComputeReflectance(paint.K, paint.S, R0, thickness), lab);
+  return lab;
+}
+}  // namespace
+
+TEST(PaletteReflectanceLutTest, MatchesKubelkaMunk) {
+  // paints of Curtis et al. 1997
+  painty::Palette palette = {};
+  palette.push_back({{0.22, 1.47, 0.57}, {0.05, 0.003, 0.03}});
+  palette.push_back({{0.46, 1.07, 1.50}, {1.28, 0.38, 0.21}});
+  palette.push_back({{0.10, 0.36, 3.45}, {0.97, 0.65, 0.007}});
+  palette.push_back({{1.52, 0.32, 0.25}, {0.06, 0.26, 0.40}});
+  constexpr auto thickness = 1.0;
+
+  EXPECT_THROW(painty::PaletteReflectanceLut(palette, thickness, 1),
+               std::invalid_argument);
+
+  // exact at the grid nodes, spaced quadratically
+  const painty::PaletteReflectanceLut coarse(palette, thickness, 5);
+  EXPECT_EQ(coarse.size(), palette.size());
+  const painty::vec3 node(0.0625, 0.5625, 1.0);
+  for (size_t i = 0; i < palette.size(); i++) {
+    EXPECT_NEAR(
+      (coarse.lookup(node, i) - ExactLab(palette[i], node, thickness)).norm(),
+      0.0, 1e-9);
+  }
+  EXPECT_THROW(coarse.lookup(node, palette.size()), std::out_of_range);
+
+  const painty::PaletteReflectanceLut lut(palette, thickness);
+  std::default_random_engine generator;
+  std::uniform_real_distribution<double> reflectance(0.0, 1.0);
+  std::uniform_real_distribution<double> dark(0.0, 0.05);
+  std::uniform_real_distribution<double> ab(-60.0, 60.0);
+  std::uniform_real_distribution<double> lightness(20.0, 90.0);
+  painty::ColorConverter<double> converter;
+  for (auto n = 0; n < 400; n++) {
+    // half of the samples on dark substrates, where CIELab is steepest
+    auto& channel = (n % 2 == 0) ? reflectance : dark;
+    const painty::vec3 R0(channel(generator), channel(generator),
+                          channel(generator));
+    const painty::vec3 target(lightness(generator), ab(generator),
+                              ab(generator));
+
+    // brute force search with a margin for the interpolation error
+    painty::vec3 R0_Lab;
+    converter.rgb2lab(R0, R0_Lab);
+    auto best       = (R0_Lab - target).norm();
+    auto secondBest = std::numeric_limits<double>::max();
+    auto bestIndex  = palette.size();
+    for (size_t i = 0; i < palette.size(); i++) {
+      const auto exact = ExactLab(palette[i], R0, thickness);
+      EXPECT_NEAR((lut.lookup(R0, i) - exact).norm(), 0.0, 0.3);
+
+      const auto d = (exact - target).norm();
+      if (d < best) {
+        secondBest = best;
+        best       = d;
+        bestIndex  = i;
+      } else if (d < secondBest) {
+        secondBest = d;
+      }
+    }
+    if ((secondBest - best) < 1.0) {
+      continue;
+    }
+    const auto index = lut.findBestPaintIndex(target, R0, R0_Lab);
+    if (bestIndex == palette.size()) {
+      EXPECT_FALSE(index.has_value());
+    } else {
+      ASSERT_TRUE(index.has_value());
+      EXPECT_EQ(index.value(), bestIndex);
+    }
+  }
+}
@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "painty/core/Vec.hxx"
@@ -21,12 +23,57 @@ class BrushStrokeSample final {
   BrushStrokeSample();
   BrushStrokeSample(const std::string& sampleDir);
 
+  /**
+   * @brief The sample of a directory, loaded once per process and shared
+   * between all callers. Thread safe.
+   *
+   * @param sampleDir
+   * @return std::shared_ptr<const BrushStrokeSample>
+   */
+  static std::shared_ptr<const BrushStrokeSample> Get(
+    const std::string& sampleDir);
+
   const Mat<double>& getThicknessMap() const;
   void setThicknessMap(const Mat<double>& thicknessMap);
 
+  /**
+   * @brief The thickness map as float, each further level halves the
+   * resolution by averaging, down to a single row or column.
+   *
+   * @param level 0 for full resolution.
+   */
+  const Mat1f& getThicknessMip(uint32_t level) const;
+  uint32_t getThicknessMipCount() const;
+
+  /**
+   * @brief Sample the thickness using the mip chain, fractional levels blend
+   * the adjacent levels.
+   *
+   * @param uv texture coordinates normalized to [0, 1].
+   * @param lod level of detail, 0 for full resolution.
+   */
+  double getThicknessAt(const vec2& uv, double lod) const;
+
+  /**
+   * @brief The level of detail at which a texel covers about one pixel when
+   * mapping the texture onto a stroke.
+   *
+   * @param strokeLength in pixels.
+   * @param strokeWidth in pixels.
+   */
+  double getLod(double strokeLength, double strokeWidth) const;
+
   double getSampleAt(const vec2& xy) const;
   double getSampleAtUV(const vec2& uv) const;
 
+  /**
+   * @brief Warp a stroke coordinate to texture coordinates, interpolated from
+   * a precomputed grid inside the parameter domain.
+   *
+   * @param uv u in [0, 1], v in [-1, 1]
+   */
+  vec2 warpUV(const vec2& uv) const;
+
   void loadSample(const std::string& sampleDir);
 
   double getWidth() const;
@@ -35,10 +82,19 @@ class BrushStrokeSample final {
   void generateFromTexture(const Mat1d& texture);
 
  private:
+  static constexpr int32_t WarpGridCols = 128;
+  static constexpr int32_t WarpGridRows = 33;
+
   void createWarper();
 
+  void createThicknessMips();
+
+  double getMipSample(uint32_t level, const vec2& uv) const;
+
   Mat<double> _thickness_map;
 
+  std::vector<Mat1f> _thicknessMips;
+
   // texture coordinates
   std::vector<vec2> _txy_l;
   std::vector<vec2> _txy_c;
@@ -54,6 +110,12 @@ class BrushStrokeSample final {
    */
   TextureWarp _warper;
 
+  /**
+   * @brief _warper evaluated at a regular grid of the parameter domain.
+   *
+   */
+  Mat<vec2> _warpGrid;
+
   double _widthMax = 0.0;
   double _length   = 0.0;
 };
@@ -154,7 +154,7 @@ class Canvas final {
     _timeMap[static_cast<size_t>(y * _h_buffer.cols + x)] = timePoint;
   }
 
-  std::chrono::milliseconds getDryingTime() {
+  std::chrono::milliseconds getDryingTime() const {
     return _dryingTime;
   }
 
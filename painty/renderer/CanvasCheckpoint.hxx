@@ -0,0 +1,215 @@
+/**
+ * @file CanvasCheckpoint.hxx
+ * @author Thomas Lindemeier
+ * @brief Versioned binary checkpoints of the canvas state.
+ *
+ * A checkpoint consists of a 64 byte file header, a table of 64 byte buffer
+ * headers and the buffer payloads. Uncompressed payloads are stored row major
+ * at page aligned offsets in host byte order, so they can be mapped into
+ * memory and wrapped by Mat headers without copying. Compressed payloads are
+ * split into square tiles that are deflated independently and are preceded by
+ * a table of tile offsets, hence a region can be read without inflating the
+ * whole buffer.
+ *
+ * @date 2020-11-09
+ *
+ */
+#pragma once
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "painty/core/Types.hxx"
+#include "painty/core/Vec.hxx"
+#include "painty/image/Mat.hxx"
+
+namespace painty {
+
+template <class vector_type>
+class Canvas;
+class CanvasCpu;
+class CanvasGpu;
+
+/**
+ * @brief Read only view of a checkpoint file. The file is mapped into memory
+ * copy-on-write, buffers returned by this class may be modified without
+ * affecting the file, but must not outlive the checkpoint object.
+ *
+ */
+class CanvasCheckpoint final {
+ public:
+  /**
+   * @brief The buffer layout of the canvas that was saved.
+   *
+   */
+  enum class Layout : uint32_t {
+    /**
+     * @brief Canvas<vec3>: R0, h, K, S, V and the drying time map t.
+     *
+     */
+    Host = 0U,
+    /**
+     * @brief CanvasCpu and CanvasGpu: R0, K and S with four float channels,
+     * the volume stored as alpha.
+     *
+     */
+    Shader = 1U
+  };
+
+  enum class Compression : uint32_t { None = 0U, Zlib = 1U };
+
+  static constexpr uint32_t Version         = 1U;
+  static constexpr int32_t DefaultTileSize = 256;
+
+  explicit CanvasCheckpoint(const std::string& filename);
+
+  CanvasCheckpoint(const CanvasCheckpoint&) = delete;
+  CanvasCheckpoint& operator=(const CanvasCheckpoint&) = delete;
+
+  ~CanvasCheckpoint();
+
+  auto getVersion() const -> uint32_t;
+
+  auto getLayout() const -> Layout;
+
+  auto getSize() const -> Size;
+
+  auto getTileSize() const -> int32_t;
+
+  auto getDryingTime() const -> std::chrono::milliseconds;
+
+  /**
+   * @brief Point in time the checkpoint was written.
+   *
+   */
+  auto getTimestamp() const -> std::chrono::system_clock::time_point;
+
+  auto getBufferNames() const -> std::vector<std::string>;
+
+  auto hasBuffer(const std::string& name) const -> bool;
+
+  auto getCompression(const std::string& name) const -> Compression;
+
+  /**
+   * @brief Access a buffer. Uncompressed buffers are returned as header
+   * pointing into the mapped file, compressed buffers are inflated.
+   *
+   * @param name
+   * @return cv::Mat
+   */
+  auto getBuffer(const std::string& name) const -> cv::Mat;
+
+  /**
+   * @brief Access a region of a buffer. Only the tiles intersecting the region
+   * get inflated for compressed buffers.
+   *
+   * @param name
+   * @param roi the region, must be inside the canvas.
+   * @return cv::Mat
+   */
+  auto getBuffer(const std::string& name, const cv::Rect& roi) const
+    -> cv::Mat;
+
+  /**
+   * @brief Typed access to a buffer.
+   *
+   * @throws std::invalid_argument if the stored type does not match T.
+   */
+  template <class T>
+  auto get(const std::string& name) const -> Mat<T> {
+    const auto buffer = getBuffer(name);
+    if (buffer.type() != cv::DataType<T>::type) {
+      throw std::invalid_argument("checkpoint buffer type mismatch: " + name);
+    }
+    return Mat<T>(buffer);
+  }
+
+ private:
+  struct BufferInfo {
+    std::string name;
+    int32_t type;
+    Compression compression;
+    uint64_t offset;
+    uint64_t storedBytes;
+  };
+
+  auto findBuffer(const std::string& name) const -> const BufferInfo&;
+
+  auto inflateRegion(const BufferInfo& info, const cv::Rect& roi) const
+    -> cv::Mat;
+
+  std::string _filename;
+
+  uint8_t* _data = nullptr;
+  std::size_t _length = 0UL;
+
+  uint32_t _version = 0U;
+  Layout _layout    = Layout::Host;
+  Size _size        = {};
+  int32_t _tileSize = DefaultTileSize;
+  std::chrono::milliseconds _dryingTime = {};
+  std::chrono::system_clock::time_point _timestamp = {};
+
+  std::vector<BufferInfo> _buffers;
+};
+
+/**
+ * @brief Collects buffers and writes them as checkpoint. The file is written
+ * to a temporary next to the target and renamed afterwards, so a crash while
+ * saving does not destroy the previous checkpoint.
+ *
+ */
+class CanvasCheckpointWriter final {
+ public:
+  CanvasCheckpointWriter(const Size& size, CanvasCheckpoint::Layout layout);
+
+  void setDryingTime(std::chrono::milliseconds dryingTime);
+
+  /**
+   * @brief Add a buffer of the canvas size. The data is referenced, not
+   * copied, until write is called.
+   *
+   * @param name at most 15 characters.
+   * @param buffer
+   */
+  void addBuffer(const std::string& name, const cv::Mat& buffer);
+
+  void write(const std::string& filename,
+             CanvasCheckpoint::Compression compression =
+               CanvasCheckpoint::Compression::None,
+             int32_t tileSize = CanvasCheckpoint::DefaultTileSize) const;
+
+ private:
+  Size _size;
+  CanvasCheckpoint::Layout _layout;
+  std::chrono::milliseconds _dryingTime = {};
+  std::vector<std::pair<std::string, cv::Mat>> _buffers;
+};
+
+void SaveCheckpoint(const std::string& filename, const Canvas<vec3>& canvas,
+                    CanvasCheckpoint::Compression compression =
+                      CanvasCheckpoint::Compression::None);
+
+/**
+ * @brief Restore a canvas. The drying state is restored relative to the
+ * current time, i.e. the time between saving and loading does not count.
+ *
+ */
+void LoadCheckpoint(const std::string& filename, Canvas<vec3>& canvas);
+
+void SaveCheckpoint(const std::string& filename, CanvasCpu& canvas,
+                    CanvasCheckpoint::Compression compression =
+                      CanvasCheckpoint::Compression::None);
+
+void LoadCheckpoint(const std::string& filename, CanvasCpu& canvas);
+
+void SaveCheckpoint(const std::string& filename, CanvasGpu& canvas,
+                    CanvasCheckpoint::Compression compression =
+                      CanvasCheckpoint::Compression::None);
+
+void LoadCheckpoint(const std::string& filename, CanvasGpu& canvas);
+
+}  // namespace painty
@@ -0,0 +1,72 @@
+/**
+ * @file CanvasCpu.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-02
+ *
+ */
+#pragma once
+
+#include "painty/core/Vec.hxx"
+#include "painty/image/Mat.hxx"
+
+namespace painty {
+/**
+ * @brief Host side counterpart of CanvasGpu. Uses the same buffer layout and
+ * evaluates the shader kernels tile wise on the default thread pool, hence no
+ * opengl context is required.
+ *
+ */
+class CanvasCpu final {
+ public:
+  CanvasCpu(const Size& size);
+
+  CanvasCpu(const CanvasCpu&) = delete;
+  CanvasCpu& operator=(const CanvasCpu&) = delete;
+
+  auto getSize() const -> const Size&;
+
+  void clear();
+
+  /**
+   * @brief Replace the substrate reflectance, e.g. with a uniform color.
+   *
+   * @param r0 linear rgb reflectance of the canvas size.
+   */
+  void setSubstrate(const Mat3d& r0);
+
+  /**
+   * @brief Absorption of the wet paint layer, volume stored as alpha.
+   *
+   */
+  auto getK() -> Mat4f&;
+
+  /**
+   * @brief Scattering of the wet paint layer, the alpha holds the volume
+   * applied by the latest imprint.
+   *
+   */
+  auto getS() -> Mat4f&;
+
+  /**
+   * @brief Reflectance of the dried paint, alpha is unused.
+   *
+   */
+  auto getSubstrate() -> Mat4f&;
+
+  auto getComposed() -> const Mat4f&;
+
+  auto getCompositionLinearRgb() -> Mat3d;
+
+  void dryStep(float step = 0.01F);
+
+ private:
+  Size _size;
+
+  Mat4f _K;
+  Mat4f _S;
+
+  Mat4f _r0_substrate;
+  Mat4f _r0_substrate_copy_buffer;
+};
+}  // namespace painty
@@ -22,6 +22,8 @@ class CanvasGpu final {
 
   auto getPaintLayer() -> PaintLayerGpu&;
 
+  auto getSubstrate() -> GpuMat<vec4f>&;
+
   auto getComposed() -> const GpuMat<vec4f>&;
 
   auto getCompositionLinearRgb() -> Mat3d;
@@ -0,0 +1,456 @@
+/**
+ * @file CanvasHistory.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-05
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "painty/renderer/Canvas.hxx"
+
+namespace painty {
+/**
+ * @brief Tile based undo/redo history of a canvas.
+ *
+ * Modifications are recorded as the tiles they touched only. Snapshots of a
+ * tile are immutable and shared between consecutive entries (copy-on-write),
+ * the state after one stroke is the state before the next one touching that
+ * tile. Entries are kept in a ring buffer bounded by a memory budget, the
+ * oldest entries are dropped first. A step that can't fit into the budget on
+ * its own is not recorded and acts as a barrier nothing can be undone across.
+ *
+ * All modifications of the canvas must be announced using markDirty() before
+ * they happen and finished by commit().
+ */
+template <class vector_type>
+class CanvasHistory final {
+  using T         = typename DataType<vector_type>::channel_type;
+  using TimePoint = std::chrono::system_clock::time_point;
+
+  /**
+   * @brief Copy of all canvas buffers inside a tile.
+   *
+   */
+  struct TileSnapshot {
+    Mat<vector_type> K;
+    Mat<vector_type> S;
+    Mat<T> V;
+    Mat<vector_type> R0;
+    Mat<T> h;
+    std::vector<TimePoint> timeMap;
+
+    auto bytes() const -> std::size_t {
+      return (K.total() + S.total() + R0.total()) * sizeof(vector_type) +
+             (V.total() + h.total()) * sizeof(T) +
+             timeMap.size() * sizeof(TimePoint);
+    }
+  };
+
+  using SnapshotPtr = std::shared_ptr<const TileSnapshot>;
+
+  struct TileChange {
+    int32_t tileIndex;
+    SnapshotPtr before;
+    SnapshotPtr after;
+  };
+
+  using Entry = std::vector<TileChange>;
+
+ public:
+  static constexpr std::size_t DefaultMemoryBudget = 256UL * 1024UL * 1024UL;
+  static constexpr int32_t DefaultTileSize         = 64;
+
+  /**
+   * @brief Construct a new history for a canvas.
+   *
+   * @param canvas the canvas to record, must outlive the history.
+   * @param memoryBudget maximum number of bytes held by snapshots.
+   * @param tileSize edge length of the square tiles in pixels.
+   */
+  CanvasHistory(Canvas<vector_type>& canvas,
+                const std::size_t memoryBudget = DefaultMemoryBudget,
+                const int32_t tileSize         = DefaultTileSize)
+      : _canvas(canvas),
+        _tileSize(tileSize),
+        _tilesX(TileCount(canvas.getPaintLayer().getCols(), tileSize)),
+        _tilesY(TileCount(canvas.getPaintLayer().getRows(), tileSize)),
+        _memoryBudget(memoryBudget),
+        _memoryUsed(std::make_shared<std::size_t>(0UL)),
+        _latest(static_cast<size_t>(_tilesX * _tilesY)),
+        _pending(static_cast<size_t>(_tilesX * _tilesY)) {}
+
+  CanvasHistory(const CanvasHistory&) = delete;
+  CanvasHistory& operator=(const CanvasHistory&) = delete;
+
+  /**
+   * @brief Announce that a region of the canvas is about to be modified. The
+   * tiles are captured the first time they get marked within a commit.
+   * Nothing is captured anymore once the step outgrew the memory budget.
+   *
+   * @param region in canvas pixels, clipped to the canvas.
+   */
+  void markDirty(const cv::Rect& region) {
+    const auto clipped =
+      region & cv::Rect(0, 0, _canvas.getPaintLayer().getCols(),
+                        _canvas.getPaintLayer().getRows());
+    if (clipped.empty() || _unrecorded) {
+      return;
+    }
+    const auto tx0 = clipped.x / _tileSize;
+    const auto ty0 = clipped.y / _tileSize;
+    const auto tx1 = (clipped.x + clipped.width - 1) / _tileSize;
+    const auto ty1 = (clipped.y + clipped.height - 1) / _tileSize;
+
+    // the states before and after of all tiles of the step must fit at once
+    auto marked = std::vector<int32_t>();
+    auto bytes  = _pendingBytes;
+    for (auto ty = ty0; ty <= ty1; ty++) {
+      for (auto tx = tx0; tx <= tx1; tx++) {
+        const auto index = ty * _tilesX + tx;
+        if (_pending[static_cast<size_t>(index)] == nullptr) {
+          marked.push_back(index);
+          bytes += 2UL * SnapshotBytes(tileRect(index));
+        }
+      }
+    }
+    if (bytes > _memoryBudget) {
+      dropPending();
+      _unrecorded = true;
+      return;
+    }
+    _pendingBytes = bytes;
+
+    for (const auto index : marked) {
+      // share the snapshot committed last if it still exists
+      auto& pending = _pending[static_cast<size_t>(index)];
+      pending       = _latest[static_cast<size_t>(index)].lock();
+      if (pending == nullptr) {
+        pending = capture(index);
+      }
+      _pendingIndices.push_back(index);
+    }
+  }
+
+  /**
+   * @brief Announce the modification of the area covered by a brush stroke.
+   *
+   * @param path the spine of the stroke.
+   * @param margin the distance paint may be applied to around the spine.
+   */
+  void markDirty(const std::vector<vec2>& path, const double margin) {
+    if (path.empty()) {
+      return;
+    }
+    auto boundMin = path.front();
+    auto boundMax = path.front();
+    for (const auto& xy : path) {
+      boundMin = boundMin.cwiseMin(xy);
+      boundMax = boundMax.cwiseMax(xy);
+    }
+    const auto x0 = static_cast<int32_t>(std::floor(boundMin[0U] - margin));
+    const auto y0 = static_cast<int32_t>(std::floor(boundMin[1U] - margin));
+    const auto x1 = static_cast<int32_t>(std::ceil(boundMax[0U] + margin));
+    const auto y1 = static_cast<int32_t>(std::ceil(boundMax[1U] + margin));
+    markDirty(cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1));
+  }
+
+  /**
+   * @brief Record the tiles marked since the last commit as one undo step.
+   * Discards all steps that could have been redone.
+   *
+   * @return false if the step did not fit into the memory budget. It was not
+   * recorded and all other steps got dropped, as they can't be restored
+   * across it.
+   */
+  auto commit() -> bool {
+    if (_unrecorded) {
+      clear();
+      return false;
+    }
+    if (_pendingIndices.empty()) {
+      return true;
+    }
+
+    Entry entry;
+    entry.reserve(_pendingIndices.size());
+    for (const auto index : _pendingIndices) {
+      auto& pending = _pending[static_cast<size_t>(index)];
+      auto after    = capture(index);
+      _latest[static_cast<size_t>(index)] = after;
+      entry.push_back({index, std::move(pending), std::move(after)});
+      pending = nullptr;
+    }
+    _pendingIndices.clear();
+    _pendingBytes = 0UL;
+
+    _entries.erase(_entries.begin() + static_cast<std::ptrdiff_t>(_cursor),
+                   _entries.end());
+    _entries.push_back(std::move(entry));
+    _cursor = _entries.size();
+
+    // the step fits on its own, older ones make room for it
+    enforceMemoryBudget(1UL);
+    return true;
+  }
+
+  /**
+   * @brief Revert the last committed step.
+   *
+   * @return true if there was anything to undo.
+   */
+  auto undo() -> bool {
+    if (!canUndo()) {
+      return false;
+    }
+    _cursor--;
+    _restoredRegions.clear();
+    for (const auto& change : _entries[_cursor]) {
+      restore(change.tileIndex, change.before);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Reapply the last undone step.
+   *
+   * @return true if there was anything to redo.
+   */
+  auto redo() -> bool {
+    if (!canRedo()) {
+      return false;
+    }
+    _restoredRegions.clear();
+    for (const auto& change : _entries[_cursor]) {
+      restore(change.tileIndex, change.after);
+    }
+    _cursor++;
+    return true;
+  }
+
+  auto canUndo() const -> bool {
+    return (_cursor > 0UL) && _pendingIndices.empty() && !_unrecorded;
+  }
+
+  auto canRedo() const -> bool {
+    return (_cursor < _entries.size()) && _pendingIndices.empty() &&
+           !_unrecorded;
+  }
+
+  /**
+   * @brief Regions of the canvas changed by the last undo() or redo(), one per
+   * restored tile.
+   *
+   */
+  auto getRestoredRegions() const -> const std::vector<cv::Rect>& {
+    return _restoredRegions;
+  }
+
+  /**
+   * @brief Drop all recorded steps, e.g. after the canvas got replaced.
+   *
+   */
+  void clear() {
+    _entries.clear();
+    _cursor = 0UL;
+    dropPending();
+    _unrecorded = false;
+    for (auto& latest : _latest) {
+      latest.reset();
+    }
+  }
+
+  /**
+   * @brief Number of steps held.
+   *
+   */
+  auto size() const -> std::size_t {
+    return _entries.size();
+  }
+
+  /**
+   * @brief Bytes currently held by tile snapshots.
+   *
+   */
+  auto getMemoryUsage() const -> std::size_t {
+    return *_memoryUsed;
+  }
+
+  auto getMemoryBudget() const -> std::size_t {
+    return _memoryBudget;
+  }
+
+  void setMemoryBudget(const std::size_t bytes) {
+    _memoryBudget = bytes;
+    enforceMemoryBudget(0UL);
+  }
+
+ private:
+  static auto TileCount(const int32_t extent, const int32_t tileSize)
+    -> int32_t {
+    if (tileSize <= 0) {
+      throw std::invalid_argument("tile size must be positive");
+    }
+    return (extent + tileSize - 1) / tileSize;
+  }
+
+  auto tileRect(const int32_t index) const -> cv::Rect {
+    const auto x = (index % _tilesX) * _tileSize;
+    const auto y = (index / _tilesX) * _tileSize;
+    return cv::Rect(x, y,
+                    std::min(_tileSize, _canvas.getPaintLayer().getCols() - x),
+                    std::min(_tileSize, _canvas.getPaintLayer().getRows() - y));
+  }
+
+  /**
+   * @brief Bytes a snapshot of a tile will hold, matches TileSnapshot::bytes().
+   *
+   */
+  static auto SnapshotBytes(const cv::Rect& rect) -> std::size_t {
+    return static_cast<size_t>(rect.area()) *
+           (3UL * sizeof(vector_type) + 2UL * sizeof(T) + sizeof(TimePoint));
+  }
+
+  void dropPending() {
+    for (const auto index : _pendingIndices) {
+      _pending[static_cast<size_t>(index)] = nullptr;
+    }
+    _pendingIndices.clear();
+    _pendingBytes = 0UL;
+  }
+
+  auto capture(const int32_t index) const -> SnapshotPtr {
+    const auto rect   = tileRect(index);
+    const auto& layer = _canvas.getPaintLayer();
+
+    auto snapshot = std::make_unique<TileSnapshot>();
+    snapshot->K   = layer.getK_buffer()(rect).clone();
+    snapshot->S   = layer.getS_buffer()(rect).clone();
+    snapshot->V   = layer.getV_buffer()(rect).clone();
+    snapshot->R0  = _canvas.getR0()(rect).clone();
+    snapshot->h   = _canvas.get_h()(rect).clone();
+
+    const auto& timeMap = _canvas.getTimeMap();
+    const auto cols     = static_cast<size_t>(layer.getCols());
+    snapshot->timeMap.reserve(static_cast<size_t>(rect.area()));
+    for (auto y = rect.y; y < (rect.y + rect.height); y++) {
+      const auto begin = timeMap.cbegin() +
+                         static_cast<std::ptrdiff_t>(
+                           static_cast<size_t>(y) * cols +
+                           static_cast<size_t>(rect.x));
+      snapshot->timeMap.insert(snapshot->timeMap.end(), begin,
+                               begin + rect.width);
+    }
+
+    // account the memory for the lifetime of the snapshot
+    const auto bytes = snapshot->bytes();
+    *_memoryUsed += bytes;
+    return SnapshotPtr(snapshot.release(),
+                       [memoryUsed = _memoryUsed, bytes](const TileSnapshot* p) {
+                         *memoryUsed -= bytes;
+                         delete p;
+                       });
+  }
+
+  void restore(const int32_t index, const SnapshotPtr& snapshot) {
+    const auto rect = tileRect(index);
+    auto& layer     = _canvas.getPaintLayer();
+
+    snapshot->K.copyTo(layer.getK_buffer()(rect));
+    snapshot->S.copyTo(layer.getS_buffer()(rect));
+    snapshot->V.copyTo(layer.getV_buffer()(rect));
+    snapshot->R0.copyTo(_canvas.getR0()(rect));
+    snapshot->h.copyTo(_canvas.get_h()(rect));
+
+    auto& timeMap   = _canvas.getTimeMap();
+    const auto cols = static_cast<size_t>(layer.getCols());
+    auto source     = snapshot->timeMap.cbegin();
+    for (auto y = rect.y; y < (rect.y + rect.height); y++) {
+      std::copy(source, source + rect.width,
+                timeMap.begin() + static_cast<std::ptrdiff_t>(
+                                    static_cast<size_t>(y) * cols +
+                                    static_cast<size_t>(rect.x)));
+      source += rect.width;
+    }
+
+    _latest[static_cast<size_t>(index)] = snapshot;
+    _restoredRegions.push_back(rect);
+  }
+
+  /**
+   * @brief Drop the oldest steps until the snapshots fit into the budget.
+   * Steps that can be redone are dropped only if nothing is left to undo.
+   *
+   * @param keep number of the newest steps that are never dropped.
+   */
+  void enforceMemoryBudget(const std::size_t keep) {
+    while ((*_memoryUsed > _memoryBudget) && (_entries.size() > keep)) {
+      if (_cursor > 0UL) {
+        _entries.pop_front();
+        _cursor--;
+      } else {
+        _entries.pop_back();
+      }
+    }
+  }
+
+  Canvas<vector_type>& _canvas;
+
+  int32_t _tileSize = DefaultTileSize;
+  int32_t _tilesX   = 0;
+  int32_t _tilesY   = 0;
+
+  std::size_t _memoryBudget = DefaultMemoryBudget;
+
+  /**
+   * @brief Shared with the deleters of the snapshots.
+   *
+   */
+  std::shared_ptr<std::size_t> _memoryUsed = nullptr;
+
+  /**
+   * @brief Ring buffer of recorded steps.
+   *
+   */
+  std::deque<Entry> _entries;
+
+  /**
+   * @brief Index of the next step to redo, all before can be undone.
+   *
+   */
+  std::size_t _cursor = 0UL;
+
+  /**
+   * @brief The snapshot matching the current state of each tile if it is
+   * still held by any step.
+   *
+   */
+  std::vector<std::weak_ptr<const TileSnapshot>> _latest;
+
+  /**
+   * @brief State of the tiles marked dirty since the last commit.
+   *
+   */
+  std::vector<SnapshotPtr> _pending;
+  std::vector<int32_t> _pendingIndices;
+
+  std::vector<cv::Rect> _restoredRegions;
+
+  /**
+   * @brief Estimated bytes of the states before and after of the marked tiles.
+   *
+   */
+  std::size_t _pendingBytes = 0UL;
+
+  /**
+   * @brief The current step outgrew the memory budget and won't be recorded.
+   *
+   */
+  bool _unrecorded = false;
+};
+}  // namespace painty
@@ -0,0 +1,142 @@
+/**
+ * @file CanvasKernelsCpu.hxx
+ * @author Thomas Lindemeier
+ * @brief CPU counterparts of the compute and rendering shaders in
+ * painty/renderer/shaders. All buffers are stored top-down as on the host, so
+ * the y-flips of the GLSL versions are not required.
+ * @date 2020-11-02
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "painty/core/ThreadPool.hxx"
+#include "painty/core/Vec.hxx"
+#include "painty/image/Mat.hxx"
+
+namespace painty {
+namespace kernels {
+
+/**
+ * @brief Edge length of the square tiles the canvas is split into when
+ * distributing work over the thread pool.
+ *
+ */
+constexpr auto TileSize = 64;
+
+/**
+ * @brief Split the area of interest into tiles and process them on the
+ * default thread pool. Blocks until all tiles are done, the calling thread
+ * helps meanwhile.
+ *
+ * @param aoi the area of interest.
+ * @param kernel callable taking a cv::Rect (the tile) as argument.
+ */
+template <class Kernel>
+void ForEachTile(const cv::Rect& aoi, Kernel&& kernel) {
+  if (aoi.empty()) {
+    return;
+  }
+  const auto tilesX = (aoi.width + TileSize - 1) / TileSize;
+  const auto tilesY = (aoi.height + TileSize - 1) / TileSize;
+  ParallelFor(DefaultThreadPool(), 0, tilesX * tilesY, 1,
+              [&kernel, &aoi, tilesX](const int32_t begin, const int32_t end) {
+                for (auto i = begin; i < end; i++) {
+                  const auto tx = aoi.x + (i % tilesX) * TileSize;
+                  const auto ty = aoi.y + (i / tilesX) * TileSize;
+                  kernel(cv::Rect(tx, ty,
+                                  std::min(TileSize, aoi.x + aoi.width - tx),
+                                  std::min(TileSize, aoi.y + aoi.height - ty)));
+                }
+              });
+}
+
+/**
+ * @brief Kubelka-Munk reflectance of a layer as evaluated by the shaders.
+ *
+ * @param K absorption
+ * @param S scattering
+ * @param r0 substrate reflectance
+ * @param d layer thickness
+ * @return vec3f
+ */
+auto ComputeReflectanceGlsl(const vec3f& K, const vec3f& S, const vec3f& r0,
+                            float d) -> vec3f;
+
+/**
+ * @brief ComposeLayerOnSubstrate.compute.glsl
+ *
+ * @param R0 the substrate, updated in place.
+ * @param K absorption, volume in alpha.
+ * @param S scattering.
+ */
+void ComposeLayerOnSubstrate(Mat4f& R0, const Mat4f& K, const Mat4f& S);
+
+/**
+ * @brief DryingStep.compute.glsl
+ *
+ * @param R0 the substrate.
+ * @param K absorption, volume in alpha.
+ * @param S scattering.
+ * @param dryPortion the amount of volume that dries in this step.
+ */
+void DryingStep(Mat4f& R0, Mat4f& K, Mat4f& S, float dryPortion);
+
+/**
+ * @brief PaintTextureFootprintOnCanvas.compute.glsl
+ *
+ * @param footprint the warped brush texture in canvas coordinates.
+ * @param aoi the area of the canvas affected.
+ * @param K absorption of the canvas, volume in alpha.
+ * @param S scattering of the canvas.
+ * @param K_brush absorption of the brush paint.
+ * @param S_brush scattering of the brush paint.
+ * @param thicknessScale scales the footprint height.
+ */
+void PaintTextureFootprintOnCanvas(const Mat1f& footprint, const cv::Rect& aoi,
+                                   Mat4f& K, Mat4f& S, const vec3f& K_brush,
+                                   const vec3f& S_brush, float thicknessScale);
+
+/**
+ * @brief Smudge.compute.glsl for a single placement of the smudge map. Runs
+ * serially, the GLSL version is racy where rotated positions collide.
+ *
+ * @param footprint the warped brush texture in canvas coordinates.
+ * @param K absorption of the canvas, volume in alpha.
+ * @param S scattering of the canvas.
+ * @param smudgeK absorption picked up by the brush, volume in alpha.
+ * @param smudgeS scattering picked up by the brush.
+ * @param topLeft position of the smudge map on the canvas.
+ * @param rotationCenter center of rotation in smudge map coordinates.
+ * @param theta heading of the brush.
+ * @param thicknessScale scales the footprint height.
+ */
+void Smudge(const Mat1f& footprint, Mat4f& K, Mat4f& S, Mat4f& smudgeK,
+            Mat4f& smudgeS, const vec2i& topLeft, const vec2f& rotationCenter,
+            float theta, float thicknessScale);
+
+/**
+ * @brief ClearTextureFootprint.compute.glsl
+ *
+ * @param footprint the warped brush texture in canvas coordinates.
+ * @param aoi area to set to zero.
+ */
+void ClearTextureFootprint(Mat1f& footprint, const cv::Rect& aoi);
+
+/**
+ * @brief BrushTextureWarp.vert.glsl and BrushTextureWarp.frag.glsl. Rasterizes
+ * the triangle strip spanned along the spine into the footprint.
+ *
+ * @param brushTexture the height map of the brush texture.
+ * @param path spine of the brush stroke.
+ * @param radius the brush radius.
+ * @param footprint target of canvas size.
+ * @return cv::Rect the area that got covered, clipped to the footprint.
+ */
+auto BrushTextureWarp(const Mat1d& brushTexture, const std::vector<vec2>& path,
+                      double radius, Mat1f& footprint) -> cv::Rect;
+
+}  // namespace kernels
+}  // namespace painty
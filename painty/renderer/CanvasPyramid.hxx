@@ -0,0 +1,259 @@
+/**
+ * @file CanvasPyramid.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-11
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "painty/renderer/Canvas.hxx"
+
+namespace painty {
+/**
+ * @brief Mip pyramid of the composed reflectance of a canvas for display.
+ *
+ * Level 0 holds the wet layer composed onto the substrate at full resolution,
+ * every further level halves the resolution by averaging 2x2 blocks. The
+ * pyramid is maintained incrementally: modified regions are announced using
+ * markDirty() and only the tiles covering them are recomputed by update(), on
+ * all levels. Viewers fetch the level matching their zoom and refresh the
+ * region reported by takeUpdatedRegion().
+ */
+template <class vector_type>
+class CanvasPyramid final {
+  using T = typename DataType<vector_type>::channel_type;
+
+ public:
+  static constexpr int32_t DefaultTileSize = 64;
+
+  /**
+   * @brief Construct a new pyramid, levels are added until a level fits into a
+   * single tile.
+   *
+   * @param canvas the canvas to display, must outlive the pyramid.
+   * @param tileSize edge length of the square tiles in pixels of each level.
+   */
+  CanvasPyramid(const Canvas<vector_type>& canvas,
+                const int32_t tileSize = DefaultTileSize)
+      : _canvas(canvas),
+        _tileSize(tileSize) {
+    if (tileSize <= 0) {
+      throw std::invalid_argument("tile size must be positive");
+    }
+    auto rows = canvas.getPaintLayer().getRows();
+    auto cols = canvas.getPaintLayer().getCols();
+    while (true) {
+      Level level;
+      level.reflectance = Mat<vector_type>(rows, cols);
+      level.tilesX      = (cols + tileSize - 1) / tileSize;
+      level.tilesY      = (rows + tileSize - 1) / tileSize;
+      level.dirty = std::vector<uint8_t>(
+        static_cast<size_t>(level.tilesX * level.tilesY), 1U);
+      level.updated = cv::Rect();
+      _levels.push_back(std::move(level));
+
+      if ((std::max(rows, cols) <= tileSize) || (std::min(rows, cols) <= 1)) {
+        break;
+      }
+      rows = (rows + 1) / 2;
+      cols = (cols + 1) / 2;
+    }
+  }
+
+  CanvasPyramid(const CanvasPyramid&) = delete;
+  CanvasPyramid& operator=(const CanvasPyramid&) = delete;
+
+  /**
+   * @brief Announce that a region of the canvas got modified.
+   *
+   * @param region in canvas pixels, clipped to the canvas.
+   */
+  void markDirty(const cv::Rect& region) {
+    auto& level0       = _levels.front();
+    const auto clipped = region & cv::Rect(0, 0, level0.reflectance.cols,
+                                           level0.reflectance.rows);
+    if (clipped.empty()) {
+      return;
+    }
+    const auto tx0 = clipped.x / _tileSize;
+    const auto ty0 = clipped.y / _tileSize;
+    const auto tx1 = (clipped.x + clipped.width - 1) / _tileSize;
+    const auto ty1 = (clipped.y + clipped.height - 1) / _tileSize;
+    for (auto ty = ty0; ty <= ty1; ty++) {
+      for (auto tx = tx0; tx <= tx1; tx++) {
+        level0.dirty[static_cast<size_t>(ty * level0.tilesX + tx)] = 1U;
+      }
+    }
+  }
+
+  /**
+   * @brief Announce the modification of the area covered by a brush stroke.
+   *
+   * @param path the spine of the stroke.
+   * @param margin the distance paint may be applied to around the spine.
+   */
+  void markDirty(const std::vector<vec2>& path, const double margin) {
+    if (path.empty()) {
+      return;
+    }
+    auto boundMin = path.front();
+    auto boundMax = path.front();
+    for (const auto& xy : path) {
+      boundMin = boundMin.cwiseMin(xy);
+      boundMax = boundMax.cwiseMax(xy);
+    }
+    const auto x0 = static_cast<int32_t>(std::floor(boundMin[0U] - margin));
+    const auto y0 = static_cast<int32_t>(std::floor(boundMin[1U] - margin));
+    const auto x1 = static_cast<int32_t>(std::ceil(boundMax[0U] + margin));
+    const auto y1 = static_cast<int32_t>(std::ceil(boundMax[1U] + margin));
+    markDirty(cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1));
+  }
+
+  /**
+   * @brief Announce that the whole canvas got modified.
+   *
+   */
+  void markAllDirty() {
+    auto& dirty = _levels.front().dirty;
+    std::fill(dirty.begin(), dirty.end(), static_cast<uint8_t>(1U));
+  }
+
+  /**
+   * @brief Recompute the dirty tiles on all levels.
+   *
+   */
+  void update() {
+    for (auto l = 0UL; l < _levels.size(); l++) {
+      auto& level = _levels[l];
+      for (auto ty = 0; ty < level.tilesY; ty++) {
+        for (auto tx = 0; tx < level.tilesX; tx++) {
+          auto& dirty = level.dirty[static_cast<size_t>(ty * level.tilesX + tx)];
+          if (dirty == 0U) {
+            continue;
+          }
+          dirty = 0U;
+
+          const auto rect = tileRect(level, tx, ty);
+          if (l == 0UL) {
+            compose(rect);
+          } else {
+            downsample(_levels[l - 1UL].reflectance, level.reflectance, rect);
+          }
+          level.updated = level.updated.empty() ? rect : (level.updated | rect);
+
+          // the tile of the coarser level covering this one
+          if ((l + 1UL) < _levels.size()) {
+            auto& parent = _levels[l + 1UL];
+            parent.dirty[static_cast<size_t>((ty / 2) * parent.tilesX +
+                                             (tx / 2))] = 1U;
+          }
+        }
+      }
+    }
+  }
+
+  auto getLevelCount() const -> int32_t {
+    return static_cast<int32_t>(_levels.size());
+  }
+
+  /**
+   * @brief The composed reflectance of a level. Call update() before to get
+   * the current state.
+   *
+   */
+  auto getLevel(const int32_t level) const -> const Mat<vector_type>& {
+    return _levels[static_cast<size_t>(level)].reflectance;
+  }
+
+  /**
+   * @brief The coarsest level that still has at least one pixel per screen
+   * pixel.
+   *
+   * @param scale displayed size divided by canvas size.
+   */
+  auto getLevelForScale(const double scale) const -> int32_t {
+    if (scale >= 1.0) {
+      return 0;
+    }
+    const auto level =
+      static_cast<int32_t>(std::floor(std::log2(1.0 / std::max(scale, 1e-9))));
+    return std::min(level, getLevelCount() - 1);
+  }
+
+  /**
+   * @brief Bounding rectangle of all pixels of a level recomputed since the
+   * last call for that level.
+   *
+   * @param level
+   * @return cv::Rect in pixels of the level, empty if nothing changed.
+   */
+  auto takeUpdatedRegion(const int32_t level) -> cv::Rect {
+    auto& updated     = _levels[static_cast<size_t>(level)].updated;
+    const auto region = updated;
+    updated           = cv::Rect();
+    return region;
+  }
+
+ private:
+  struct Level {
+    Mat<vector_type> reflectance;
+    int32_t tilesX = 0;
+    int32_t tilesY = 0;
+    std::vector<uint8_t> dirty;
+    cv::Rect updated;
+  };
+
+  auto tileRect(const Level& level, const int32_t tx, const int32_t ty) const
+    -> cv::Rect {
+    const auto x = tx * _tileSize;
+    const auto y = ty * _tileSize;
+    return cv::Rect(x, y, std::min(_tileSize, level.reflectance.cols - x),
+                    std::min(_tileSize, level.reflectance.rows - y));
+  }
+
+  void compose(const cv::Rect& rect) {
+    const auto& layer = _canvas.getPaintLayer();
+    const auto& K     = layer.getK_buffer();
+    const auto& S     = layer.getS_buffer();
+    const auto& V     = layer.getV_buffer();
+    const auto& R0    = _canvas.getR0();
+    auto& R1          = _levels.front().reflectance;
+    for (auto y = rect.y; y < (rect.y + rect.height); y++) {
+      for (auto x = rect.x; x < (rect.x + rect.width); x++) {
+        R1(y, x) = ComputeReflectance(K(y, x), S(y, x), R0(y, x), V(y, x));
+      }
+    }
+  }
+
+  /**
+   * @brief Average 2x2 blocks of the finer level, the last row and column are
+   * repeated for odd sizes.
+   *
+   */
+  static void downsample(const Mat<vector_type>& finer,
+                         Mat<vector_type>& coarser, const cv::Rect& rect) {
+    for (auto y = rect.y; y < (rect.y + rect.height); y++) {
+      const auto y0 = 2 * y;
+      const auto y1 = std::min(y0 + 1, finer.rows - 1);
+      for (auto x = rect.x; x < (rect.x + rect.width); x++) {
+        const auto x0 = 2 * x;
+        const auto x1 = std::min(x0 + 1, finer.cols - 1);
+        coarser(y, x) = (finer(y0, x0) + finer(y0, x1) + finer(y1, x0) +
+                         finer(y1, x1)) *
+                        static_cast<T>(0.25);
+      }
+    }
+  }
+
+  const Canvas<vector_type>& _canvas;
+
+  int32_t _tileSize = DefaultTileSize;
+
+  std::vector<Level> _levels;
+};
+}  // namespace painty
@@ -0,0 +1,125 @@
+/**
+ * @file RenderBackend.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-02
+ *
+ */
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "painty/core/Types.hxx"
+#include "painty/core/Vec.hxx"
+#include "painty/image/Mat.hxx"
+#include "painty/renderer/CanvasCpu.hxx"
+#include "painty/renderer/CanvasGpu.hxx"
+#include "painty/renderer/TextureBrushCpu.hxx"
+#include "painty/renderer/TextureBrushGpu.hxx"
+
+namespace painty {
+/**
+ * @brief Common interface of a canvas and the brush that paints on it. All
+ * calls are expected to come from the same thread.
+ *
+ */
+class RenderBackend {
+ public:
+  enum class Type {
+    Gpu,  // opengl compute shaders, requires a GpuTaskQueue
+    Cpu   // tiled and multi-threaded on the host, headless
+  };
+
+  virtual ~RenderBackend();
+
+  virtual auto getSize() const -> Size = 0;
+
+  /**
+   * @brief Dip the brush and paint a stroke.
+   *
+   * @param path the control points of the brush stroke.
+   * @param radius the radius of the brush stroke.
+   * @param ks the color as K and S.
+   */
+  virtual void paintStroke(const std::vector<vec2>& path, double radius,
+                           const std::array<vec3, 2UL>& ks) = 0;
+
+  virtual auto getCompositionLinearRgb() -> Mat3d = 0;
+
+  virtual void dryStep(float step) = 0;
+
+  virtual void setBrushThicknessScale(double scale) = 0;
+
+  virtual void enableSmudge(bool enable) = 0;
+
+  /**
+   * @brief Seed the random selection of brush textures.
+   *
+   */
+  virtual void setSeed(uint32_t seed) = 0;
+
+  /**
+   * @brief Show the current state, if there is anything to display on.
+   *
+   */
+  virtual void present();
+};
+
+class RenderBackendGpu final : public RenderBackend {
+ public:
+  /**
+   * @brief Must be constructed in the thread holding the opengl context.
+   *
+   * @param size the canvas size
+   * @param window the window to present the canvas in.
+   */
+  RenderBackendGpu(const Size& size, prgl::Window& window);
+
+  auto getSize() const -> Size override;
+
+  void paintStroke(const std::vector<vec2>& path, double radius,
+                   const std::array<vec3, 2UL>& ks) override;
+
+  auto getCompositionLinearRgb() -> Mat3d override;
+
+  void dryStep(float step) override;
+
+  void setBrushThicknessScale(double scale) override;
+
+  void enableSmudge(bool enable) override;
+
+  void setSeed(uint32_t seed) override;
+
+  void present() override;
+
+ private:
+  CanvasGpu _canvas;
+  TextureBrushGpu _brush;
+  prgl::Window& _window;
+};
+
+class RenderBackendCpu final : public RenderBackend {
+ public:
+  RenderBackendCpu(const Size& size);
+
+  auto getSize() const -> Size override;
+
+  void paintStroke(const std::vector<vec2>& path, double radius,
+                   const std::array<vec3, 2UL>& ks) override;
+
+  auto getCompositionLinearRgb() -> Mat3d override;
+
+  void dryStep(float step) override;
+
+  void setBrushThicknessScale(double scale) override;
+
+  void enableSmudge(bool enable) override;
+
+  void setSeed(uint32_t seed) override;
+
+ private:
+  CanvasCpu _canvas;
+  TextureBrushCpu _brush;
+};
+}  // namespace painty
@@ -7,20 +7,35 @@
  */
 #pragma once
 
+#include <atomic>
+
 #include "painty/core/Timer.hxx"
 #include "painty/core/Types.hxx"
 #include "painty/gpu/GpuTaskQueue.hxx"
-#include "painty/renderer/CanvasGpu.hxx"
-#include "painty/renderer/TextureBrushGpu.hxx"
+#include "painty/renderer/RenderBackend.hxx"
+#include "painty/renderer/StrokeLog.hxx"
 #include "prgl/Window.hxx"
 
 namespace painty {
 
 class SbrRenderThread final {
  public:
+  /**
+   * @brief Render using the opengl context of the task queue.
+   *
+   * @param gpuTaskQueue
+   * @param canvasSize
+   */
   SbrRenderThread(const std::shared_ptr<GpuTaskQueue>& gpuTaskQueue,
                   const Size& canvasSize);
 
+  /**
+   * @brief Render headless using the cpu backend.
+   *
+   * @param canvasSize
+   */
+  SbrRenderThread(const Size& canvasSize);
+
   SbrRenderThread(const SbrRenderThread&) = delete;
   SbrRenderThread& operator=(const SbrRenderThread&) = delete;
   ~SbrRenderThread();
@@ -32,6 +47,13 @@ class SbrRenderThread final {
    */
   auto getSize() const -> Size;
 
+  /**
+   * @brief The backend the strokes are rendered with.
+   *
+   * @return RenderBackend::Type
+   */
+  auto getBackendType() const -> RenderBackend::Type;
+
   /**
    * @brief Get the Thickness Scale object
    *
@@ -73,9 +95,57 @@ class SbrRenderThread final {
 
   auto dryCanvas() -> std::future<void>;
 
+  /**
+   * @brief Dry a portion of the wet paint.
+   *
+   * @param portion in [0, 1].
+   */
+  auto dryStep(float portion) -> std::future<void>;
+
+  /**
+   * @brief Dry the canvas in regular intervals, enabled by default.
+   *
+   * @param enable
+   */
+  void enableAutoDrying(bool enable);
+
+  auto isAutoDryingEnabled() const -> bool;
+
+  /**
+   * @brief Seed the random selection of brush textures.
+   *
+   * @param seed
+   */
+  void setSeed(uint32_t seed);
+
+  /**
+   * @brief Record all following operations on the canvas in the order they
+   * are executed, including the automatic drying. The brush textures get
+   * reseeded and the seed is recorded, so the log can be replayed
+   * deterministically. Pass nullptr to stop recording.
+   *
+   * @param strokeLog
+   */
+  void setStrokeLog(const std::shared_ptr<StrokeLogWriter>& strokeLog);
+
  private:
   static constexpr auto ThreadCount = 1UL;
 
+  /**
+   * @brief Queue a task to the thread owning the backend.
+   *
+   */
+  template <class Function>
+  auto submit(Function&& f)
+    -> std::future<typename std::result_of<Function()>::type> {
+    if (_gpuTaskQueue != nullptr) {
+      return _gpuTaskQueue->add_task(f);
+    }
+    return _cpuTaskQueue->add_back(f);
+  }
+
+  void startTimers();
+
   /**
    * @brief Timer for calling window update and current result display at a certain rate.
    *
@@ -89,16 +159,12 @@ class SbrRenderThread final {
   Timer _timerDryStep;
 
   /**
-   * @brief The brush used to apply paint to the canvas.
+   * @brief The canvas and the brush used to apply paint to it.
    *
    */
-  std::unique_ptr<TextureBrushGpu> _brushPtr = nullptr;
+  std::unique_ptr<RenderBackend> _backendPtr = nullptr;
 
-  /**
-   * @brief The canvas to render into
-   *
-   */
-  std::unique_ptr<CanvasGpu> _canvasPtr = nullptr;
+  RenderBackend::Type _backendType = RenderBackend::Type::Gpu;
 
   /**
    * @brief The size of the canvas created as well as the window for now.
@@ -112,6 +178,22 @@ class SbrRenderThread final {
    */
   std::shared_ptr<GpuTaskQueue> _gpuTaskQueue = nullptr;
 
+  /**
+   * @brief Single threaded queue the cpu backend is accessed from.
+   *
+   */
+  std::unique_ptr<ThreadPool> _cpuTaskQueue = nullptr;
+
   double _thicknessScale = 1.0;
+
+  bool _smudge = false;
+
+  std::atomic<bool> _autoDrying = {true};
+
+  /**
+   * @brief Only accessed from the thread owning the backend.
+   *
+   */
+  std::shared_ptr<StrokeLogWriter> _strokeLog = nullptr;
 };
 }  // namespace painty
@@ -0,0 +1,205 @@
+/**
+ * @file StrokeLog.hxx
+ * @author Thomas Lindemeier
+ * @brief Compact binary log of the operations applied to a canvas.
+ *
+ * The log starts with a header holding the canvas size the coordinates refer
+ * to, followed by a stream of records, each starting with a one byte tag.
+ * Paints are stored once in a palette and referenced by index. Vertices are
+ * quantized to fixed point and stored as zig-zag encoded variable length
+ * deltas to the previous vertex of the stroke. A log cut off in the middle of
+ * a record, e.g. after a crash, is read up to the last complete record.
+ *
+ * @date 2020-11-12
+ *
+ */
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "painty/core/Types.hxx"
+#include "painty/core/Vec.hxx"
+
+namespace painty {
+
+class SbrRenderThread;
+
+struct StrokeLogRecord {
+  enum class Type : uint8_t {
+    Paint          = 1U,  // internal, adds a paint to the palette
+    Stroke         = 2U,
+    ThicknessScale = 3U,
+    Dry            = 4U,
+    Smudge         = 5U,
+    Seed           = 6U
+  };
+
+  Type type = Type::Stroke;
+
+  /**
+   * @brief Stroke: the control points in canvas coordinates of the log.
+   *
+   */
+  std::vector<vec2> path = {};
+
+  /**
+   * @brief Stroke: the brush radius.
+   *
+   */
+  double radius = 0.0;
+
+  /**
+   * @brief Stroke: the paint as K and S.
+   *
+   */
+  std::array<vec3, 2UL> ks = {};
+
+  /**
+   * @brief ThicknessScale: the scale, Dry: the portion dried, Smudge: 1 if
+   * enabled, Seed: the seed.
+   *
+   */
+  double value = 0.0;
+};
+
+class StrokeLogWriter final {
+ public:
+  static constexpr uint32_t Version = 1U;
+
+  /**
+   * @brief Vertices are stored in units of 1/Quantization pixels.
+   *
+   */
+  static constexpr uint32_t Quantization = 64U;
+
+  /**
+   * @brief Write to a file.
+   *
+   * @param filename
+   * @param canvasSize the size of the canvas the coordinates refer to.
+   */
+  StrokeLogWriter(const std::string& filename, const Size& canvasSize);
+
+  /**
+   * @brief Write to a stream that must outlive the writer.
+   *
+   */
+  StrokeLogWriter(std::ostream& out, const Size& canvasSize);
+
+  StrokeLogWriter(const StrokeLogWriter&) = delete;
+  StrokeLogWriter& operator=(const StrokeLogWriter&) = delete;
+
+  ~StrokeLogWriter();
+
+  void addStroke(const std::vector<vec2>& path, double radius,
+                 const std::array<vec3, 2UL>& ks);
+
+  void setThicknessScale(double scale);
+
+  void dry(float portion);
+
+  void enableSmudge(bool enable);
+
+  void setSeed(uint32_t seed);
+
+  void flush();
+
+  auto getStrokeCount() const -> std::size_t;
+
+ private:
+  static constexpr std::size_t FlushInterval = 64UL;
+
+  void writeHeader();
+
+  auto paintIndex(const std::array<vec3, 2UL>& ks) -> uint32_t;
+
+  std::unique_ptr<std::ofstream> _file = nullptr;
+
+  std::ostream& _out;
+
+  Size _canvasSize;
+
+  /**
+   * @brief Index of each paint already written to the log.
+   *
+   */
+  std::map<std::array<double, 6UL>, uint32_t> _paintIndices;
+
+  std::size_t _strokeCount = 0UL;
+
+  /**
+   * @brief Reused for encoding the records.
+   *
+   */
+  std::vector<uint8_t> _buffer;
+};
+
+class StrokeLogReader final {
+ public:
+  explicit StrokeLogReader(const std::string& filename);
+
+  /**
+   * @brief Read from a stream that must outlive the reader.
+   *
+   */
+  explicit StrokeLogReader(std::istream& in);
+
+  StrokeLogReader(const StrokeLogReader&) = delete;
+  StrokeLogReader& operator=(const StrokeLogReader&) = delete;
+
+  /**
+   * @brief The size of the canvas the coordinates refer to.
+   *
+   */
+  auto getCanvasSize() const -> Size;
+
+  /**
+   * @brief Read the next record.
+   *
+   * @param record
+   * @return true if a complete record was read, false at the end of the log.
+   */
+  auto next(StrokeLogRecord& record) -> bool;
+
+  /**
+   * @brief True if the log ended in the middle of a record.
+   *
+   */
+  auto isTruncated() const -> bool;
+
+ private:
+  void readHeader();
+
+  std::unique_ptr<std::ifstream> _file = nullptr;
+
+  std::istream& _in;
+
+  Size _canvasSize = {};
+
+  uint32_t _quantization = StrokeLogWriter::Quantization;
+
+  std::vector<std::array<vec3, 2UL>> _palette;
+
+  bool _truncated = false;
+};
+
+/**
+ * @brief Re-render a log in batches, scaled to the canvas of the render
+ * thread. Automatic drying of the render thread is disabled while replaying,
+ * hence the same log replayed to the same size always gives the same result.
+ *
+ * @param reader the log.
+ * @param renderThread the target, strokes are painted on top of its content.
+ * @param batchSize the number of strokes queued before waiting for the
+ * renderer.
+ * @return std::size_t the number of strokes rendered.
+ */
+auto ReplayStrokeLog(StrokeLogReader& reader, SbrRenderThread& renderThread,
+                     std::size_t batchSize = 256UL) -> std::size_t;
+
+}  // namespace painty
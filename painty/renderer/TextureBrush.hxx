@@ -23,7 +23,7 @@ class TextureBrush final : public BrushBase<vector_type> {
 
  public:
   TextureBrush(const std::string& sampleDir)
-      : _brushStrokeSample(sampleDir),
+      : _brushStrokeSample(BrushStrokeSample::Get(sampleDir)),
         _smudge(static_cast<int32_t>(2.0 * _radius)) {
     for (auto& c : _paintStored) {
       c.fill(static_cast<T>(0.1));
@@ -88,6 +88,9 @@ class TextureBrush final : public BrushBase<vector_type> {
       length += (vertices[i] - vertices[i - 1]).norm();
     }
 
+    // minify the texture to the size of the stroke
+    const auto lod = _brushStrokeSample->getLod(length, 2.0 * _radius);
+
     // spine
     SplineEval<std::vector<vec2>::const_iterator> spineSpline(vertices.cbegin(),
                                                               vertices.cend());
@@ -154,11 +157,9 @@ class TextureBrush final : public BrushBase<vector_type> {
             (texPos[1U] > 1.0)) {
           continue;
         }
-        texPos[0U] *= _brushStrokeSample.getThicknessMap().cols;
-        texPos[1U] *= _brushStrokeSample.getThicknessMap().rows;
-        const auto Vtex =
-          BrushBase<vector_type>::getThicknessScale() *
-          Interpolate(_brushStrokeSample.getThicknessMap(), texPos);
+        const auto Vtex = BrushBase<vector_type>::getThicknessScale() *
+                          static_cast<T>(
+                            _brushStrokeSample->getThicknessAt(texPos, lod));
         if (Vtex > 0.0) {
           const auto s = x - static_cast<int32_t>(boundMin[0U]);
           const auto t = y - static_cast<int32_t>(boundMin[1U]);
@@ -213,7 +214,7 @@ class TextureBrush final : public BrushBase<vector_type> {
    * @brief Brush stroke texture sample that can be warped along a trajectory or list of vertices.
    *
    */
-  BrushStrokeSample _brushStrokeSample;
+  std::shared_ptr<const BrushStrokeSample> _brushStrokeSample;
 
   /**
    * @brief The current paint the brush stores.
@@ -0,0 +1,71 @@
+/**
+ * @file TextureBrushCpu.hxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-02
+ *
+ */
+#pragma once
+
+#include "painty/core/Vec.hxx"
+#include "painty/renderer/BrushBase.hxx"
+#include "painty/renderer/CanvasCpu.hxx"
+#include "painty/renderer/TextureBrushDictionary.hxx"
+
+namespace painty {
+/**
+ * @brief Host side counterpart of TextureBrushGpu.
+ *
+ */
+class TextureBrushCpu final : public BrushBase<vec3> {
+ public:
+  TextureBrushCpu();
+
+  void setRadius(const double) override;
+
+  void dip(const std::array<vec3, 2UL>&) override;
+
+  /**
+   * @brief Imprint the warped brush texture into the wet layer of the canvas
+   * using the same volume weighted mixing as for CanvasCpu.
+   *
+   */
+  void paintStroke(const std::vector<vec2>& path,
+                   Canvas<vec3>& canvas) override;
+
+  void paintStroke(const std::vector<vec2>& path, CanvasCpu& canvas);
+
+  void enableSmudge(bool enable);
+
+  /**
+   * @brief Seed the selection of the brush textures.
+   *
+   */
+  void setSeed(uint32_t seed);
+
+ private:
+  auto generateWarpedTexture(const std::vector<vec2>& path, const Size& size)
+    -> cv::Rect;
+
+  void smudge(const std::vector<vec2>& path, CanvasCpu& canvas);
+
+  double _radius = 0.0;
+
+  std::array<vec3, 2UL> _paintStored;
+
+  TextureBrushDictionary _textureBrushDictionary;
+
+  /**
+   * @brief The brush texture warped along the stroke, of the size of the
+   * canvas.
+   *
+   */
+  Mat1f _warpedBrushTexture;
+
+  Mat4f _smudgeK;
+
+  Mat4f _smudgeS;
+
+  bool _smudge = false;
+};
+}  // namespace painty
@@ -7,6 +7,10 @@
  */
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
 #include <vector>
 
 #include "painty/image/Mat.hxx"
@@ -14,6 +18,15 @@
 
 namespace painty {
 
+/**
+ * @brief Brush textures, grouped by brush size and stroke length.
+ *
+ * The normalized textures of a folder are kept in a binary cache file next to
+ * it, which is memory mapped, so constructing the dictionary only reads the
+ * index regardless of the number of textures. The cache is rebuilt if it does
+ * not match the folder anymore. A texture is converted and uploaded to the gpu
+ * when it is used the first time.
+ */
 class TextureBrushDictionary {
  public:
   struct Entry {
@@ -21,21 +34,121 @@ class TextureBrushDictionary {
     std::shared_ptr<prgl::Texture2d> texGpu;
   };
 
+  static constexpr uint32_t CacheVersion = 1U;
+
  private:
-  auto loadHeightMap(const std::string& file) const -> Mat1d;
+  struct Texture {
+    /**
+     * @brief The png, decoded on first use if the cache is not available.
+     *
+     */
+    std::string source;
+
+    /**
+     * @brief The normalized texture in the mapped cache file.
+     *
+     */
+    const float* cached = nullptr;
+
+    int32_t rows = 0;
+    int32_t cols = 0;
+
+    /**
+     * @brief Set once the entry is converted, concurrent lookups of different
+     * textures convert them in parallel.
+     *
+     */
+    std::unique_ptr<std::once_flag> loaded = std::make_unique<std::once_flag>();
+    Entry entry                            = {};
+  };
+
+  struct LengthBin {
+    double avgLength = 0.0;
+    std::vector<std::size_t> textures;
+  };
+
+  struct SizeBin {
+    double avgSize = 0.0;
+
+    /**
+     * @brief Sorted by the average length.
+     *
+     */
+    std::vector<LengthBin> lengths;
+  };
 
-  void createBrushTexturesFromFolder(const std::string& textureListFile);
+  static auto loadHeightMap(const std::string& file) -> Mat1d;
+
+  void createIndex(const std::string& folder);
+
+  void createBins(const std::vector<std::pair<uint32_t, uint32_t>>& keys);
+
+  void load(Texture& texture) const;
 
  public:
-  TextureBrushDictionary();
+  /**
+   * @brief Load the index of the brush textures.
+   *
+   * @param createGpuTextures upload the textures, requires an opengl context
+   * when calling lookup().
+   * @param folder brush textures named <radius>_<length>_<id>.png.
+   */
+  TextureBrushDictionary(bool createGpuTextures = true,
+                         const std::string& folder = "data/textures");
 
   auto lookup(const std::vector<vec2>& path, const double brushSize) const
     -> Entry;
 
+  /**
+   * @brief Seed the random selection among the candidates of a lookup, equal
+   * seeds give equal selections for equal sequences of lookups.
+   *
+   * @param seed
+   */
+  void setSeed(uint32_t seed);
+
+  auto getTextureCount() const -> std::size_t;
+
+  /**
+   * @brief Decode and normalize all textures of a folder in parallel and store
+   * them in a cache file.
+   *
+   * @param folder
+   * @param cacheFile
+   */
+  static void BuildCache(const std::string& folder,
+                         const std::string& cacheFile);
+
+  /**
+   * @brief The cache file used for a texture folder.
+   *
+   */
+  static auto GetCacheFile(const std::string& folder) -> std::string;
+
  private:
-  std::vector<std::vector<std::vector<Entry>>> _brushTexturesBySizeByLength;
-  std::vector<double> _avgSizes;
-  std::vector<std::vector<double>> _avgTexLength;
+  bool _createGpuTextures = true;
+
+  /**
+   * @brief The mapped cache file, the cached textures point into it.
+   *
+   */
+  std::shared_ptr<const uint8_t> _cache = nullptr;
+
+  mutable std::vector<Texture> _textures;
+
+  /**
+   * @brief Sorted by the average size.
+   *
+   */
+  std::vector<SizeBin> _sizeBins;
+
+  mutable std::mt19937 _generator;
+
+  /**
+   * @brief Guards the random selection, lookup() may be called concurrently.
+   *
+   */
+  mutable std::mutex _mutex;
 };
 
 }  // namespace painty
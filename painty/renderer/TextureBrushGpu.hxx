@@ -33,6 +33,12 @@ class TextureBrushGpu final : public BrushBase<vec3> {
 
   void enableSmudge(bool enable);
 
+  /**
+   * @brief Seed the selection of the brush textures.
+   *
+   */
+  void setSeed(uint32_t seed);
+
  private:
   void generateWarpedTexture(const std::vector<vec2>& path, const Size& size);
 
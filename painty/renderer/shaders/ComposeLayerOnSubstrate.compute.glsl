@@ -41,7 +41,7 @@ highp vec3 computeReflectance(in highp vec3 K, in highp vec3 S,
     return r0;
   }
 
-  highp vec3 bcothbSh = coth(bSh);
+  highp vec3 bcothbSh = b * coth(bSh);
 
   return (vec3(1.0, 1.0, 1.0) - r0 * (a - bcothbSh)) / (a - r0 + bcothbSh);
 }
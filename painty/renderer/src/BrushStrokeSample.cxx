@@ -8,8 +8,14 @@
  */
 #include "painty/renderer/BrushStrokeSample.hxx"
 
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <map>
+#include <mutex>
 
 #include "painty/io/ImageIO.hxx"
 
@@ -21,6 +27,45 @@ painty::BrushStrokeSample::BrushStrokeSample(const std::string& sampleDir) {
   loadSample(sampleDir);
 }
 
+std::shared_ptr<const painty::BrushStrokeSample> painty::BrushStrokeSample::Get(
+  const std::string& sampleDir) {
+  using SamplePtr = std::shared_ptr<const BrushStrokeSample>;
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_future<SamplePtr>> samples;
+
+  // equal directories written differently share the sample
+  const auto key = std::filesystem::weakly_canonical(sampleDir).string();
+
+  std::promise<SamplePtr> promise;
+  std::shared_future<SamplePtr> future;
+  auto load = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = samples.find(key);
+    if (it == samples.end()) {
+      it   = samples.emplace(key, promise.get_future().share()).first;
+      load = true;
+    }
+    future = it->second;
+  }
+  if (!load) {
+    // loaded by another caller, possibly still in progress
+    return future.get();
+  }
+
+  // loaded outside of the lock, other directories are not blocked
+  try {
+    const auto sample = std::make_shared<const BrushStrokeSample>(sampleDir);
+    promise.set_value(sample);
+    return sample;
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+    std::lock_guard<std::mutex> lock(mutex);
+    samples.erase(key);
+    throw;
+  }
+}
+
 const painty::Mat<double>& painty::BrushStrokeSample::getThicknessMap() const {
   return _thickness_map;
 }
@@ -28,6 +73,61 @@ const painty::Mat<double>& painty::BrushStrokeSample::getThicknessMap() const {
 void painty::BrushStrokeSample::setThicknessMap(
   const Mat<double>& thicknessMap) {
   _thickness_map = thicknessMap;
+  createThicknessMips();
+}
+
+const painty::Mat1f& painty::BrushStrokeSample::getThicknessMip(
+  const uint32_t level) const {
+  return _thicknessMips[level];
+}
+
+uint32_t painty::BrushStrokeSample::getThicknessMipCount() const {
+  return static_cast<uint32_t>(_thicknessMips.size());
+}
+
+double painty::BrushStrokeSample::getThicknessAt(const vec2& uv,
+                                                 const double lod) const {
+  if (_thicknessMips.empty()) {
+    return 0.0;
+  }
+  const auto maxLevel = static_cast<double>(_thicknessMips.size() - 1UL);
+  const auto l        = std::clamp(lod, 0.0, maxLevel);
+  const auto level    = static_cast<uint32_t>(std::floor(l));
+  const auto w        = l - static_cast<double>(level);
+
+  const auto sample = getMipSample(level, uv);
+  if (w <= 0.0) {
+    return sample;
+  }
+  return (1.0 - w) * sample + w * getMipSample(level + 1U, uv);
+}
+
+double painty::BrushStrokeSample::getLod(const double strokeLength,
+                                         const double strokeWidth) const {
+  if (_thickness_map.empty() || (strokeLength <= 0.0) ||
+      (strokeWidth <= 0.0)) {
+    return 0.0;
+  }
+  // the more minified direction decides, to not alias
+  const auto texelsPerPixel =
+    std::max(static_cast<double>(_thickness_map.cols) / strokeLength,
+             static_cast<double>(_thickness_map.rows) / strokeWidth);
+  return std::max(0.0, std::log2(texelsPerPixel));
+}
+
+double painty::BrushStrokeSample::getMipSample(const uint32_t level,
+                                               const vec2& uv) const {
+  const auto& base = _thicknessMips.front();
+  const auto& mip  = _thicknessMips[level];
+
+  // texel centers of the coarser levels are at the center of the covered
+  // full resolution texels
+  const vec2 xy = {
+    (uv[0U] * base.cols + 0.5) * (static_cast<double>(mip.cols) / base.cols) -
+      0.5,
+    (uv[1U] * base.rows + 0.5) * (static_cast<double>(mip.rows) / base.rows) -
+      0.5};
+  return static_cast<double>(Interpolate(mip, xy));
 }
 
 /**
@@ -57,7 +157,19 @@ double painty::BrushStrokeSample::getSampleAt(const vec2& xy) const {
  * @return double 0.0 if xy outside of texture
  */
 double painty::BrushStrokeSample::getSampleAtUV(const vec2& uv) const {
-  return getSampleAt(_warper.warp(uv));
+  return getSampleAt(warpUV(uv));
+}
+
+painty::vec2 painty::BrushStrokeSample::warpUV(const vec2& uv) const {
+  // the grid does not cover positions outside of the domain
+  if ((uv[0U] < 0.0) || (uv[0U] > 1.0) || (uv[1U] < -1.0) || (uv[1U] > 1.0) ||
+      _warpGrid.empty()) {
+    return _warper.warp(uv);
+  }
+  const vec2 gridPos = {
+    uv[0U] * static_cast<double>(WarpGridCols - 1),
+    (uv[1U] + 1.0) * 0.5 * static_cast<double>(WarpGridRows - 1)};
+  return Interpolate(_warpGrid, gridPos, cv::BORDER_REPLICATE);
 }
 
 /**
@@ -162,6 +274,25 @@ void painty::BrushStrokeSample::loadSample(const std::string& sampleDir) {
 
   // load thickness map
   io::imRead(sampleDir + "/thickness_map.png", _thickness_map, true);
+  createThicknessMips();
+}
+
+void painty::BrushStrokeSample::createThicknessMips() {
+  _thicknessMips.clear();
+  if (_thickness_map.empty()) {
+    return;
+  }
+  Mat1f level;
+  _thickness_map.convertTo(level, CV_32FC1);
+  _thicknessMips.push_back(level);
+  while ((level.rows > 1) && (level.cols > 1)) {
+    Mat1f coarser;
+    cv::resize(level, coarser,
+               cv::Size((level.cols + 1) / 2, (level.rows + 1) / 2), 0.0, 0.0,
+               cv::INTER_AREA);
+    _thicknessMips.push_back(coarser);
+    level = coarser;
+  }
 }
 
 void painty::BrushStrokeSample::createWarper() {
@@ -180,6 +311,20 @@ void painty::BrushStrokeSample::createWarper() {
     _warper.init(uv, t);
   }
 
+  _warpGrid = Mat<vec2>();
+  if (!_puv_l.empty() && !_puv_r.empty()) {
+    _warpGrid = Mat<vec2>(WarpGridRows, WarpGridCols);
+    for (auto y = 0; y < WarpGridRows; y++) {
+      for (auto x = 0; x < WarpGridCols; x++) {
+        _warpGrid(y, x) = _warper.warp(
+          {static_cast<double>(x) / static_cast<double>(WarpGridCols - 1),
+           (2.0 * static_cast<double>(y) /
+            static_cast<double>(WarpGridRows - 1)) -
+             1.0});
+      }
+    }
+  }
+
   // scan through points and find the maximum width
   _widthMax = 0.0;
   for (auto l = _txy_l.cbegin(), r = _txy_r.cbegin();
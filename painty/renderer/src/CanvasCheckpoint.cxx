@@ -0,0 +1,574 @@
+/**
+ * @file CanvasCheckpoint.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-09
+ *
+ */
+#include "painty/renderer/CanvasCheckpoint.hxx"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+
+#include "painty/core/ThreadPool.hxx"
+#include "painty/renderer/Canvas.hxx"
+#include "painty/renderer/CanvasCpu.hxx"
+#include "painty/renderer/CanvasGpu.hxx"
+
+namespace painty {
+
+namespace {
+constexpr char Magic[8U]           = {'P', 'A', 'I', 'N', 'T', 'Y', 'C', 'K'};
+constexpr uint32_t ByteOrderMark   = 0x01020304U;
+constexpr uint64_t DataAlignment   = 4096U;
+constexpr std::size_t NameCapacity = 16U;
+
+struct FileHeader {
+  char magic[8U];
+  uint32_t version;
+  uint32_t byteOrderMark;
+  uint32_t layout;
+  uint32_t width;
+  uint32_t height;
+  int32_t tileSize;
+  uint32_t bufferCount;
+  uint32_t reserved0;
+  int64_t dryingTimeMs;
+  int64_t timestampUs;
+  uint8_t reserved1[8U];
+};
+static_assert(sizeof(FileHeader) == 64U, "unexpected file header size");
+
+struct BufferHeader {
+  char name[NameCapacity];
+  int32_t type;
+  uint32_t compression;
+  uint64_t offset;
+  uint64_t storedBytes;
+  uint64_t rawBytes;
+  uint8_t reserved[16U];
+};
+static_assert(sizeof(BufferHeader) == 64U, "unexpected buffer header size");
+
+auto AlignUp(const uint64_t value) -> uint64_t {
+  return ((value + DataAlignment - 1U) / DataAlignment) * DataAlignment;
+}
+
+/**
+ * @brief Row major grid of tiles covering an image.
+ *
+ */
+auto TileGrid(const cv::Size& size, const int32_t tileSize)
+  -> std::vector<cv::Rect> {
+  std::vector<cv::Rect> tiles;
+  for (auto y = 0; y < size.height; y += tileSize) {
+    for (auto x = 0; x < size.width; x += tileSize) {
+      tiles.emplace_back(x, y, std::min(tileSize, size.width - x),
+                         std::min(tileSize, size.height - y));
+    }
+  }
+  return tiles;
+}
+
+/**
+ * @brief Deflate each tile of a buffer independently.
+ *
+ * @return std::vector<uint8_t> tile offset table followed by the streams.
+ */
+auto DeflateTiles(const cv::Mat& buffer, const int32_t tileSize)
+  -> std::vector<uint8_t> {
+  const auto tiles = TileGrid(buffer.size(), tileSize);
+
+  auto& pool = DefaultThreadPool();
+  std::vector<std::future<std::vector<uint8_t>>> futures;
+  for (const auto& tile : tiles) {
+    futures.push_back(pool.add_back([&buffer, tile]() {
+      // tile rows are not contiguous in the buffer
+      const auto region = buffer(tile).clone();
+      const auto rawBytes =
+        static_cast<uLong>(region.total() * region.elemSize());
+
+      auto storedBytes = compressBound(rawBytes);
+      std::vector<uint8_t> stream(storedBytes);
+      if (compress2(stream.data(), &storedBytes, region.data, rawBytes,
+                    Z_BEST_SPEED) != Z_OK) {
+        throw std::runtime_error("compressing checkpoint tile failed");
+      }
+      stream.resize(storedBytes);
+      return stream;
+    }));
+  }
+
+  // the pool is shared, no job may outlive the buffer if one of them fails
+  for (const auto& future : futures) {
+    future.wait();
+  }
+
+  std::vector<uint64_t> offsets(tiles.size() + 1U);
+  offsets.front() = offsets.size() * sizeof(uint64_t);
+  std::vector<std::vector<uint8_t>> streams;
+  for (auto i = 0U; i < futures.size(); i++) {
+    streams.push_back(futures[i].get());
+    offsets[i + 1U] = offsets[i] + streams.back().size();
+  }
+
+  std::vector<uint8_t> block(offsets.back());
+  std::memcpy(block.data(), offsets.data(), offsets.size() * sizeof(uint64_t));
+  for (auto i = 0U; i < streams.size(); i++) {
+    std::copy(streams[i].begin(), streams[i].end(),
+              block.begin() + static_cast<std::ptrdiff_t>(offsets[i]));
+  }
+  return block;
+}
+
+auto ToCvSize(const Size& size) -> cv::Size {
+  return {static_cast<int32_t>(size.width), static_cast<int32_t>(size.height)};
+}
+}  // namespace
+
+CanvasCheckpoint::CanvasCheckpoint(const std::string& filename)
+    : _filename(filename) {
+  const auto fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::ios_base::failure(filename);
+  }
+  struct stat fileStat = {};
+  if (::fstat(fd, &fileStat) != 0) {
+    ::close(fd);
+    throw std::ios_base::failure(filename);
+  }
+  _length = static_cast<std::size_t>(fileStat.st_size);
+  if (_length < sizeof(FileHeader)) {
+    ::close(fd);
+    throw std::runtime_error("not a painty checkpoint: " + filename);
+  }
+
+  // private and writable, so the returned Mat headers can be modified without
+  // touching the file
+  auto* mapped =
+    ::mmap(nullptr, _length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::ios_base::failure(filename);
+  }
+  _data = static_cast<uint8_t*>(mapped);
+
+  try {
+    FileHeader header = {};
+    std::memcpy(&header, _data, sizeof(FileHeader));
+    if ((std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) ||
+        (header.byteOrderMark != ByteOrderMark)) {
+      throw std::runtime_error("not a painty checkpoint: " + filename);
+    }
+    if ((header.version == 0U) || (header.version > Version)) {
+      throw std::runtime_error("unsupported checkpoint version: " +
+                               std::to_string(header.version));
+    }
+    if ((header.layout != static_cast<uint32_t>(Layout::Host)) &&
+        (header.layout != static_cast<uint32_t>(Layout::Shader))) {
+      throw std::runtime_error("unknown checkpoint layout");
+    }
+    if (header.tileSize <= 0) {
+      throw std::runtime_error("invalid checkpoint tile size");
+    }
+    _version    = header.version;
+    _layout     = static_cast<Layout>(header.layout);
+    _size       = {header.width, header.height};
+    _tileSize   = header.tileSize;
+    _dryingTime = std::chrono::milliseconds(header.dryingTimeMs);
+    _timestamp  = std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::microseconds(header.timestampUs)));
+
+    const auto tableEnd =
+      sizeof(FileHeader) + header.bufferCount * sizeof(BufferHeader);
+    if (tableEnd > _length) {
+      throw std::runtime_error("truncated checkpoint: " + filename);
+    }
+    for (auto i = 0U; i < header.bufferCount; i++) {
+      BufferHeader bufferHeader = {};
+      std::memcpy(&bufferHeader,
+                  _data + sizeof(FileHeader) + i * sizeof(BufferHeader),
+                  sizeof(BufferHeader));
+
+      BufferInfo info = {};
+      info.name =
+        std::string(bufferHeader.name,
+                    strnlen(bufferHeader.name, sizeof(bufferHeader.name)));
+      info.type        = bufferHeader.type;
+      info.compression = static_cast<Compression>(bufferHeader.compression);
+      info.offset      = bufferHeader.offset;
+      info.storedBytes = bufferHeader.storedBytes;
+
+      const auto rawBytes = static_cast<uint64_t>(_size.width) * _size.height *
+                            static_cast<uint64_t>(CV_ELEM_SIZE(info.type));
+      // the range check must not wrap around for crafted offsets
+      if ((info.offset > _length) ||
+          (info.storedBytes > _length - info.offset) ||
+          (bufferHeader.rawBytes != rawBytes)) {
+        throw std::runtime_error("corrupt checkpoint buffer: " + info.name);
+      }
+      if (info.compression == Compression::None) {
+        if (info.storedBytes != rawBytes) {
+          throw std::runtime_error("corrupt checkpoint buffer: " + info.name);
+        }
+      } else if (info.compression != Compression::Zlib) {
+        throw std::runtime_error("unknown checkpoint compression: " +
+                                 info.name);
+      }
+      _buffers.push_back(info);
+    }
+  } catch (...) {
+    ::munmap(_data, _length);
+    throw;
+  }
+}
+
+CanvasCheckpoint::~CanvasCheckpoint() {
+  if (_data != nullptr) {
+    ::munmap(_data, _length);
+  }
+}
+
+auto CanvasCheckpoint::getVersion() const -> uint32_t {
+  return _version;
+}
+
+auto CanvasCheckpoint::getLayout() const -> Layout {
+  return _layout;
+}
+
+auto CanvasCheckpoint::getSize() const -> Size {
+  return _size;
+}
+
+auto CanvasCheckpoint::getTileSize() const -> int32_t {
+  return _tileSize;
+}
+
+auto CanvasCheckpoint::getDryingTime() const -> std::chrono::milliseconds {
+  return _dryingTime;
+}
+
+auto CanvasCheckpoint::getTimestamp() const
+  -> std::chrono::system_clock::time_point {
+  return _timestamp;
+}
+
+auto CanvasCheckpoint::getBufferNames() const -> std::vector<std::string> {
+  std::vector<std::string> names;
+  for (const auto& info : _buffers) {
+    names.push_back(info.name);
+  }
+  return names;
+}
+
+auto CanvasCheckpoint::hasBuffer(const std::string& name) const -> bool {
+  return std::any_of(_buffers.begin(), _buffers.end(),
+                     [&name](const BufferInfo& info) {
+                       return info.name == name;
+                     });
+}
+
+auto CanvasCheckpoint::getCompression(const std::string& name) const
+  -> Compression {
+  return findBuffer(name).compression;
+}
+
+auto CanvasCheckpoint::getBuffer(const std::string& name) const -> cv::Mat {
+  return getBuffer(name, cv::Rect(cv::Point(0, 0), ToCvSize(_size)));
+}
+
+auto CanvasCheckpoint::getBuffer(const std::string& name,
+                                 const cv::Rect& roi) const -> cv::Mat {
+  const auto& info = findBuffer(name);
+  if ((roi & cv::Rect(cv::Point(0, 0), ToCvSize(_size))) != roi) {
+    throw std::invalid_argument("region exceeds the checkpoint canvas");
+  }
+  if (info.compression == Compression::None) {
+    return cv::Mat(ToCvSize(_size), info.type, _data + info.offset)(roi);
+  }
+  return inflateRegion(info, roi);
+}
+
+auto CanvasCheckpoint::findBuffer(const std::string& name) const
+  -> const BufferInfo& {
+  const auto it = std::find_if(_buffers.begin(), _buffers.end(),
+                               [&name](const BufferInfo& info) {
+                                 return info.name == name;
+                               });
+  if (it == _buffers.end()) {
+    throw std::invalid_argument("no such checkpoint buffer: " + name);
+  }
+  return *it;
+}
+
+auto CanvasCheckpoint::inflateRegion(const BufferInfo& info,
+                                     const cv::Rect& roi) const -> cv::Mat {
+  const auto tiles     = TileGrid(ToCvSize(_size), _tileSize);
+  const auto* block    = _data + info.offset;
+  const auto tableSize = (tiles.size() + 1U) * sizeof(uint64_t);
+  if (tableSize > info.storedBytes) {
+    throw std::runtime_error("corrupt checkpoint buffer: " + info.name);
+  }
+  std::vector<uint64_t> offsets(tiles.size() + 1U);
+  std::memcpy(offsets.data(), block, tableSize);
+
+  cv::Mat region(roi.size(), info.type);
+  for (auto i = 0U; i < tiles.size(); i++) {
+    const auto overlap = tiles[i] & roi;
+    if (overlap.area() == 0) {
+      continue;
+    }
+    if ((offsets[i] > offsets[i + 1U]) ||
+        (offsets[i + 1U] > info.storedBytes)) {
+      throw std::runtime_error("corrupt checkpoint buffer: " + info.name);
+    }
+
+    cv::Mat tile(tiles[i].size(), info.type);
+    const auto expectedBytes = static_cast<uLong>(tile.total() * tile.elemSize());
+    auto rawBytes            = expectedBytes;
+    if ((uncompress(tile.data, &rawBytes, block + offsets[i],
+                    static_cast<uLong>(offsets[i + 1U] - offsets[i])) !=
+         Z_OK) ||
+        (rawBytes != expectedBytes)) {
+      throw std::runtime_error("corrupt checkpoint buffer: " + info.name);
+    }
+    tile(overlap - tiles[i].tl()).copyTo(region(overlap - roi.tl()));
+  }
+  return region;
+}
+
+CanvasCheckpointWriter::CanvasCheckpointWriter(
+  const Size& size, const CanvasCheckpoint::Layout layout)
+    : _size(size),
+      _layout(layout) {}
+
+void CanvasCheckpointWriter::setDryingTime(
+  const std::chrono::milliseconds dryingTime) {
+  _dryingTime = dryingTime;
+}
+
+void CanvasCheckpointWriter::addBuffer(const std::string& name,
+                                       const cv::Mat& buffer) {
+  if (name.empty() || (name.size() >= NameCapacity)) {
+    throw std::invalid_argument("invalid checkpoint buffer name: " + name);
+  }
+  if (buffer.size() != ToCvSize(_size)) {
+    throw std::invalid_argument("buffer does not match the canvas size: " +
+                                name);
+  }
+  for (const auto& b : _buffers) {
+    if (b.first == name) {
+      throw std::invalid_argument("duplicate checkpoint buffer: " + name);
+    }
+  }
+  _buffers.emplace_back(name, buffer);
+}
+
+void CanvasCheckpointWriter::write(
+  const std::string& filename,
+  const CanvasCheckpoint::Compression compression,
+  const int32_t tileSize) const {
+  if (tileSize <= 0) {
+    throw std::invalid_argument("tile size must be positive");
+  }
+
+  FileHeader header = {};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version       = CanvasCheckpoint::Version;
+  header.byteOrderMark = ByteOrderMark;
+  header.layout        = static_cast<uint32_t>(_layout);
+  header.width         = _size.width;
+  header.height        = _size.height;
+  header.tileSize      = tileSize;
+  header.bufferCount   = static_cast<uint32_t>(_buffers.size());
+  header.dryingTimeMs  = static_cast<int64_t>(_dryingTime.count());
+  header.timestampUs =
+    static_cast<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count());
+
+  // gather the payloads and place them at page aligned offsets
+  std::vector<BufferHeader> table(_buffers.size());
+  std::vector<cv::Mat> raw(_buffers.size());
+  std::vector<std::vector<uint8_t>> deflated(_buffers.size());
+  auto offset =
+    AlignUp(sizeof(FileHeader) + _buffers.size() * sizeof(BufferHeader));
+  for (auto i = 0U; i < _buffers.size(); i++) {
+    const auto& buffer = _buffers[i].second;
+    raw[i] = buffer.isContinuous() ? buffer : buffer.clone();
+
+    auto& bufferHeader = table[i];
+    std::memcpy(bufferHeader.name, _buffers[i].first.data(),
+                _buffers[i].first.size());
+    bufferHeader.type        = raw[i].type();
+    bufferHeader.compression = static_cast<uint32_t>(compression);
+    bufferHeader.offset      = offset;
+    bufferHeader.rawBytes    = raw[i].total() * raw[i].elemSize();
+    if (compression == CanvasCheckpoint::Compression::Zlib) {
+      deflated[i]              = DeflateTiles(raw[i], tileSize);
+      bufferHeader.storedBytes = deflated[i].size();
+    } else {
+      bufferHeader.storedBytes = bufferHeader.rawBytes;
+    }
+    offset = AlignUp(offset + bufferHeader.storedBytes);
+  }
+
+  const auto temporary = filename + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      throw std::ios_base::failure(temporary);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+    out.write(reinterpret_cast<const char*>(table.data()),
+              static_cast<std::streamsize>(table.size() * sizeof(BufferHeader)));
+
+    const std::vector<char> padding(DataAlignment, 0);
+    auto position = sizeof(FileHeader) + table.size() * sizeof(BufferHeader);
+    for (auto i = 0U; i < table.size(); i++) {
+      out.write(padding.data(),
+                static_cast<std::streamsize>(table[i].offset - position));
+      const auto* payload =
+        (compression == CanvasCheckpoint::Compression::Zlib)
+          ? deflated[i].data()
+          : raw[i].data;
+      out.write(reinterpret_cast<const char*>(payload),
+                static_cast<std::streamsize>(table[i].storedBytes));
+      position = table[i].offset + table[i].storedBytes;
+    }
+    out.flush();
+    if (!out) {
+      throw std::ios_base::failure(temporary);
+    }
+  }
+  std::filesystem::rename(temporary, filename);
+}
+
+void SaveCheckpoint(const std::string& filename, const Canvas<vec3>& canvas,
+                    const CanvasCheckpoint::Compression compression) {
+  const auto& layer = canvas.getPaintLayer();
+  const auto& r0    = canvas.getR0();
+
+  // drying state as time since the cells were last touched
+  const auto now      = std::chrono::system_clock::now();
+  const auto& timeMap = canvas.getTimeMap();
+  Mat1d age(r0.rows, r0.cols);
+  for (auto i = 0; i < static_cast<int32_t>(age.total()); i++) {
+    age(i) = std::chrono::duration<double, std::milli>(
+               now - timeMap[static_cast<size_t>(i)])
+               .count();
+  }
+
+  CanvasCheckpointWriter writer(
+    {static_cast<uint32_t>(r0.cols), static_cast<uint32_t>(r0.rows)},
+    CanvasCheckpoint::Layout::Host);
+  writer.setDryingTime(canvas.getDryingTime());
+  writer.addBuffer("R0", r0);
+  writer.addBuffer("h", canvas.get_h());
+  writer.addBuffer("K", layer.getK_buffer());
+  writer.addBuffer("S", layer.getS_buffer());
+  writer.addBuffer("V", layer.getV_buffer());
+  writer.addBuffer("t", age);
+  writer.write(filename, compression);
+}
+
+void LoadCheckpoint(const std::string& filename, Canvas<vec3>& canvas) {
+  const CanvasCheckpoint checkpoint(filename);
+  if (checkpoint.getLayout() != CanvasCheckpoint::Layout::Host) {
+    throw std::runtime_error("checkpoint does not hold a Canvas: " + filename);
+  }
+  auto& r0 = canvas.getR0();
+  if ((static_cast<int32_t>(checkpoint.getSize().width) != r0.cols) ||
+      (static_cast<int32_t>(checkpoint.getSize().height) != r0.rows)) {
+    throw std::invalid_argument("checkpoint does not match the canvas size");
+  }
+
+  auto& layer = canvas.getPaintLayer();
+  checkpoint.get<vec3>("R0").copyTo(r0);
+  checkpoint.get<double>("h").copyTo(canvas.get_h());
+  checkpoint.get<vec3>("K").copyTo(layer.getK_buffer());
+  checkpoint.get<vec3>("S").copyTo(layer.getS_buffer());
+  checkpoint.get<double>("V").copyTo(layer.getV_buffer());
+
+  canvas.setDryingTime(checkpoint.getDryingTime());
+  const auto age = checkpoint.get<double>("t");
+  const auto now = std::chrono::system_clock::now();
+  auto& timeMap  = canvas.getTimeMap();
+  for (auto i = 0; i < static_cast<int32_t>(age.total()); i++) {
+    timeMap[static_cast<size_t>(i)] =
+      now - std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              std::chrono::duration<double, std::milli>(age(i)));
+  }
+}
+
+void SaveCheckpoint(const std::string& filename, CanvasCpu& canvas,
+                    const CanvasCheckpoint::Compression compression) {
+  CanvasCheckpointWriter writer(canvas.getSize(),
+                                CanvasCheckpoint::Layout::Shader);
+  writer.addBuffer("R0", canvas.getSubstrate());
+  writer.addBuffer("K", canvas.getK());
+  writer.addBuffer("S", canvas.getS());
+  writer.write(filename, compression);
+}
+
+void LoadCheckpoint(const std::string& filename, CanvasCpu& canvas) {
+  const CanvasCheckpoint checkpoint(filename);
+  if (checkpoint.getLayout() != CanvasCheckpoint::Layout::Shader) {
+    throw std::runtime_error("checkpoint does not hold a CanvasCpu: " +
+                             filename);
+  }
+  if ((checkpoint.getSize().width != canvas.getSize().width) ||
+      (checkpoint.getSize().height != canvas.getSize().height)) {
+    throw std::invalid_argument("checkpoint does not match the canvas size");
+  }
+  checkpoint.get<vec4f>("R0").copyTo(canvas.getSubstrate());
+  checkpoint.get<vec4f>("K").copyTo(canvas.getK());
+  checkpoint.get<vec4f>("S").copyTo(canvas.getS());
+}
+
+void SaveCheckpoint(const std::string& filename, CanvasGpu& canvas,
+                    const CanvasCheckpoint::Compression compression) {
+  auto& r0 = canvas.getSubstrate();
+  auto& K  = canvas.getPaintLayer().getK();
+  auto& S  = canvas.getPaintLayer().getS();
+  r0.download();
+  K.download();
+  S.download();
+
+  CanvasCheckpointWriter writer(canvas.getSize(),
+                                CanvasCheckpoint::Layout::Shader);
+  writer.addBuffer("R0", r0.getMat());
+  writer.addBuffer("K", K.getMat());
+  writer.addBuffer("S", S.getMat());
+  writer.write(filename, compression);
+}
+
+void LoadCheckpoint(const std::string& filename, CanvasGpu& canvas) {
+  const CanvasCheckpoint checkpoint(filename);
+  if (checkpoint.getLayout() != CanvasCheckpoint::Layout::Shader) {
+    throw std::runtime_error("checkpoint does not hold a CanvasGpu: " +
+                             filename);
+  }
+  if ((checkpoint.getSize().width != canvas.getSize().width) ||
+      (checkpoint.getSize().height != canvas.getSize().height)) {
+    throw std::invalid_argument("checkpoint does not match the canvas size");
+  }
+  // GpuMat keeps a reference to the host data, which must not point into the
+  // mapping
+  canvas.getSubstrate().upload(checkpoint.get<vec4f>("R0").clone());
+  canvas.getPaintLayer().getK().upload(checkpoint.get<vec4f>("K").clone());
+  canvas.getPaintLayer().getS().upload(checkpoint.get<vec4f>("S").clone());
+}
+
+}  // namespace painty
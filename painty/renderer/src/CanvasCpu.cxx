@@ -0,0 +1,79 @@
+/**
+ * @file CanvasCpu.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-02
+ *
+ */
+#include "painty/renderer/CanvasCpu.hxx"
+
+#include "painty/io/ImageIO.hxx"
+#include "painty/renderer/CanvasKernelsCpu.hxx"
+
+painty::CanvasCpu::CanvasCpu(const Size& size)
+    : _size(size),
+      _K(static_cast<int32_t>(size.height), static_cast<int32_t>(size.width)),
+      _S(static_cast<int32_t>(size.height), static_cast<int32_t>(size.width)),
+      _r0_substrate(static_cast<int32_t>(size.height),
+                    static_cast<int32_t>(size.width)),
+      _r0_substrate_copy_buffer(static_cast<int32_t>(size.height),
+                                static_cast<int32_t>(size.width)) {
+  clear();
+}
+
+auto painty::CanvasCpu::getSize() const -> const Size& {
+  return _size;
+}
+
+void painty::CanvasCpu::clear() {
+  _K.setTo(cv::Scalar::all(0.0));
+  _S.setTo(cv::Scalar::all(0.0));
+
+  Mat3d canvasPattern = {};
+  io::imRead("data/canvas_patterns/0.png", canvasPattern, true);
+  setSubstrate(ScaledMat(canvasPattern, _size));
+}
+
+void painty::CanvasCpu::setSubstrate(const Mat3d& r0) {
+  if ((r0.cols != _r0_substrate.cols) || (r0.rows != _r0_substrate.rows)) {
+    throw std::invalid_argument("substrate does not match the canvas size");
+  }
+  for (auto i = 0; i < static_cast<int32_t>(r0.total()); i++) {
+    _r0_substrate(i) = {static_cast<float>(r0(i)[0U]),
+                        static_cast<float>(r0(i)[1U]),
+                        static_cast<float>(r0(i)[2U]), 1.0F};
+  }
+}
+
+auto painty::CanvasCpu::getK() -> Mat4f& {
+  return _K;
+}
+
+auto painty::CanvasCpu::getS() -> Mat4f& {
+  return _S;
+}
+
+auto painty::CanvasCpu::getSubstrate() -> Mat4f& {
+  return _r0_substrate;
+}
+
+auto painty::CanvasCpu::getComposed() -> const Mat4f& {
+  _r0_substrate.copyTo(_r0_substrate_copy_buffer);
+  kernels::ComposeLayerOnSubstrate(_r0_substrate_copy_buffer, _K, _S);
+  return _r0_substrate_copy_buffer;
+}
+
+auto painty::CanvasCpu::getCompositionLinearRgb() -> Mat3d {
+  const auto& r0 = getComposed();
+
+  Mat3d rgb(r0.size());
+  for (auto i = 0; i < static_cast<int32_t>(r0.total()); i++) {
+    rgb(i) = {static_cast<double>(r0(i)[0U]), static_cast<double>(r0(i)[1U]),
+              static_cast<double>(r0(i)[2U])};
+  }
+  return rgb;
+}
+
+void painty::CanvasCpu::dryStep(const float step) {
+  kernels::DryingStep(_r0_substrate, _K, _S, step);
+}
@@ -47,6 +47,10 @@ auto painty::CanvasGpu::getPaintLayer() -> PaintLayerGpu& {
   return _paintLayer;
 }
 
+auto painty::CanvasGpu::getSubstrate() -> GpuMat<vec4f>& {
+  return _r0_substrate;
+}
+
 auto painty::CanvasGpu::getComposed() -> const GpuMat<vec4f>& {
   _r0_substrate.getTexture()->copyTo(*_r0_substrate_copy_buffer.getTexture());
   _paintLayer.composeOnto(_r0_substrate_copy_buffer);
@@ -0,0 +1,339 @@
+/**
+ * @file CanvasKernelsCpu.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-02
+ *
+ */
+#include "painty/renderer/CanvasKernelsCpu.hxx"
+
+#include <array>
+
+#include "painty/core/Math.hxx"
+#include "painty/core/Spline.hxx"
+
+namespace painty {
+namespace kernels {
+
+namespace {
+/**
+ * @brief Threshold used by the shaders to skip negligible amounts of paint.
+ *
+ */
+constexpr auto Eps = 10e-6F;
+
+/**
+ * @brief Clip a rectangle to the bounds of the mat.
+ *
+ */
+template <class T>
+auto ClipToMat(const cv::Rect& rect, const Mat<T>& mat) -> cv::Rect {
+  return rect & cv::Rect(0, 0, mat.cols, mat.rows);
+}
+
+auto Rgb(const vec4f& v) -> vec3f {
+  return {v[0U], v[1U], v[2U]};
+}
+
+auto Rgba(const vec3f& v, const float a) -> vec4f {
+  return {v[0U], v[1U], v[2U], a};
+}
+}  // namespace
+
+auto ComputeReflectanceGlsl(const vec3f& K, const vec3f& S, const vec3f& r0,
+                            const float d) -> vec3f {
+  // avoid the division by zero the shaders would run into
+  constexpr auto MinScattering = 0.00000000001F;
+
+  vec3f a   = {};
+  vec3f b   = {};
+  vec3f bSh = {};
+  for (auto i = 0; i < 3; i++) {
+    const auto s = std::max(S[i], MinScattering);
+    a[i]         = 1.0F + K[i] / s;
+    b[i]         = std::sqrt(std::max(a[i] * a[i] - 1.0F, 0.0F));
+    bSh[i]       = b[i] * s * d;
+
+    if (std::fabs(bSh[i]) < Eps) {
+      return r0;
+    }
+  }
+
+  vec3f r = {};
+  for (auto i = 0; i < 3; i++) {
+    const auto bcothbSh = b[i] * coth(bSh[i]);
+    r[i] = (1.0F - r0[i] * (a[i] - bcothbSh)) / (a[i] - r0[i] + bcothbSh);
+  }
+  return r;
+}
+
+void ComposeLayerOnSubstrate(Mat4f& R0, const Mat4f& K, const Mat4f& S) {
+  ForEachTile(cv::Rect(0, 0, R0.cols, R0.rows),
+              [&R0, &K, &S](const cv::Rect& tile) {
+                for (auto y = tile.y; y < (tile.y + tile.height); y++) {
+                  for (auto x = tile.x; x < (tile.x + tile.width); x++) {
+                    const auto d = K(y, x)[3U];
+
+                    auto r0 = Rgb(R0(y, x));
+                    if (std::fabs(d) > Eps) {
+                      r0 = ComputeReflectanceGlsl(Rgb(K(y, x)), Rgb(S(y, x)),
+                                                  r0, d);
+                    }
+                    R0(y, x) = Rgba(r0, 1.0F);
+                  }
+                }
+              });
+}
+
+void DryingStep(Mat4f& R0, Mat4f& K, Mat4f& S, const float dryPortion) {
+  ForEachTile(cv::Rect(0, 0, R0.cols, R0.rows),
+              [&R0, &K, &S, dryPortion](const cv::Rect& tile) {
+                for (auto y = tile.y; y < (tile.y + tile.height); y++) {
+                  for (auto x = tile.x; x < (tile.x + tile.width); x++) {
+                    const auto d          = K(y, x)[3U];
+                    const auto vRemaining = std::max(0.0F, d - dryPortion);
+                    const auto vLeaving   = d - vRemaining;
+
+                    auto r0 = Rgb(R0(y, x));
+                    if (std::fabs(vLeaving) > Eps) {
+                      r0 = ComputeReflectanceGlsl(Rgb(K(y, x)), Rgb(S(y, x)),
+                                                  r0, vLeaving);
+                    }
+                    R0(y, x)    = Rgba(r0, 1.0F);
+                    K(y, x)[3U] = vRemaining;
+                  }
+                }
+              });
+}
+
+void PaintTextureFootprintOnCanvas(const Mat1f& footprint, const cv::Rect& aoi,
+                                   Mat4f& K, Mat4f& S, const vec3f& K_brush,
+                                   const vec3f& S_brush,
+                                   const float thicknessScale) {
+  ForEachTile(
+    ClipToMat(aoi, K), [&](const cv::Rect& tile) {
+      for (auto y = tile.y; y < (tile.y + tile.height); y++) {
+        for (auto x = tile.x; x < (tile.x + tile.width); x++) {
+          const auto vCan = K(y, x)[3U];
+          const auto vTex = thicknessScale * footprint(y, x);
+
+          // compute the total amount of paint
+          const auto vSum = vCan + vTex;
+
+          // only if enough paint will be distributed
+          if (vSum < Eps) {
+            continue;
+          }
+
+          // combine the paints weighted by volume
+          const vec3f Kn = (vCan * Rgb(K(y, x)) + vTex * K_brush) / vSum;
+          const vec3f Sn = (vCan * Rgb(S(y, x)) + vTex * S_brush) / vSum;
+
+          K(y, x) = Rgba(Kn, vSum);
+          S(y, x) = Rgba(Sn, (vTex > 0.0F) ? vTex : vCan);
+        }
+      }
+    });
+}
+
+void Smudge(const Mat1f& footprint, Mat4f& K, Mat4f& S, Mat4f& smudgeK,
+            Mat4f& smudgeS, const vec2i& topLeft, const vec2f& rotationCenter,
+            const float theta, const float thicknessScale) {
+  constexpr auto RateDeposition = 0.7F;
+  constexpr auto RatePickup     = 0.7F;
+
+  const auto cosTheta = std::cos(theta);
+  const auto sinTheta = std::sin(theta);
+
+  for (auto sy = 0; sy < smudgeK.rows; sy++) {
+    for (auto sx = 0; sx < smudgeK.cols; sx++) {
+      const vec2i canvasPos = {topLeft[0U] + sx, topLeft[1U] + sy};
+
+      // don't access outliers
+      if ((canvasPos[0U] < 0) || (canvasPos[1U] < 0) ||
+          (canvasPos[0U] >= K.cols) || (canvasPos[1U] >= K.rows)) {
+        continue;
+      }
+
+      const auto vTex =
+        thicknessScale * footprint(canvasPos[1U], canvasPos[0U]);
+      if (vTex < Eps) {
+        continue;
+      }
+
+      // rotate the position of the smudge map
+      const vec2f pt = {static_cast<float>(sx) - rotationCenter[0U],
+                        static_cast<float>(sy) - rotationCenter[1U]};
+      const vec2i rotatedSmudgePos = {
+        static_cast<int32_t>(pt[0U] * cosTheta - pt[1U] * sinTheta +
+                             rotationCenter[0U]),
+        static_cast<int32_t>(pt[0U] * sinTheta + pt[1U] * cosTheta +
+                             rotationCenter[1U])};
+
+      // don't access outliers
+      if ((rotatedSmudgePos[0U] < 0) || (rotatedSmudgePos[1U] < 0) ||
+          (rotatedSmudgePos[0U] >= smudgeK.cols) ||
+          (rotatedSmudgePos[1U] >= smudgeK.rows)) {
+        continue;
+      }
+
+      auto& cK = K(canvasPos[1U], canvasPos[0U]);
+      auto& cS = S(canvasPos[1U], canvasPos[0U]);
+      auto& pK = smudgeK(rotatedSmudgePos[1U], rotatedSmudgePos[0U]);
+      auto& pS = smudgeS(rotatedSmudgePos[1U], rotatedSmudgePos[0U]);
+
+      const auto canvasK = Rgb(cK);
+      const auto canvasS = Rgb(cS);
+      const auto cV      = cK[3U];
+      const auto pickK   = Rgb(pK);
+      const auto pickS   = Rgb(pS);
+      const auto pV      = pK[3U];
+
+      // volume of paint pickup from canvas
+      const auto cVl = cV * RateDeposition * vTex;
+      const auto cVr = cV - cVl;
+
+      // volume of paint distributed to canvas
+      const auto pVl = pV * RatePickup * vTex;
+      const auto pVr = pV - pVl;
+
+      // pickup from canvas
+      const auto pVnew = pVr + cVl;
+      if (pVnew > 0.0F) {
+        pK = Rgba((pVr * pickK + cVl * canvasK) / pVnew, pVnew);
+        pS = Rgba((pVr * pickS + cVl * canvasS) / pVnew, pVnew);
+      }
+
+      // deposition to canvas
+      const auto cVnew = cVr + pVl;
+      if (cVnew > 0.0F) {
+        cK = Rgba((cVr * pickK + pVl * canvasK) / cVnew, cVnew);
+        cS = Rgba((cVr * pickS + pVl * canvasS) / cVnew, vTex);
+      }
+    }
+  }
+}
+
+void ClearTextureFootprint(Mat1f& footprint, const cv::Rect& aoi) {
+  ForEachTile(ClipToMat(aoi, footprint), [&footprint](const cv::Rect& tile) {
+    footprint(tile).setTo(0.0F);
+  });
+}
+
+auto BrushTextureWarp(const Mat1d& brushTexture, const std::vector<vec2>& path,
+                      const double radius, Mat1f& footprint) -> cv::Rect {
+  if (path.size() < 2UL) {
+    return {};
+  }
+
+  // the vertices of the triangle strip, right and left of the spine
+  SplineEval<std::vector<vec2>::const_iterator> spineSpline(path.cbegin(),
+                                                            path.cend());
+  std::vector<vec2> vertices;
+  std::vector<vec2> texCoords;
+  for (auto i = 0U; i < path.size(); ++i) {
+    const auto u = static_cast<double>(i) / static_cast<double>(path.size() - 1);
+    const auto c = spineSpline.catmullRom(u);
+
+    // spine tangent vector
+    const auto t = spineSpline.catmullRomDerivativeFirst(u).normalized();
+
+    // compute perpendicular vector to spine
+    const vec2 d = {-t[1U], t[0U]};
+
+    vertices.push_back(c + radius * d);
+    vertices.push_back(c - radius * d);
+
+    texCoords.emplace_back(u, 0.0);
+    texCoords.emplace_back(u, 1.0);
+  }
+
+  struct Triangle {
+    std::array<size_t, 3UL> indices;
+    cv::Rect bounds;
+    double area;
+  };
+  std::vector<Triangle> triangles;
+  cv::Rect aoi = {};
+  for (auto i = 0UL; (i + 2UL) < vertices.size(); i++) {
+    const auto& p0 = vertices[i];
+    const auto& p1 = vertices[i + 1UL];
+    const auto& p2 = vertices[i + 2UL];
+
+    const auto area = (p1[0U] - p0[0U]) * (p2[1U] - p0[1U]) -
+                      (p2[0U] - p0[0U]) * (p1[1U] - p0[1U]);
+    if (std::fabs(area) < std::numeric_limits<double>::epsilon()) {
+      continue;
+    }
+
+    const auto xMin =
+      static_cast<int32_t>(std::floor(std::min({p0[0U], p1[0U], p2[0U]})));
+    const auto yMin =
+      static_cast<int32_t>(std::floor(std::min({p0[1U], p1[1U], p2[1U]})));
+    const auto xMax =
+      static_cast<int32_t>(std::ceil(std::max({p0[0U], p1[0U], p2[0U]})));
+    const auto yMax =
+      static_cast<int32_t>(std::ceil(std::max({p0[1U], p1[1U], p2[1U]})));
+    const auto bounds = ClipToMat(
+      cv::Rect(xMin, yMin, xMax - xMin + 1, yMax - yMin + 1), footprint);
+    if (bounds.empty()) {
+      continue;
+    }
+
+    triangles.push_back({{i, i + 1UL, i + 2UL}, bounds, area});
+    aoi = aoi.empty() ? bounds : (aoi | bounds);
+  }
+
+  const auto texCols = static_cast<double>(brushTexture.cols);
+  const auto texRows = static_cast<double>(brushTexture.rows);
+
+  // Every tile walks the triangles in strip order, overlapping triangles are
+  // resolved like the depth test free rasterization on the gpu: last one wins.
+  ForEachTile(aoi, [&](const cv::Rect& tile) {
+    for (const auto& triangle : triangles) {
+      const auto region = triangle.bounds & tile;
+      if (region.empty()) {
+        continue;
+      }
+
+      const auto& p0 = vertices[triangle.indices[0U]];
+      const auto& p1 = vertices[triangle.indices[1U]];
+      const auto& p2 = vertices[triangle.indices[2U]];
+      const auto& t0 = texCoords[triangle.indices[0U]];
+      const auto& t1 = texCoords[triangle.indices[1U]];
+      const auto& t2 = texCoords[triangle.indices[2U]];
+
+      for (auto y = region.y; y < (region.y + region.height); y++) {
+        for (auto x = region.x; x < (region.x + region.width); x++) {
+          // sample at pixel centers
+          const vec2 p = {static_cast<double>(x) + 0.5,
+                          static_cast<double>(y) + 0.5};
+
+          const auto w0 = ((p1[0U] - p[0U]) * (p2[1U] - p[1U]) -
+                           (p2[0U] - p[0U]) * (p1[1U] - p[1U])) /
+                          triangle.area;
+          const auto w1 = ((p2[0U] - p[0U]) * (p0[1U] - p[1U]) -
+                           (p0[0U] - p[0U]) * (p2[1U] - p[1U])) /
+                          triangle.area;
+          const auto w2 = 1.0 - w0 - w1;
+          if ((w0 < 0.0) || (w1 < 0.0) || (w2 < 0.0)) {
+            continue;
+          }
+
+          const vec2 uv = w0 * t0 + w1 * t1 + w2 * t2;
+
+          // the gpu texture is stored flipped, v = 0 maps to the last row
+          const vec2 texPos = {uv[0U] * texCols - 0.5,
+                               (1.0 - uv[1U]) * texRows - 0.5};
+          footprint(y, x) = static_cast<float>(
+            Interpolate(brushTexture, texPos, cv::BORDER_REPLICATE));
+        }
+      }
+    }
+  });
+
+  return aoi;
+}
+
+}  // namespace kernels
+}  // namespace painty
@@ -0,0 +1,96 @@
+/**
+ * @file RenderBackend.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-02
+ *
+ */
+#include "painty/renderer/RenderBackend.hxx"
+
+namespace painty {
+
+RenderBackend::~RenderBackend() = default;
+
+void RenderBackend::present() {}
+
+RenderBackendGpu::RenderBackendGpu(const Size& size, prgl::Window& window)
+    : _canvas(size),
+      _brush(),
+      _window(window) {}
+
+auto RenderBackendGpu::getSize() const -> Size {
+  return _canvas.getSize();
+}
+
+void RenderBackendGpu::paintStroke(const std::vector<vec2>& path,
+                                   const double radius,
+                                   const std::array<vec3, 2UL>& ks) {
+  _brush.dip(ks);
+  _brush.setRadius(radius);
+  _brush.paintStroke(path, _canvas);
+}
+
+auto RenderBackendGpu::getCompositionLinearRgb() -> Mat3d {
+  return _canvas.getCompositionLinearRgb();
+}
+
+void RenderBackendGpu::dryStep(const float step) {
+  _canvas.dryStep(step);
+}
+
+void RenderBackendGpu::setBrushThicknessScale(const double scale) {
+  _brush.setThicknessScale(scale);
+}
+
+void RenderBackendGpu::enableSmudge(const bool enable) {
+  _brush.enableSmudge(enable);
+}
+
+void RenderBackendGpu::setSeed(const uint32_t seed) {
+  _brush.setSeed(seed);
+}
+
+void RenderBackendGpu::present() {
+  _canvas.getComposed().getTexture()->render(
+    0.0F, 0.0F, static_cast<float>(_window.getWidth()),
+    static_cast<float>(_window.getHeight()), true);
+  _window.update(false);
+}
+
+RenderBackendCpu::RenderBackendCpu(const Size& size)
+    : _canvas(size),
+      _brush() {}
+
+auto RenderBackendCpu::getSize() const -> Size {
+  return _canvas.getSize();
+}
+
+void RenderBackendCpu::paintStroke(const std::vector<vec2>& path,
+                                   const double radius,
+                                   const std::array<vec3, 2UL>& ks) {
+  _brush.dip(ks);
+  _brush.setRadius(radius);
+  _brush.paintStroke(path, _canvas);
+}
+
+auto RenderBackendCpu::getCompositionLinearRgb() -> Mat3d {
+  return _canvas.getCompositionLinearRgb();
+}
+
+void RenderBackendCpu::dryStep(const float step) {
+  _canvas.dryStep(step);
+}
+
+void RenderBackendCpu::setBrushThicknessScale(const double scale) {
+  _brush.setThicknessScale(scale);
+}
+
+void RenderBackendCpu::enableSmudge(const bool enable) {
+  _brush.enableSmudge(enable);
+}
+
+void RenderBackendCpu::setSeed(const uint32_t seed) {
+  _brush.setSeed(seed);
+}
+
+}  // namespace painty
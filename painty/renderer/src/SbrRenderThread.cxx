@@ -7,36 +7,54 @@
  */
 #include "painty/renderer/SbrRenderThread.hxx"
 
+#include <random>
+
 painty::SbrRenderThread::SbrRenderThread(
   const std::shared_ptr<GpuTaskQueue>& gpuTaskQueue, const Size& canvasSize)
-    : _brushPtr(nullptr),
-      _canvasPtr(nullptr),
+    : _backendPtr(nullptr),
+      _backendType(RenderBackend::Type::Gpu),
       _canvasSize(canvasSize),
       _gpuTaskQueue(gpuTaskQueue) {
-  _brushPtr = _gpuTaskQueue
-                ->add_task([]() -> std::unique_ptr<TextureBrushGpu> {
-                  return std::make_unique<TextureBrushGpu>();
-                })
-                .get();
-
-  _canvasPtr = _gpuTaskQueue
-                 ->add_task([canvasSize]() -> std::unique_ptr<CanvasGpu> {
-                   return std::make_unique<CanvasGpu>(canvasSize);
-                 })
-                 .get();
+  _backendPtr =
+    _gpuTaskQueue
+      ->add_task([this, canvasSize]() -> std::unique_ptr<RenderBackend> {
+        return std::make_unique<RenderBackendGpu>(canvasSize,
+                                                  _gpuTaskQueue->getWindow());
+      })
+      .get();
+
+  startTimers();
+}
 
+painty::SbrRenderThread::SbrRenderThread(const Size& canvasSize)
+    : _backendPtr(nullptr),
+      _backendType(RenderBackend::Type::Cpu),
+      _canvasSize(canvasSize),
+      _gpuTaskQueue(nullptr),
+      _cpuTaskQueue(std::make_unique<ThreadPool>(ThreadCount)) {
+  _backendPtr = submit([canvasSize]() -> std::unique_ptr<RenderBackend> {
+                  return std::make_unique<RenderBackendCpu>(canvasSize);
+                }).get();
+
+  startTimers();
+}
+
+void painty::SbrRenderThread::startTimers() {
   _timerWindowUpdate.start(std::chrono::milliseconds(500U), [this]() {
-    _gpuTaskQueue->add_task([this]() {
-      _canvasPtr->getComposed().getTexture()->render(
-        0.0F, 0.0F, static_cast<float>(_gpuTaskQueue->getWindow().getWidth()),
-        static_cast<float>(_gpuTaskQueue->getWindow().getHeight()), true);
-      _gpuTaskQueue->getWindow().update(false);
+    submit([this]() {
+      _backendPtr->present();
     });
   });
 
   _timerDryStep.start(std::chrono::milliseconds(250U), [this]() {
-    _gpuTaskQueue->add_task([this]() {
-      _canvasPtr->dryStep();
+    submit([this]() {
+      // checked here to not dry in between tasks queued after disabling it
+      if (_autoDrying) {
+        _backendPtr->dryStep(0.01F);
+        if (_strokeLog != nullptr) {
+          _strokeLog->dry(0.01F);
+        }
+      }
     });
   });
 }
@@ -45,18 +63,20 @@ painty::SbrRenderThread::~SbrRenderThread() {
   _timerDryStep.stop();
   _timerWindowUpdate.stop();
 
-  _gpuTaskQueue
-    ->add_task([this]() {
-      _brushPtr  = nullptr;
-      _canvasPtr = nullptr;
-    })
-    .wait();
+  submit([this]() {
+    _strokeLog  = nullptr;
+    _backendPtr = nullptr;
+  }).wait();
 }
 
 auto painty::SbrRenderThread::getSize() const -> Size {
   return _canvasSize;
 }
 
+auto painty::SbrRenderThread::getBackendType() const -> RenderBackend::Type {
+  return _backendType;
+}
+
 auto painty::SbrRenderThread::getBrushThicknessScale() const -> double {
   return _thicknessScale;
 }
@@ -65,35 +85,85 @@ auto painty::SbrRenderThread::render(const std::vector<vec2>& path,
                                      const double radius,
                                      const std::array<vec3, 2UL>& ks)
   -> std::future<void> {
-  return _gpuTaskQueue->add_task([path, radius, ks, this]() {
-    _brushPtr->dip(ks);
-    _brushPtr->setRadius(radius);
-    _brushPtr->paintStroke(path, *_canvasPtr);
+  return submit([path, radius, ks, this]() {
+    _backendPtr->paintStroke(path, radius, ks);
+    if (_strokeLog != nullptr) {
+      _strokeLog->addStroke(path, radius, ks);
+    }
   });
 }
 
 auto painty::SbrRenderThread::getLinearRgbImage() -> std::future<Mat3d> {
-  auto future = _gpuTaskQueue->add_task([this]() -> Mat3d {
-    return _canvasPtr->getCompositionLinearRgb();
+  auto future = submit([this]() -> Mat3d {
+    return _backendPtr->getCompositionLinearRgb();
   });
   return future;
 }
 
 void painty::SbrRenderThread::setBrushThicknessScale(const double scale) {
   _thicknessScale = scale;
-  _gpuTaskQueue->add_task([this, scale]() {
-    _brushPtr->setThicknessScale(scale);
+  submit([this, scale]() {
+    _backendPtr->setBrushThicknessScale(scale);
+    if (_strokeLog != nullptr) {
+      _strokeLog->setThicknessScale(scale);
+    }
   });
 }
 
 void painty::SbrRenderThread::enableSmudge(bool enable) {
-  _gpuTaskQueue->add_task([this, enable]() {
-    _brushPtr->enableSmudge(enable);
+  _smudge = enable;
+  submit([this, enable]() {
+    _backendPtr->enableSmudge(enable);
+    if (_strokeLog != nullptr) {
+      _strokeLog->enableSmudge(enable);
+    }
   });
 }
 
 auto painty::SbrRenderThread::dryCanvas() -> std::future<void> {
-  return _gpuTaskQueue->add_task([this]() {
-    _canvasPtr->dryStep(1.0F);
+  return dryStep(1.0F);
+}
+
+auto painty::SbrRenderThread::dryStep(const float portion)
+  -> std::future<void> {
+  return submit([this, portion]() {
+    _backendPtr->dryStep(portion);
+    if (_strokeLog != nullptr) {
+      _strokeLog->dry(portion);
+    }
+  });
+}
+
+void painty::SbrRenderThread::enableAutoDrying(const bool enable) {
+  _autoDrying = enable;
+}
+
+auto painty::SbrRenderThread::isAutoDryingEnabled() const -> bool {
+  return _autoDrying;
+}
+
+void painty::SbrRenderThread::setSeed(const uint32_t seed) {
+  submit([this, seed]() {
+    _backendPtr->setSeed(seed);
+    if (_strokeLog != nullptr) {
+      _strokeLog->setSeed(seed);
+    }
+  });
+}
+
+void painty::SbrRenderThread::setStrokeLog(
+  const std::shared_ptr<StrokeLogWriter>& strokeLog) {
+  // the state set so far is part of the log
+  const auto seed           = std::random_device()();
+  const auto thicknessScale = _thicknessScale;
+  const auto smudge         = _smudge;
+  submit([this, strokeLog, seed, thicknessScale, smudge]() {
+    _strokeLog = strokeLog;
+    if (_strokeLog != nullptr) {
+      _backendPtr->setSeed(seed);
+      _strokeLog->setSeed(seed);
+      _strokeLog->setThicknessScale(thicknessScale);
+      _strokeLog->enableSmudge(smudge);
+    }
   });
 }
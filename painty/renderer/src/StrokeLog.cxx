@@ -0,0 +1,390 @@
+/**
+ * @file StrokeLog.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-12
+ *
+ */
+#include "painty/renderer/StrokeLog.hxx"
+
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <map>
+
+#include "painty/renderer/SbrRenderThread.hxx"
+
+namespace painty {
+
+namespace {
+constexpr char Magic[8U] = {'P', 'A', 'I', 'N', 'T', 'Y', 'S', 'L'};
+
+template <class T>
+void PutRaw(std::vector<uint8_t>& buffer, const T& value) {
+  const auto size = buffer.size();
+  buffer.resize(size + sizeof(T));
+  std::memcpy(buffer.data() + size, &value, sizeof(T));
+}
+
+void PutVarint(std::vector<uint8_t>& buffer, uint64_t value) {
+  while (value >= 0x80U) {
+    buffer.push_back(static_cast<uint8_t>(value | 0x80U));
+    value >>= 7U;
+  }
+  buffer.push_back(static_cast<uint8_t>(value));
+}
+
+void PutZigZag(std::vector<uint8_t>& buffer, const int64_t value) {
+  PutVarint(buffer, (static_cast<uint64_t>(value) << 1U) ^
+                      static_cast<uint64_t>(value >> 63));
+}
+
+template <class T>
+auto GetRaw(std::istream& in, T& value) -> bool {
+  return static_cast<bool>(
+    in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+auto GetVarint(std::istream& in, uint64_t& value) -> bool {
+  value = 0U;
+  for (auto shift = 0U; shift < 64U; shift += 7U) {
+    const auto c = in.get();
+    if (c == std::char_traits<char>::eof()) {
+      return false;
+    }
+    value |= static_cast<uint64_t>(c & 0x7F) << shift;
+    if ((c & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+auto GetZigZag(std::istream& in, int64_t& value) -> bool {
+  uint64_t encoded = 0U;
+  if (!GetVarint(in, encoded)) {
+    return false;
+  }
+  value = static_cast<int64_t>(encoded >> 1U) ^
+          -static_cast<int64_t>(encoded & 1U);
+  return true;
+}
+}  // namespace
+
+StrokeLogWriter::StrokeLogWriter(const std::string& filename,
+                                 const Size& canvasSize)
+    : _file(std::make_unique<std::ofstream>(filename, std::ios::binary)),
+      _out(*_file),
+      _canvasSize(canvasSize) {
+  if (!_file->is_open()) {
+    throw std::ios_base::failure(filename);
+  }
+  writeHeader();
+}
+
+StrokeLogWriter::StrokeLogWriter(std::ostream& out, const Size& canvasSize)
+    : _file(nullptr),
+      _out(out),
+      _canvasSize(canvasSize) {
+  writeHeader();
+}
+
+StrokeLogWriter::~StrokeLogWriter() {
+  _out.flush();
+}
+
+void StrokeLogWriter::writeHeader() {
+  _buffer.clear();
+  _buffer.insert(_buffer.end(), std::begin(Magic), std::end(Magic));
+  PutRaw(_buffer, Version);
+  PutRaw(_buffer, _canvasSize.width);
+  PutRaw(_buffer, _canvasSize.height);
+  PutRaw(_buffer, Quantization);
+  _out.write(reinterpret_cast<const char*>(_buffer.data()),
+             static_cast<std::streamsize>(_buffer.size()));
+}
+
+auto StrokeLogWriter::paintIndex(const std::array<vec3, 2UL>& ks) -> uint32_t {
+  const std::array<double, 6UL> key = {ks[0U][0U], ks[0U][1U], ks[0U][2U],
+                                       ks[1U][0U], ks[1U][1U], ks[1U][2U]};
+  const auto it = _paintIndices.find(key);
+  if (it != _paintIndices.end()) {
+    return it->second;
+  }
+
+  // the first use of a paint adds it to the palette
+  const auto index = static_cast<uint32_t>(_paintIndices.size());
+  _paintIndices.emplace(key, index);
+  _buffer.push_back(static_cast<uint8_t>(StrokeLogRecord::Type::Paint));
+  for (const auto v : key) {
+    PutRaw(_buffer, v);
+  }
+  return index;
+}
+
+void StrokeLogWriter::addStroke(const std::vector<vec2>& path,
+                                const double radius,
+                                const std::array<vec3, 2UL>& ks) {
+  _buffer.clear();
+  const auto index = paintIndex(ks);
+
+  _buffer.push_back(static_cast<uint8_t>(StrokeLogRecord::Type::Stroke));
+  PutVarint(_buffer, index);
+  PutRaw(_buffer, static_cast<float>(radius));
+  PutVarint(_buffer, path.size());
+  int64_t px = 0;
+  int64_t py = 0;
+  for (const auto& p : path) {
+    const auto x = static_cast<int64_t>(
+      std::llround(p[0U] * static_cast<double>(Quantization)));
+    const auto y = static_cast<int64_t>(
+      std::llround(p[1U] * static_cast<double>(Quantization)));
+    PutZigZag(_buffer, x - px);
+    PutZigZag(_buffer, y - py);
+    px = x;
+    py = y;
+  }
+  _out.write(reinterpret_cast<const char*>(_buffer.data()),
+             static_cast<std::streamsize>(_buffer.size()));
+
+  _strokeCount++;
+  if ((_strokeCount % FlushInterval) == 0UL) {
+    _out.flush();
+  }
+}
+
+void StrokeLogWriter::setThicknessScale(const double scale) {
+  _buffer.clear();
+  _buffer.push_back(
+    static_cast<uint8_t>(StrokeLogRecord::Type::ThicknessScale));
+  PutRaw(_buffer, scale);
+  _out.write(reinterpret_cast<const char*>(_buffer.data()),
+             static_cast<std::streamsize>(_buffer.size()));
+}
+
+void StrokeLogWriter::dry(const float portion) {
+  _buffer.clear();
+  _buffer.push_back(static_cast<uint8_t>(StrokeLogRecord::Type::Dry));
+  PutRaw(_buffer, portion);
+  _out.write(reinterpret_cast<const char*>(_buffer.data()),
+             static_cast<std::streamsize>(_buffer.size()));
+}
+
+void StrokeLogWriter::enableSmudge(const bool enable) {
+  _buffer.clear();
+  _buffer.push_back(static_cast<uint8_t>(StrokeLogRecord::Type::Smudge));
+  _buffer.push_back(static_cast<uint8_t>(enable ? 1U : 0U));
+  _out.write(reinterpret_cast<const char*>(_buffer.data()),
+             static_cast<std::streamsize>(_buffer.size()));
+}
+
+void StrokeLogWriter::setSeed(const uint32_t seed) {
+  _buffer.clear();
+  _buffer.push_back(static_cast<uint8_t>(StrokeLogRecord::Type::Seed));
+  PutRaw(_buffer, seed);
+  _out.write(reinterpret_cast<const char*>(_buffer.data()),
+             static_cast<std::streamsize>(_buffer.size()));
+}
+
+void StrokeLogWriter::flush() {
+  _out.flush();
+}
+
+auto StrokeLogWriter::getStrokeCount() const -> std::size_t {
+  return _strokeCount;
+}
+
+StrokeLogReader::StrokeLogReader(const std::string& filename)
+    : _file(std::make_unique<std::ifstream>(filename, std::ios::binary)),
+      _in(*_file) {
+  if (!_file->is_open()) {
+    throw std::ios_base::failure(filename);
+  }
+  readHeader();
+}
+
+StrokeLogReader::StrokeLogReader(std::istream& in) : _file(nullptr), _in(in) {
+  readHeader();
+}
+
+void StrokeLogReader::readHeader() {
+  char magic[8U] = {};
+  uint32_t version = 0U;
+  if (!_in.read(magic, sizeof(magic)) ||
+      (std::memcmp(magic, Magic, sizeof(Magic)) != 0) ||
+      !GetRaw(_in, version) || !GetRaw(_in, _canvasSize.width) ||
+      !GetRaw(_in, _canvasSize.height) || !GetRaw(_in, _quantization) ||
+      (_quantization == 0U)) {
+    throw std::runtime_error("not a painty stroke log");
+  }
+  if ((version == 0U) || (version > StrokeLogWriter::Version)) {
+    throw std::runtime_error("unsupported stroke log version: " +
+                             std::to_string(version));
+  }
+}
+
+auto StrokeLogReader::getCanvasSize() const -> Size {
+  return _canvasSize;
+}
+
+auto StrokeLogReader::isTruncated() const -> bool {
+  return _truncated;
+}
+
+auto StrokeLogReader::next(StrokeLogRecord& record) -> bool {
+  const auto truncated = [this]() {
+    _truncated = true;
+    return false;
+  };
+
+  while (true) {
+    const auto tag = _in.get();
+    if (tag == std::char_traits<char>::eof()) {
+      return false;
+    }
+
+    switch (static_cast<StrokeLogRecord::Type>(tag)) {
+      case StrokeLogRecord::Type::Paint: {
+        std::array<double, 6UL> values = {};
+        for (auto& v : values) {
+          if (!GetRaw(_in, v)) {
+            return truncated();
+          }
+        }
+        _palette.push_back({vec3(values[0U], values[1U], values[2U]),
+                            vec3(values[3U], values[4U], values[5U])});
+        // not reported, continue with the stroke using it
+        continue;
+      }
+      case StrokeLogRecord::Type::Stroke: {
+        uint64_t index  = 0U;
+        float radius    = 0.0F;
+        uint64_t length = 0U;
+        if (!GetVarint(_in, index) || !GetRaw(_in, radius) ||
+            !GetVarint(_in, length)) {
+          return truncated();
+        }
+        if (index >= _palette.size()) {
+          throw std::runtime_error("stroke log references unknown paint");
+        }
+        record.type   = StrokeLogRecord::Type::Stroke;
+        record.radius = static_cast<double>(radius);
+        record.ks     = _palette[static_cast<std::size_t>(index)];
+        record.path.resize(static_cast<std::size_t>(length));
+        const auto scale = 1.0 / static_cast<double>(_quantization);
+        int64_t x        = 0;
+        int64_t y        = 0;
+        for (auto& p : record.path) {
+          int64_t dx = 0;
+          int64_t dy = 0;
+          if (!GetZigZag(_in, dx) || !GetZigZag(_in, dy)) {
+            return truncated();
+          }
+          x += dx;
+          y += dy;
+          p = {static_cast<double>(x) * scale, static_cast<double>(y) * scale};
+        }
+        return true;
+      }
+      case StrokeLogRecord::Type::ThicknessScale: {
+        record.type = StrokeLogRecord::Type::ThicknessScale;
+        return GetRaw(_in, record.value) ? true : truncated();
+      }
+      case StrokeLogRecord::Type::Dry: {
+        float portion = 0.0F;
+        if (!GetRaw(_in, portion)) {
+          return truncated();
+        }
+        record.type  = StrokeLogRecord::Type::Dry;
+        record.value = static_cast<double>(portion);
+        return true;
+      }
+      case StrokeLogRecord::Type::Smudge: {
+        uint8_t enable = 0U;
+        if (!GetRaw(_in, enable)) {
+          return truncated();
+        }
+        record.type  = StrokeLogRecord::Type::Smudge;
+        record.value = (enable != 0U) ? 1.0 : 0.0;
+        return true;
+      }
+      case StrokeLogRecord::Type::Seed: {
+        uint32_t seed = 0U;
+        if (!GetRaw(_in, seed)) {
+          return truncated();
+        }
+        record.type  = StrokeLogRecord::Type::Seed;
+        record.value = static_cast<double>(seed);
+        return true;
+      }
+    }
+    throw std::runtime_error("unknown stroke log record: " +
+                             std::to_string(tag));
+  }
+}
+
+auto ReplayStrokeLog(StrokeLogReader& reader, SbrRenderThread& renderThread,
+                     const std::size_t batchSize) -> std::size_t {
+  const auto autoDrying = renderThread.isAutoDryingEnabled();
+  renderThread.enableAutoDrying(false);
+
+  const auto logSize    = reader.getCanvasSize();
+  const auto targetSize = renderThread.getSize();
+  const auto xs         = static_cast<double>(targetSize.width) /
+                  static_cast<double>(std::max(logSize.width, 1U));
+  const auto ys = static_cast<double>(targetSize.height) /
+                  static_cast<double>(std::max(logSize.height, 1U));
+
+  auto strokeCount = 0UL;
+  std::vector<std::future<void>> batch;
+  StrokeLogRecord record;
+  while (reader.next(record)) {
+    switch (record.type) {
+      case StrokeLogRecord::Type::Stroke: {
+        for (auto& p : record.path) {
+          p[0U] *= xs;
+          p[1U] *= ys;
+        }
+        batch.push_back(renderThread.render(
+          record.path, ((xs + ys) * 0.5) * record.radius, record.ks));
+        strokeCount++;
+        break;
+      }
+      case StrokeLogRecord::Type::ThicknessScale: {
+        renderThread.setBrushThicknessScale(record.value);
+        break;
+      }
+      case StrokeLogRecord::Type::Dry: {
+        batch.push_back(renderThread.dryStep(static_cast<float>(record.value)));
+        break;
+      }
+      case StrokeLogRecord::Type::Smudge: {
+        renderThread.enableSmudge(record.value > 0.0);
+        break;
+      }
+      case StrokeLogRecord::Type::Seed: {
+        renderThread.setSeed(static_cast<uint32_t>(record.value));
+        break;
+      }
+      case StrokeLogRecord::Type::Paint: {
+        break;
+      }
+    }
+
+    // bound the number of queued tasks
+    if (batch.size() >= batchSize) {
+      for (auto& f : batch) {
+        f.wait();
+      }
+      batch.clear();
+    }
+  }
+  for (auto& f : batch) {
+    f.wait();
+  }
+
+  renderThread.enableAutoDrying(autoDrying);
+  return strokeCount;
+}
+
+}  // namespace painty
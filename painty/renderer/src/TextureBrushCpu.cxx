@@ -0,0 +1,160 @@
+/**
+ * @file TextureBrushCpu.cxx
+ * @author Thomas Lindemeier
+ * @brief
+ * @date 2020-11-02
+ *
+ */
+#include "painty/renderer/TextureBrushCpu.hxx"
+
+#include "painty/core/Spline.hxx"
+#include "painty/renderer/CanvasKernelsCpu.hxx"
+
+painty::TextureBrushCpu::TextureBrushCpu()
+    : _textureBrushDictionary(false),
+      _warpedBrushTexture(),
+      _smudgeK(10, 10),
+      _smudgeS(10, 10) {
+  for (auto& c : _paintStored) {
+    c.fill(0.1);
+  }
+  setRadius(5.0);
+}
+
+void painty::TextureBrushCpu::setRadius(const double radius) {
+  constexpr auto Eps = 0.5;
+  if (!fuzzyCompare(_radius, radius, Eps)) {
+    _radius = radius;
+
+    const auto smudgeWindowSize = static_cast<int32_t>(2.0 * radius) + 1;
+
+    _smudgeK = Mat4f(smudgeWindowSize, smudgeWindowSize);
+    _smudgeS = Mat4f(smudgeWindowSize, smudgeWindowSize);
+
+    _smudgeK.setTo(cv::Scalar::all(0.0));
+    _smudgeS.setTo(cv::Scalar::all(0.0));
+  }
+}
+
+void painty::TextureBrushCpu::dip(const std::array<vec3, 2UL>& paint) {
+  _paintStored = paint;
+}
+
+void painty::TextureBrushCpu::paintStroke(const std::vector<vec2>& vertices,
+                                          Canvas<vec3>& canvas) {
+  if (vertices.size() < 2UL) {
+    return;
+  }
+  auto& layer = canvas.getPaintLayer();
+  auto& K     = layer.getK_buffer();
+  auto& S     = layer.getS_buffer();
+  auto& V     = layer.getV_buffer();
+
+  const auto aoi = generateWarpedTexture(
+    vertices, Size{static_cast<uint32_t>(layer.getCols()),
+                   static_cast<uint32_t>(layer.getRows())});
+
+  const auto thicknessScale = getThicknessScale();
+  const auto& K_brush       = _paintStored.front();
+  const auto& S_brush       = _paintStored.back();
+  kernels::ForEachTile(aoi, [&](const cv::Rect& tile) {
+    constexpr auto Eps = 10e-6;
+    for (auto y = tile.y; y < (tile.y + tile.height); y++) {
+      for (auto x = tile.x; x < (tile.x + tile.width); x++) {
+        const auto vCan = V(y, x);
+        const auto vTex =
+          thicknessScale * static_cast<double>(_warpedBrushTexture(y, x));
+        const auto vSum = vCan + vTex;
+        if (vSum < Eps) {
+          continue;
+        }
+
+        K(y, x) = (vCan * K(y, x) + vTex * K_brush) / vSum;
+        S(y, x) = (vCan * S(y, x) + vTex * S_brush) / vSum;
+        V(y, x) = vSum;
+      }
+    }
+  });
+
+  kernels::ClearTextureFootprint(_warpedBrushTexture, aoi);
+}
+
+void painty::TextureBrushCpu::paintStroke(const std::vector<vec2>& vertices,
+                                          CanvasCpu& canvas) {
+  if (vertices.size() < 2UL) {
+    return;
+  }
+
+  const auto aoi = generateWarpedTexture(vertices, canvas.getSize());
+
+  if (_smudge) {
+    smudge(vertices, canvas);
+  }
+
+  // imprint the canvas using the warped brush textrure
+  kernels::PaintTextureFootprintOnCanvas(
+    _warpedBrushTexture, aoi, canvas.getK(), canvas.getS(),
+    _paintStored.front().cast<float>(), _paintStored.back().cast<float>(),
+    static_cast<float>(getThicknessScale()));
+
+  // clear the warped brush texture for next brush stroke
+  kernels::ClearTextureFootprint(_warpedBrushTexture, aoi);
+}
+
+auto painty::TextureBrushCpu::generateWarpedTexture(
+  const std::vector<vec2>& vertices, const Size& size) -> cv::Rect {
+  if ((static_cast<uint32_t>(_warpedBrushTexture.rows) != size.height) ||
+      (static_cast<uint32_t>(_warpedBrushTexture.cols) != size.width)) {
+    _warpedBrushTexture = Mat1f(static_cast<int32_t>(size.height),
+                                static_cast<int32_t>(size.width), 0.0F);
+  }
+
+  const auto brushTexture =
+    _textureBrushDictionary.lookup(vertices, 2.0 * _radius).texHost;
+
+  return kernels::BrushTextureWarp(brushTexture, vertices, _radius,
+                                   _warpedBrushTexture);
+}
+
+void painty::TextureBrushCpu::enableSmudge(bool enable) {
+  _smudge = enable;
+}
+
+void painty::TextureBrushCpu::setSeed(const uint32_t seed) {
+  _textureBrushDictionary.setSeed(seed);
+}
+
+void painty::TextureBrushCpu::smudge(const std::vector<vec2>& vertices,
+                                     CanvasCpu& canvas) {
+  auto length = 0.0;
+  for (auto i = 1UL; i < vertices.size(); ++i) {
+    length += (vertices[i] - vertices[i - 1U]).norm();
+  }
+  SplineEval<std::vector<vec2>::const_iterator> spineSpline(vertices.cbegin(),
+                                                            vertices.cend());
+
+  const vec2f smudgeMapCenter = {static_cast<float>(_smudgeK.cols) * 0.5F,
+                                 static_cast<float>(_smudgeK.rows) * 0.5F};
+  vec2i lastPoint = {-1, -1};
+  for (auto u = 0.0; u <= 1.0; u += (0.25 / length)) {
+    const auto canvasCenter = spineSpline.catmullRom(u);
+
+    // avoid resampling
+    if (canvasCenter.cast<int32_t>() == lastPoint) {
+      continue;
+    }
+    lastPoint = canvasCenter.cast<int32_t>();
+
+    const auto heading = spineSpline.catmullRomDerivativeFirst(u).normalized();
+    const auto theta   = std::atan2(heading[1U], heading[0U]);
+
+    const vec2i topLeft = {
+      static_cast<int32_t>(canvasCenter[0U]) - _smudgeK.cols / 2,
+      static_cast<int32_t>(canvasCenter[1U]) - _smudgeK.rows / 2};
+
+    kernels::Smudge(_warpedBrushTexture, canvas.getK(), canvas.getS(),
+                    _smudgeK, _smudgeS, topLeft, smudgeMapCenter,
+                    static_cast<float>(theta),
+                    static_cast<float>(getThicknessScale()));
+  }
+}
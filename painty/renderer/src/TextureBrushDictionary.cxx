@@ -7,69 +7,267 @@
  */
 #include "painty/renderer/TextureBrushDictionary.hxx"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <map>
-#include <random>
 
-// #include "opencv2/highgui/highgui.hpp"
+#include "painty/core/ThreadPool.hxx"
 #include "painty/io/ImageIO.hxx"
 
 namespace painty {
 
-TextureBrushDictionary::TextureBrushDictionary() {
-  createBrushTexturesFromFolder("data/textures");
+namespace {
+constexpr char CacheMagic[8U]    = {'P', 'A', 'I', 'N', 'T', 'Y', 'T', 'X'};
+constexpr uint32_t ByteOrderMark = 0x01020304U;
+constexpr uint64_t DataAlignment = 64U;
+
+struct CacheHeader {
+  char magic[8U];
+  uint32_t version;
+  uint32_t byteOrderMark;
+  uint32_t count;
+  uint32_t reserved[3U];
+};
+static_assert(sizeof(CacheHeader) == 32U, "unexpected cache header size");
+
+/**
+ * @brief Index entry of a texture, the source attributes detect outdated
+ * caches.
+ *
+ */
+struct CacheRecord {
+  char name[56U];
+  uint32_t radius;
+  uint32_t length;
+  int32_t rows;
+  int32_t cols;
+  uint64_t offset;
+  uint64_t sourceSize;
+  int64_t sourceTime;
+};
+static_assert(sizeof(CacheRecord) == 96U, "unexpected cache record size");
+
+struct SourceFile {
+  std::filesystem::path path;
+  std::string name;
+  uint32_t radius = 0U;
+  uint32_t length = 0U;
+  uint64_t size   = 0U;
+  int64_t time    = 0;
+};
+
+auto AlignUp(const uint64_t value) -> uint64_t {
+  return ((value + DataAlignment - 1U) / DataAlignment) * DataAlignment;
 }
 
-auto TextureBrushDictionary::lookup(const std::vector<vec2>& path,
-                                    const double brushSize) const -> Entry {
-  auto length = 0.0;
-  for (auto i = 0U; i < (path.size() - 1U); i++) {
-    length += (path[i] - path[i + 1U]).norm();
+/**
+ * @brief The textures of a folder, sorted by name.
+ *
+ */
+auto ListSources(const std::string& folder) -> std::vector<SourceFile> {
+  std::vector<SourceFile> sources;
+  for (const auto& p : std::filesystem::directory_iterator(folder)) {
+    if (!p.is_regular_file() || (p.path().extension() != ".png")) {
+      continue;
+    }
+    SourceFile source;
+    source.path = p.path();
+    source.name = p.path().filename().string();
+
+    // <radius>_<length>_<id>
+    const auto stem  = p.path().stem().string();
+    const auto first = stem.find('_');
+    source.radius = static_cast<uint32_t>(std::stoi(stem.substr(0U, first)));
+    source.length =
+      static_cast<uint32_t>(std::stoi(stem.substr(first + 1U)));
+    source.size = static_cast<uint64_t>(p.file_size());
+    source.time =
+      static_cast<int64_t>(p.last_write_time().time_since_epoch().count());
+    sources.push_back(source);
   }
+  // the order of the directory iteration is unspecified
+  std::sort(sources.begin(), sources.end(),
+            [](const SourceFile& a, const SourceFile& b) {
+              return a.name < b.name;
+            });
+  return sources;
+}
 
-  uint32_t i0 = 0;
-  uint32_t i1 = 1;
+/**
+ * @brief Read the size from the header of a png without decoding it.
+ *
+ */
+auto ReadPngSize(const std::string& file) -> cv::Size {
+  std::ifstream in(file, std::ios::binary);
+  std::array<uint8_t, 24U> head = {};
+  if (!in.read(reinterpret_cast<char*>(head.data()),
+               static_cast<std::streamsize>(head.size())) ||
+      (std::memcmp(head.data() + 12U, "IHDR", 4U) != 0)) {
+    throw std::runtime_error("not a png: " + file);
+  }
+  const auto bigEndian = [&head](const std::size_t i) {
+    return (static_cast<uint32_t>(head[i]) << 24U) |
+           (static_cast<uint32_t>(head[i + 1U]) << 16U) |
+           (static_cast<uint32_t>(head[i + 2U]) << 8U) |
+           static_cast<uint32_t>(head[i + 3U]);
+  };
+  return {static_cast<int32_t>(bigEndian(16U)),
+          static_cast<int32_t>(bigEndian(20U))};
+}
 
-  // find best fitting size
-  double mr = _avgSizes[0U];
-  for (uint32_t i = 0U; i < _avgSizes.size(); i++) {
-    double d = std::abs(_avgSizes[i] - brushSize);
-    if (d < mr) {
-      mr = d;
-      i0 = i;
-    }
+/**
+ * @brief Map the cache file of the textures.
+ *
+ * @return std::shared_ptr<const uint8_t> nullptr if the cache is missing or
+ * does not match the textures.
+ */
+auto MapCache(const std::string& cacheFile,
+              const std::vector<SourceFile>& sources)
+  -> std::shared_ptr<const uint8_t> {
+  const auto fd = ::open(cacheFile.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat fileStat = {};
+  if ((::fstat(fd, &fileStat) != 0) ||
+      (static_cast<std::size_t>(fileStat.st_size) < sizeof(CacheHeader))) {
+    ::close(fd);
+    return nullptr;
   }
+  const auto length = static_cast<std::size_t>(fileStat.st_size);
+  auto* mapped      = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    return nullptr;
+  }
+  auto cache = std::shared_ptr<const uint8_t>(
+    static_cast<const uint8_t*>(mapped), [length](const uint8_t* data) {
+      ::munmap(const_cast<uint8_t*>(data), length);
+    });
 
-  // find best fitting length
-  double ml = _avgTexLength[i0][0];
-  for (uint32_t i = 0U; i < _avgSizes.size(); i++) {
-    double d = abs(_avgTexLength[i0][i] - length);
-    if (d < ml) {
-      ml = d;
-      i1 = i;
+  CacheHeader header = {};
+  std::memcpy(&header, cache.get(), sizeof(CacheHeader));
+  if ((std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0) ||
+      (header.byteOrderMark != ByteOrderMark) ||
+      (header.version != TextureBrushDictionary::CacheVersion) ||
+      (header.count != sources.size()) ||
+      ((sizeof(CacheHeader) + header.count * sizeof(CacheRecord)) > length)) {
+    return nullptr;
+  }
+  for (auto i = 0U; i < header.count; i++) {
+    CacheRecord record = {};
+    std::memcpy(&record,
+                cache.get() + sizeof(CacheHeader) + i * sizeof(CacheRecord),
+                sizeof(CacheRecord));
+    const auto& source = sources[i];
+    const auto bytes   = static_cast<uint64_t>(record.rows) *
+                       static_cast<uint64_t>(record.cols) * sizeof(float);
+    if ((std::string(record.name, strnlen(record.name, sizeof(record.name))) !=
+         source.name) ||
+        (record.sourceSize != source.size) ||
+        (record.sourceTime != source.time) || (record.rows < 0) ||
+        (record.cols < 0) || ((record.offset % DataAlignment) != 0U) ||
+        (record.offset > length) || (bytes > (length - record.offset))) {
+      return nullptr;
     }
   }
+  return cache;
+}
+
+/**
+ * @brief Index of the element with the key closest to the value.
+ *
+ * @param sorted ascending by key, not empty.
+ */
+template <class T, class Key>
+auto Nearest(const std::vector<T>& sorted, const double value, Key key)
+  -> std::size_t {
+  const auto it = std::lower_bound(
+    sorted.begin(), sorted.end(), value,
+    [&key](const T& element, const double v) { return key(element) < v; });
+  const auto i = static_cast<std::size_t>(std::distance(sorted.begin(), it));
+  if (i == sorted.size()) {
+    return i - 1UL;
+  }
+  if ((i > 0UL) &&
+      ((value - key(sorted[i - 1UL])) <= (key(sorted[i]) - value))) {
+    return i - 1UL;
+  }
+  return i;
+}
+}  // namespace
 
-  const auto& candidates = _brushTexturesBySizeByLength[i0][i1];
+TextureBrushDictionary::TextureBrushDictionary(const bool createGpuTextures,
+                                               const std::string& folder)
+    : _createGpuTextures(createGpuTextures),
+      _generator(std::random_device()()) {
+  createIndex(folder);
+}
 
-  if (candidates.empty()) {
+auto TextureBrushDictionary::lookup(const std::vector<vec2>& path,
+                                    const double brushSize) const -> Entry {
+  auto length = 0.0;
+  for (auto i = 1UL; i < path.size(); i++) {
+    length += (path[i - 1UL] - path[i]).norm();
+  }
+
+  if (_sizeBins.empty()) {
     throw std::runtime_error("no candidate found");
   }
 
-  static std::random_device rd;
-  static std::mt19937 gen(rd());
+  // find best fitting size and length
+  const auto& sizeBin = _sizeBins[Nearest(
+    _sizeBins, brushSize, [](const SizeBin& b) { return b.avgSize; })];
+  const auto& candidates =
+    sizeBin
+      .lengths[Nearest(sizeBin.lengths, length,
+                       [](const LengthBin& b) { return b.avgLength; })]
+      .textures;
+
   std::uniform_int_distribution<std::size_t> dis(
     static_cast<std::size_t>(0UL),
     candidates.size() - static_cast<std::size_t>(1UL));
-  const auto index = dis(gen);
+  std::size_t index = 0UL;
+  {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    index = dis(_generator);
+  }
+
+  // converted outside of the lock, only lookups of the same texture wait
+  auto& texture = _textures[candidates[index]];
+  std::call_once(*texture.loaded, [this, &texture]() { load(texture); });
+  return texture.entry;
+}
+
+void TextureBrushDictionary::setSeed(const uint32_t seed) {
+  const std::lock_guard<std::mutex> lock(_mutex);
+  _generator.seed(seed);
+}
 
-  return candidates[index];
+auto TextureBrushDictionary::getTextureCount() const -> std::size_t {
+  return _textures.size();
 }
 
-auto TextureBrushDictionary::loadHeightMap(const std::string& file) const
-  -> Mat1d {
+auto TextureBrushDictionary::GetCacheFile(const std::string& folder)
+  -> std::string {
+  auto path = folder;
+  while ((path.size() > 1UL) && (path.back() == '/')) {
+    path.pop_back();
+  }
+  return path + ".cache";
+}
+
+auto TextureBrushDictionary::loadHeightMap(const std::string& file) -> Mat1d {
   Mat1d gray;
   io::imRead(file, gray, false);
 
@@ -78,104 +276,184 @@ auto TextureBrushDictionary::loadHeightMap(const std::string& file) const
   return gray;
 }
 
-void TextureBrushDictionary::createBrushTexturesFromFolder(
-  const std::string& folder) {
-  auto split = [](const std::string& input, const char delim) {
-    std::vector<std::string> elems;
-    std::stringstream ss(input);
-    std::string item;
-    while (std::getline(ss, item, delim)) {
-      elems.push_back(item);
-    }
-    return elems;
-  };
+void TextureBrushDictionary::BuildCache(const std::string& folder,
+                                        const std::string& cacheFile) {
+  const auto sources = ListSources(folder);
 
-  std::map<uint32_t, std::map<uint32_t, std::vector<Entry>>> textureMap;
+  for (const auto& source : sources) {
+    if (source.name.size() >= sizeof(CacheRecord::name)) {
+      throw std::invalid_argument("brush texture name too long: " +
+                                  source.name);
+    }
+  }
 
-  for (const auto& p : std::filesystem::directory_iterator(folder)) {
-    const auto filepath = p.path();
-    // std::cout << filepath << std::endl;
+  // written next to the cache and moved, readers never see a partial file
+  const auto tmpFile = cacheFile + ".tmp";
+  {
+    std::ofstream out(tmpFile, std::ios::binary);
+    if (!out.is_open()) {
+      throw std::ios_base::failure(tmpFile);
+    }
 
-    const std::string filename =
-      split(split(filepath, '.').front(), '/').back();
+    auto& pool = DefaultThreadPool();
+    std::vector<std::future<Mat1f>> futures;
+    for (const auto& source : sources) {
+      futures.push_back(pool.add_back([&source]() {
+        Mat1f texture;
+        loadHeightMap(source.path.string()).convertTo(texture, CV_32FC1);
+        return texture;
+      }));
+    }
 
-    std::vector<std::string> tokens = split(filename, '_');
-    const auto radius = static_cast<uint32_t>(std::stoi(tokens[0]));
-    const auto length = static_cast<uint32_t>(std::stoi(tokens[1]));
+    std::vector<CacheRecord> records(sources.size());
+    auto offset = AlignUp(sizeof(CacheHeader) +
+                          records.size() * sizeof(CacheRecord));
+    try {
+      for (auto i = 0UL; i < sources.size(); i++) {
+        const auto texture = futures[i].get();
+        const auto bytes   = texture.total() * texture.elemSize();
 
-    Entry entry;
-    entry.texHost = loadHeightMap(filepath);
+        auto& record = records[i];
+        std::memcpy(record.name, sources[i].name.data(),
+                    sources[i].name.size());
+        record.radius     = sources[i].radius;
+        record.length     = sources[i].length;
+        record.rows       = texture.rows;
+        record.cols       = texture.cols;
+        record.offset     = offset;
+        record.sourceSize = sources[i].size;
+        record.sourceTime = sources[i].time;
 
-    Mat1f fImage = {};
-    {
-      Mat1f copy = {};
-      cv::normalize(entry.texHost, copy, 0.0, 1.0, cv::NORM_MINMAX);
-      cv::flip(copy, copy, 0);
-      copy.convertTo(fImage, CV_32FC1, 1.0);
+        out.seekp(static_cast<std::streamoff>(offset));
+        out.write(reinterpret_cast<const char*>(texture.data),
+                  static_cast<std::streamsize>(bytes));
+        offset = AlignUp(offset + bytes);
+      }
+    } catch (...) {
+      // the pool is shared, the remaining jobs still read the sources
+      for (auto& future : futures) {
+        if (future.valid()) {
+          future.wait();
+        }
+      }
+      throw;
     }
 
-    // cv::imshow("brush_tex", byteImage);
-    // cv::waitKey(100);
+    CacheHeader header = {};
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version       = CacheVersion;
+    header.byteOrderMark = ByteOrderMark;
+    header.count         = static_cast<uint32_t>(records.size());
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+    out.write(reinterpret_cast<const char*>(records.data()),
+              static_cast<std::streamsize>(records.size() *
+                                           sizeof(CacheRecord)));
+    if (!out) {
+      throw std::ios_base::failure(tmpFile);
+    }
+  }
+  std::filesystem::rename(tmpFile, cacheFile);
+}
 
-    entry.texGpu = prgl::Texture2d::Create(
-      fImage.cols, fImage.rows, prgl::TextureFormatInternal::R32F,
-      prgl::TextureFormat::Red, prgl::DataType::Float);
-    entry.texGpu->upload(fImage.data);
+void TextureBrushDictionary::createIndex(const std::string& folder) {
+  const auto sources   = ListSources(folder);
+  const auto cacheFile = GetCacheFile(folder);
 
-    textureMap[radius][length].push_back(entry);
+  _cache = MapCache(cacheFile, sources);
+  if (_cache == nullptr) {
+    try {
+      BuildCache(folder, cacheFile);
+      _cache = MapCache(cacheFile, sources);
+    } catch (const std::exception& e) {
+      std::cerr << "could not create brush texture cache " << cacheFile
+                << " - " << e.what() << std::endl;
+    }
   }
 
-  _brushTexturesBySizeByLength.clear();
-  for (const auto& e : textureMap) {
-    _brushTexturesBySizeByLength.push_back(std::vector<std::vector<Entry>>());
-    for (const auto& a : e.second) {
-      _brushTexturesBySizeByLength.back().push_back(std::vector<Entry>());
-      for (const auto& tex : a.second) {
-        _brushTexturesBySizeByLength.back().back().push_back(tex);
-      }
+  _textures.clear();
+  std::vector<std::pair<uint32_t, uint32_t>> keys;
+  for (auto i = 0UL; i < sources.size(); i++) {
+    Texture texture;
+    if (_cache != nullptr) {
+      CacheRecord record = {};
+      std::memcpy(&record,
+                  _cache.get() + sizeof(CacheHeader) + i * sizeof(CacheRecord),
+                  sizeof(CacheRecord));
+      texture.cached =
+        reinterpret_cast<const float*>(_cache.get() + record.offset);
+      texture.rows = record.rows;
+      texture.cols = record.cols;
+    } else {
+      // decoded on first use
+      const auto size = ReadPngSize(sources[i].path.string());
+      texture.source  = sources[i].path.string();
+      texture.rows    = size.height;
+      texture.cols    = size.width;
     }
+    _textures.push_back(std::move(texture));
+    keys.emplace_back(sources[i].radius, sources[i].length);
   }
 
-  _avgSizes.resize(_brushTexturesBySizeByLength.size());
-  for (auto& e : _avgSizes) {
-    e = 0.0;
+  createBins(keys);
+}
+
+void TextureBrushDictionary::createBins(
+  const std::vector<std::pair<uint32_t, uint32_t>>& keys) {
+  std::map<uint32_t, std::map<uint32_t, std::vector<std::size_t>>> groups;
+  for (auto i = 0UL; i < keys.size(); i++) {
+    groups[keys[i].first][keys[i].second].push_back(i);
   }
-  std::vector<uint32_t> brushSizesCounters(_brushTexturesBySizeByLength.size(),
-                                           0U);
-  for (auto i = 0U; i < _brushTexturesBySizeByLength.size(); i++) {
-    for (auto j = 0U; j < _brushTexturesBySizeByLength[i].size(); j++) {
-      for (const auto& texture : _brushTexturesBySizeByLength[i][j]) {
-        _avgSizes[i] += static_cast<double>(texture.texHost.rows);
-        brushSizesCounters[i]++;
+
+  _sizeBins.clear();
+  for (const auto& bySize : groups) {
+    SizeBin sizeBin;
+    auto sizeCount = 0UL;
+    for (const auto& byLength : bySize.second) {
+      LengthBin lengthBin;
+      lengthBin.textures = byLength.second;
+      for (const auto i : lengthBin.textures) {
+        sizeBin.avgSize += static_cast<double>(_textures[i].rows);
+        lengthBin.avgLength += static_cast<double>(_textures[i].cols);
       }
+      lengthBin.avgLength *=
+        (1.0 / static_cast<double>(lengthBin.textures.size()));
+      sizeCount += lengthBin.textures.size();
+      sizeBin.lengths.push_back(lengthBin);
     }
+    sizeBin.avgSize *= (1.0 / static_cast<double>(sizeCount));
+    std::sort(sizeBin.lengths.begin(), sizeBin.lengths.end(),
+              [](const LengthBin& a, const LengthBin& b) {
+                return a.avgLength < b.avgLength;
+              });
+    _sizeBins.push_back(sizeBin);
   }
-  for (auto i = 0U; i < _avgSizes.size(); i++) {
-    _avgSizes[i] *= (1.0 / static_cast<double>(brushSizesCounters[i]));
-  }
+  std::sort(_sizeBins.begin(), _sizeBins.end(),
+            [](const SizeBin& a, const SizeBin& b) {
+              return a.avgSize < b.avgSize;
+            });
+}
 
-  _avgTexLength.resize(_brushTexturesBySizeByLength.size());
-  std::vector<std::vector<uint32_t>> brushLengthCounters(
-    _brushTexturesBySizeByLength.size());
-  for (auto i = 0U; i < _brushTexturesBySizeByLength.size(); i++) {
-    _avgTexLength[i] =
-      std::vector<double>(_brushTexturesBySizeByLength[i].size(), 0.0);
-    brushLengthCounters[i] =
-      std::vector<uint32_t>(_brushTexturesBySizeByLength[i].size(), 0U);
-  }
-  for (auto i = 0U; i < _brushTexturesBySizeByLength.size(); i++) {
-    for (auto j = 0U; j < _brushTexturesBySizeByLength[i].size(); j++) {
-      for (const auto& texture : _brushTexturesBySizeByLength[i][j]) {
-        _avgTexLength[i][j] += static_cast<double>(texture.texHost.cols);
-        brushLengthCounters[i][j]++;
-      }
-    }
+void TextureBrushDictionary::load(Texture& texture) const {
+  Mat1f normalized;
+  if (texture.cached != nullptr) {
+    // the mapping is read only, the header is only read from
+    normalized = Mat1f(texture.rows, texture.cols,
+                       const_cast<float*>(texture.cached));
+    normalized.convertTo(texture.entry.texHost, CV_64FC1);
+  } else {
+    texture.entry.texHost = loadHeightMap(texture.source);
+    texture.entry.texHost.convertTo(normalized, CV_32FC1);
   }
-  for (auto i = 0U; i < _avgTexLength.size(); i++) {
-    for (auto j = 0U; j < _avgTexLength[i].size(); j++) {
-      _avgTexLength[i][j] *=
-        (1.0 / static_cast<double>(brushLengthCounters[i][j]));
-    }
+
+  if (_createGpuTextures) {
+    Mat1f flipped = {};
+    cv::flip(normalized, flipped, 0);
+
+    texture.entry.texGpu = prgl::Texture2d::Create(
+      flipped.cols, flipped.rows, prgl::TextureFormatInternal::R32F,
+      prgl::TextureFormat::Red, prgl::DataType::Float);
+    texture.entry.texGpu->upload(flipped.data);
   }
 }
 
@@ -249,6 +249,10 @@ void painty::TextureBrushGpu::enableSmudge(bool enable) {
   _smudge = enable;
 }
 
+void painty::TextureBrushGpu::setSeed(const uint32_t seed) {
+  _textureBrushDictionary.setSeed(seed);
+}
+
 void painty::TextureBrushGpu::smudge(const std::vector<vec2>& vertices,
                                      CanvasGpu& canvas) {
   auto length = 0.0;
@@ -8,6 +8,8 @@
  *
  */
 
+#include <future>
+
 #include "gtest/gtest.h"
 #include "painty/renderer/BrushStrokeSample.hxx"
 
@@ -19,3 +21,70 @@ TEST(BrushStrokeSample, Construct) {
 
   EXPECT_NEAR(0.2900139589503905, sample.getSampleAt({341, 101}), 0.01);
 }
+
+TEST(BrushStrokeSample, Shared) {
+  const auto sample = painty::BrushStrokeSample::Get("./data/sample_0");
+  EXPECT_EQ(sample, painty::BrushStrokeSample::Get("data/sample_0"));
+  EXPECT_EQ(sample, painty::BrushStrokeSample::Get("data/../data/sample_0"));
+
+  std::vector<std::future<std::shared_ptr<const painty::BrushStrokeSample>>>
+    futures;
+  for (auto i = 0; i < 8; i++) {
+    futures.push_back(std::async(std::launch::async, []() {
+      return painty::BrushStrokeSample::Get("data/sample_0");
+    }));
+  }
+  for (auto& f : futures) {
+    EXPECT_EQ(sample, f.get());
+  }
+
+  EXPECT_ANY_THROW(painty::BrushStrokeSample::Get("data/no_sample"));
+}
+
+TEST(BrushStrokeSample, Precomputed) {
+  const auto sample = painty::BrushStrokeSample::Get("data/sample_0");
+
+  // 800x171 down to a single row
+  ASSERT_EQ(sample->getThicknessMipCount(), 9U);
+  EXPECT_EQ(sample->getThicknessMip(0U).cols, 800);
+  EXPECT_EQ(sample->getThicknessMip(1U).cols, 400);
+  EXPECT_EQ(sample->getThicknessMip(1U).rows, 86);
+  EXPECT_EQ(sample->getThicknessMip(8U).rows, 1);
+  EXPECT_NEAR(sample->getThicknessMip(0U)(101, 341),
+              sample->getThicknessMap()(101, 341), 1e-6);
+  EXPECT_NEAR(cv::mean(sample->getThicknessMip(0U))[0],
+              cv::mean(sample->getThicknessMip(3U))[0], 0.01);
+
+  const auto xy = sample->warpUV({0.5, 0.0});
+  EXPECT_GT(xy[0U], 0.0);
+  EXPECT_LT(xy[0U], sample->getThicknessMap().cols);
+  EXPECT_GT(xy[1U], 0.0);
+  EXPECT_LT(xy[1U], sample->getThicknessMap().rows);
+  EXPECT_EQ(sample->getSampleAtUV({0.5, 0.0}), sample->getSampleAt(xy));
+}
+
+TEST(BrushStrokeSample, Lod) {
+  const auto sample = painty::BrushStrokeSample::Get("data/sample_0");
+
+  // texels map to pixels one to one, or the stroke is larger
+  EXPECT_EQ(sample->getLod(800.0, 171.0), 0.0);
+  EXPECT_EQ(sample->getLod(1600.0, 400.0), 0.0);
+  EXPECT_NEAR(sample->getLod(200.0, 171.0), 2.0, 1e-9);
+  EXPECT_NEAR(sample->getLod(800.0, 171.0 / 8.0), 3.0, 1e-9);
+
+  const painty::vec2 uv = {341.0 / 800.0, 101.0 / 171.0};
+  EXPECT_NEAR(sample->getThicknessAt(uv, 0.0),
+              sample->getThicknessMap()(101, 341), 1e-6);
+  EXPECT_NEAR(sample->getThicknessAt(uv, -1.0),
+              sample->getThicknessAt(uv, 0.0), 1e-9);
+
+  // the coarsest level is the average along the rows
+  const auto coarsest =
+    static_cast<double>(sample->getThicknessMipCount() - 1U);
+  EXPECT_NEAR(sample->getThicknessAt(uv, coarsest),
+              sample->getThicknessAt(uv, coarsest + 4.0), 1e-9);
+
+  const auto l1 = sample->getThicknessAt(uv, 1.0);
+  const auto l2 = sample->getThicknessAt(uv, 2.0);
+  EXPECT_NEAR(sample->getThicknessAt(uv, 1.25), 0.75 * l1 + 0.25 * l2, 1e-6);
+}
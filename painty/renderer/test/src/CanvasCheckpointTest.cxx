@@ -0,0 +1,192 @@
+/**
+ * @file CanvasCheckpointTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-09
+ *
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "painty/renderer/Canvas.hxx"
+#include "painty/renderer/CanvasCheckpoint.hxx"
+#include "painty/renderer/CanvasCpu.hxx"
+
+namespace {
+constexpr auto Rows = 150;
+constexpr auto Cols = 200;
+
+void FillRandom(painty::Canvas<painty::vec3>& canvas) {
+  std::mt19937 gen(42U);
+  std::uniform_real_distribution<double> dis(0.0, 1.0);
+  auto& layer = canvas.getPaintLayer();
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      // leave parts of the canvas empty to have something to compress
+      if (x < Cols / 2) {
+        layer.set(y, x, {dis(gen), dis(gen), dis(gen)},
+                  {dis(gen), dis(gen), dis(gen)}, dis(gen));
+        canvas.get_h()(y, x) = dis(gen);
+      }
+      canvas.getR0()(y, x) = {dis(gen), dis(gen), dis(gen)};
+    }
+  }
+}
+
+auto Equals(const painty::Canvas<painty::vec3>& a,
+            const painty::Canvas<painty::vec3>& b) -> bool {
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      if ((a.getR0()(y, x) != b.getR0()(y, x)) ||
+          (a.get_h()(y, x) != b.get_h()(y, x)) ||
+          (a.getPaintLayer().getK_buffer()(y, x) !=
+           b.getPaintLayer().getK_buffer()(y, x)) ||
+          (a.getPaintLayer().getS_buffer()(y, x) !=
+           b.getPaintLayer().getS_buffer()(y, x)) ||
+          (a.getPaintLayer().getV_buffer()(y, x) !=
+           b.getPaintLayer().getV_buffer()(y, x))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+}  // namespace
+
+TEST(CanvasCheckpointTest, RoundTrip) {
+  const std::string filename = "canvas_checkpoint_test.ckpt";
+
+  painty::Canvas<painty::vec3> canvas(Rows, Cols);
+  FillRandom(canvas);
+  canvas.setDryingTime(std::chrono::milliseconds(1234));
+
+  for (const auto compression : {painty::CanvasCheckpoint::Compression::None,
+                                 painty::CanvasCheckpoint::Compression::Zlib}) {
+    painty::SaveCheckpoint(filename, canvas, compression);
+
+    painty::Canvas<painty::vec3> restored(Rows, Cols);
+    painty::LoadCheckpoint(filename, restored);
+    EXPECT_TRUE(Equals(canvas, restored));
+    EXPECT_EQ(restored.getDryingTime(), std::chrono::milliseconds(1234));
+
+    // the drying state must not advance while the checkpoint is stored
+    const auto& t0 = canvas.getTimeMap().front();
+    const auto& t1 = restored.getTimeMap().front();
+    EXPECT_LE(t0, t1);
+
+    const painty::CanvasCheckpoint checkpoint(filename);
+    EXPECT_EQ(checkpoint.getVersion(), painty::CanvasCheckpoint::Version);
+    EXPECT_EQ(checkpoint.getLayout(), painty::CanvasCheckpoint::Layout::Host);
+    EXPECT_EQ(checkpoint.getSize().width, static_cast<uint32_t>(Cols));
+    EXPECT_EQ(checkpoint.getSize().height, static_cast<uint32_t>(Rows));
+    EXPECT_EQ(checkpoint.getBufferNames().size(), 6UL);
+    EXPECT_TRUE(checkpoint.hasBuffer("V"));
+    EXPECT_FALSE(checkpoint.hasBuffer("W"));
+    EXPECT_EQ(checkpoint.getCompression("K"), compression);
+    EXPECT_THROW(checkpoint.get<painty::vec3>("h"), std::invalid_argument);
+
+    // a region spanning several tiles
+    const cv::Rect roi(30, 20, 150, 100);
+    const painty::Mat<painty::vec3> K =
+      checkpoint.getBuffer("K", roi).clone();
+    for (auto y = 0; y < roi.height; y++) {
+      for (auto x = 0; x < roi.width; x++) {
+        EXPECT_EQ(K(y, x),
+                  canvas.getPaintLayer().getK_buffer()(y + roi.y, x + roi.x));
+      }
+    }
+  }
+
+  std::remove(filename.c_str());
+}
+
+TEST(CanvasCheckpointTest, ZeroCopy) {
+  const std::string filename = "canvas_checkpoint_test.ckpt";
+
+  painty::Canvas<painty::vec3> canvas(Rows, Cols);
+  FillRandom(canvas);
+  painty::SaveCheckpoint(filename, canvas);
+
+  const painty::CanvasCheckpoint checkpoint(filename);
+  auto a = checkpoint.getBuffer("R0");
+  auto b = checkpoint.getBuffer("R0");
+  EXPECT_EQ(a.data, b.data);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(a.data) % 64U, 0U);
+
+  // modifications are private to the mapping
+  a.setTo(cv::Scalar::all(0.0));
+  painty::Canvas<painty::vec3> restored(Rows, Cols);
+  painty::LoadCheckpoint(filename, restored);
+  EXPECT_TRUE(Equals(canvas, restored));
+
+  std::remove(filename.c_str());
+}
+
+TEST(CanvasCheckpointTest, CanvasCpu) {
+  const std::string filename = "canvas_checkpoint_test.ckpt";
+
+  painty::CanvasCpu canvas({Cols, Rows});
+  canvas.getK().setTo(cv::Scalar(0.1, 0.2, 0.3, 0.4));
+  canvas.getS().setTo(cv::Scalar(0.5, 0.6, 0.7, 0.4));
+  painty::SaveCheckpoint(filename, canvas,
+                         painty::CanvasCheckpoint::Compression::Zlib);
+
+  painty::CanvasCpu restored({Cols, Rows});
+  painty::LoadCheckpoint(filename, restored);
+  EXPECT_EQ(cv::norm(canvas.getK(), restored.getK(), cv::NORM_INF), 0.0);
+  EXPECT_EQ(cv::norm(canvas.getS(), restored.getS(), cv::NORM_INF), 0.0);
+  EXPECT_EQ(
+    cv::norm(canvas.getSubstrate(), restored.getSubstrate(), cv::NORM_INF),
+    0.0);
+
+  // layouts are not interchangeable
+  painty::Canvas<painty::vec3> host(Rows, Cols);
+  EXPECT_THROW(painty::LoadCheckpoint(filename, host), std::runtime_error);
+
+  std::remove(filename.c_str());
+}
+
+TEST(CanvasCheckpointTest, Invalid) {
+  const std::string filename = "canvas_checkpoint_test.ckpt";
+  {
+    std::ofstream out(filename, std::ios::binary);
+    const std::vector<char> garbage(256U, 'x');
+    out.write(garbage.data(), static_cast<std::streamsize>(garbage.size()));
+  }
+  EXPECT_THROW(painty::CanvasCheckpoint checkpoint(filename),
+               std::runtime_error);
+  std::remove(filename.c_str());
+
+  // a buffer offset whose range wraps around the 64 bit address space
+  painty::Canvas<painty::vec3> canvas(Rows, Cols);
+  painty::SaveCheckpoint(filename, canvas,
+                         painty::CanvasCheckpoint::Compression::None);
+  {
+    std::fstream file(filename,
+                      std::ios::in | std::ios::out | std::ios::binary);
+    // offset field of the first buffer header
+    file.seekp(64 + 24);
+    const uint64_t offset = UINT64_MAX - 4095U;
+    file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+  }
+  EXPECT_THROW(painty::CanvasCheckpoint checkpoint(filename),
+               std::runtime_error);
+  std::remove(filename.c_str());
+
+  EXPECT_THROW(painty::CanvasCheckpoint checkpoint("does_not_exist.ckpt"),
+               std::ios_base::failure);
+
+  painty::CanvasCheckpointWriter writer({Cols, Rows},
+                                        painty::CanvasCheckpoint::Layout::Host);
+  EXPECT_THROW(writer.addBuffer("h", painty::Mat1d(Rows + 1, Cols)),
+               std::invalid_argument);
+  EXPECT_THROW(
+    writer.addBuffer("a_name_that_is_too_long", painty::Mat1d(Rows, Cols)),
+    std::invalid_argument);
+}
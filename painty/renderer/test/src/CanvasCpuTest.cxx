@@ -0,0 +1,194 @@
+/**
+ * @file CanvasCpuTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-02
+ *
+ */
+
+#include <random>
+
+#include "gtest/gtest.h"
+#include "painty/renderer/Canvas.hxx"
+#include "painty/renderer/CanvasCpu.hxx"
+#include "painty/renderer/CanvasKernelsCpu.hxx"
+#include "painty/renderer/SbrRenderThread.hxx"
+#include "painty/renderer/TextureBrushCpu.hxx"
+
+namespace {
+constexpr auto Rows = 150;
+constexpr auto Cols = 200;
+
+/**
+ * @brief Fill the wet layer of both canvases with the same random paint on a
+ * white substrate.
+ */
+void FillRandom(painty::Canvas<painty::vec3>& canvas,
+                painty::CanvasCpu& canvasCpu) {
+  std::mt19937 gen(42U);
+  std::uniform_real_distribution<double> dis(0.05, 1.0);
+
+  canvasCpu.setSubstrate(canvas.getR0());
+
+  auto& layer = canvas.getPaintLayer();
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      const painty::vec3 K = {dis(gen), dis(gen), dis(gen)};
+      const painty::vec3 S = {dis(gen), dis(gen), dis(gen)};
+      const auto v         = (x < (Cols / 2)) ? dis(gen) : 0.0;
+
+      layer.set(y, x, K, S, v);
+      canvasCpu.getK()(y, x) = {static_cast<float>(K[0U]),
+                                static_cast<float>(K[1U]),
+                                static_cast<float>(K[2U]),
+                                static_cast<float>(v)};
+      canvasCpu.getS()(y, x) = {static_cast<float>(S[0U]),
+                                static_cast<float>(S[1U]),
+                                static_cast<float>(S[2U]),
+                                static_cast<float>(v)};
+    }
+  }
+}
+}  // namespace
+
+TEST(CanvasCpuTest, ComposeParity) {
+  auto canvas = painty::Canvas<painty::vec3>(Rows, Cols);
+  auto canvasCpu =
+    painty::CanvasCpu(painty::Size{static_cast<uint32_t>(Cols),
+                                   static_cast<uint32_t>(Rows)});
+  FillRandom(canvas, canvasCpu);
+
+  auto expected = canvas.getR0().clone();
+  canvas.getPaintLayer().composeOnto(expected);
+
+  const auto composed = canvasCpu.getCompositionLinearRgb();
+  ASSERT_EQ(expected.size(), composed.size());
+  for (auto i = 0; i < static_cast<int32_t>(expected.total()); i++) {
+    for (auto c = 0; c < 3; c++) {
+      EXPECT_NEAR(expected(i)[c], composed(i)[c], 0.0001);
+    }
+  }
+}
+
+TEST(CanvasCpuTest, DryParity) {
+  auto canvas = painty::Canvas<painty::vec3>(Rows, Cols);
+  auto canvasCpu =
+    painty::CanvasCpu(painty::Size{static_cast<uint32_t>(Cols),
+                                   static_cast<uint32_t>(Rows)});
+  FillRandom(canvas, canvasCpu);
+
+  canvas.dryCanvas();
+  canvasCpu.dryStep(1.0F);
+
+  const auto composed = canvasCpu.getCompositionLinearRgb();
+  for (auto i = 0; i < static_cast<int32_t>(composed.total()); i++) {
+    EXPECT_NEAR(canvasCpu.getK()(i)[3U], 0.0F, 0.000001F);
+    for (auto c = 0; c < 3; c++) {
+      EXPECT_NEAR(canvas.getR0()(i)[c], composed(i)[c], 0.0001);
+    }
+  }
+}
+
+TEST(CanvasCpuTest, BrushTextureWarp) {
+  const auto brushTexture = painty::Mat1d(20, 80, 1.0);
+  auto footprint          = painty::Mat1f(Rows, Cols, 0.0F);
+
+  constexpr auto Radius          = 10.0;
+  std::vector<painty::vec2> path = {{20.0, 75.0}, {100.0, 75.0}, {180.0, 75.0}};
+  const auto aoi = painty::kernels::BrushTextureWarp(brushTexture, path, Radius,
+                                                     footprint);
+
+  EXPECT_FALSE(aoi.empty());
+  EXPECT_NEAR(footprint(75, 100), 1.0F, 0.0001F);
+  EXPECT_NEAR(footprint(70, 50), 1.0F, 0.0001F);
+  EXPECT_NEAR(footprint(75, 10), 0.0F, 0.0001F);
+  EXPECT_NEAR(footprint(60, 100), 0.0F, 0.0001F);
+
+  // covered area is the rectangle spanned by the spine and the radius
+  EXPECT_NEAR(cv::sum(footprint)[0U], 160.0 * 2.0 * Radius,
+              2.0 * (160.0 + 2.0 * Radius));
+
+  painty::kernels::ClearTextureFootprint(footprint, aoi);
+  EXPECT_NEAR(cv::sum(footprint)[0U], 0.0, 0.0001);
+}
+
+TEST(CanvasCpuTest, PaintFootprintParity) {
+  auto canvas = painty::Canvas<painty::vec3>(Rows, Cols);
+  auto canvasCpu =
+    painty::CanvasCpu(painty::Size{static_cast<uint32_t>(Cols),
+                                   static_cast<uint32_t>(Rows)});
+  FillRandom(canvas, canvasCpu);
+
+  const painty::vec3 K_brush = {0.2, 0.3, 0.4};
+  const painty::vec3 S_brush = {0.1, 0.23, 0.14};
+
+  auto footprint                 = painty::Mat1f(Rows, Cols, 0.0F);
+  std::vector<painty::vec2> path = {{20.0, 75.0}, {180.0, 75.0}};
+  const auto aoi                 = painty::kernels::BrushTextureWarp(
+    painty::Mat1d(20, 80, 0.5), path, 10.0, footprint);
+  painty::kernels::PaintTextureFootprintOnCanvas(
+    footprint, aoi, canvasCpu.getK(), canvasCpu.getS(), K_brush.cast<float>(),
+    S_brush.cast<float>(), 1.0F);
+
+  auto& layer = canvas.getPaintLayer();
+  for (auto y = 0; y < Rows; y++) {
+    for (auto x = 0; x < Cols; x++) {
+      const auto vCan = layer.getV_buffer()(y, x);
+      const auto vTex = static_cast<double>(footprint(y, x));
+      const auto vSum = vCan + vTex;
+      if (vSum > 0.0) {
+        const painty::vec3 K =
+          (vCan * layer.getK_buffer()(y, x) + vTex * K_brush) / vSum;
+        const painty::vec3 S =
+          (vCan * layer.getS_buffer()(y, x) + vTex * S_brush) / vSum;
+        layer.set(y, x, K, S, vSum);
+      }
+    }
+  }
+
+  auto expected = canvas.getR0().clone();
+  layer.composeOnto(expected);
+
+  const auto composed = canvasCpu.getCompositionLinearRgb();
+  for (auto i = 0; i < static_cast<int32_t>(expected.total()); i++) {
+    for (auto c = 0; c < 3; c++) {
+      EXPECT_NEAR(expected(i)[c], composed(i)[c], 0.0001);
+    }
+  }
+}
+
+TEST(CanvasCpuTest, TextureBrush) {
+  auto canvasCpu = painty::CanvasCpu(painty::Size{1024U, 768U});
+
+  auto brush = painty::TextureBrushCpu();
+  brush.dip({{{0.2, 0.3, 0.4}, {0.1, 0.23, 0.14}}});
+  brush.setRadius(40.0);
+  brush.enableSmudge(true);
+
+  std::vector<painty::vec2> path = {{50.0, 250.0}, {400.0, 250.0},
+                                    {650.0, 250.0}};
+  brush.paintStroke(path, canvasCpu);
+
+  EXPECT_GT(cv::sum(canvasCpu.getK())[3U], 0.0);
+  EXPECT_NEAR(canvasCpu.getK()(600, 500)[3U], 0.0F, 0.000001F);
+}
+
+TEST(CanvasCpuTest, SbrRenderThread) {
+  painty::SbrRenderThread renderThread(painty::Size{640U, 480U});
+  EXPECT_EQ(painty::RenderBackend::Type::Cpu, renderThread.getBackendType());
+
+  renderThread.setBrushThicknessScale(1.0);
+
+  std::vector<painty::vec2> path = {{50.0, 240.0}, {600.0, 240.0}};
+  renderThread
+    .render(path, 20.0,
+            {painty::vec3{0.2, 0.3, 0.4}, painty::vec3{0.1, 0.23, 0.14}})
+    .wait();
+  renderThread.dryCanvas().wait();
+
+  const auto image = renderThread.getLinearRgbImage().get();
+  EXPECT_EQ(640, image.cols);
+  EXPECT_EQ(480, image.rows);
+}
@@ -0,0 +1,203 @@
+/**
+ * @file CanvasHistoryTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-05
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "painty/renderer/CanvasHistory.hxx"
+
+namespace {
+/**
+ * @brief Modify all cells of the canvas within a rectangle.
+ */
+void Paint(painty::Canvas<painty::vec3>& canvas, const cv::Rect& rect,
+           const double v) {
+  for (auto y = rect.y; y < (rect.y + rect.height); y++) {
+    for (auto x = rect.x; x < (rect.x + rect.width); x++) {
+      canvas.getPaintLayer().set(y, x, {v, v, v}, {v, v, v}, v);
+      canvas.getR0()(y, x) = {v, v, v};
+      canvas.get_h()(y, x) = v;
+    }
+  }
+}
+
+auto Equals(const painty::Canvas<painty::vec3>& a,
+            const painty::Canvas<painty::vec3>& b) -> bool {
+  const auto& la = a.getPaintLayer();
+  const auto& lb = b.getPaintLayer();
+  for (auto i = 0; i < static_cast<int32_t>(a.getR0().total()); i++) {
+    if ((la.getK_buffer()(i) != lb.getK_buffer()(i)) ||
+        (la.getS_buffer()(i) != lb.getS_buffer()(i)) ||
+        (la.getV_buffer()(i) != lb.getV_buffer()(i)) ||
+        (a.getR0()(i) != b.getR0()(i)) || (a.get_h()(i) != b.get_h()(i)) ||
+        (a.getTimeMap()[static_cast<size_t>(i)] !=
+         b.getTimeMap()[static_cast<size_t>(i)])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto Copy(const painty::Canvas<painty::vec3>& canvas)
+  -> painty::Canvas<painty::vec3> {
+  auto copy = painty::Canvas<painty::vec3>(canvas.getPaintLayer().getRows(),
+                                           canvas.getPaintLayer().getCols());
+  canvas.getPaintLayer().copyTo(copy.getPaintLayer());
+  canvas.getR0().copyTo(copy.getR0());
+  canvas.get_h().copyTo(copy.get_h());
+  copy.getTimeMap() = canvas.getTimeMap();
+  return copy;
+}
+}  // namespace
+
+TEST(CanvasHistoryTest, UndoRedo) {
+  auto canvas  = painty::Canvas<painty::vec3>(150, 200);
+  auto history = painty::CanvasHistory<painty::vec3>(
+    canvas, painty::CanvasHistory<painty::vec3>::DefaultMemoryBudget, 32);
+
+  EXPECT_FALSE(history.canUndo());
+  EXPECT_FALSE(history.canRedo());
+
+  const auto state0 = Copy(canvas);
+
+  const auto rect0 = cv::Rect(10, 20, 50, 40);
+  history.markDirty(rect0);
+  Paint(canvas, rect0, 0.5);
+  history.commit();
+  const auto state1 = Copy(canvas);
+
+  // overlapping the first stroke and reaching out of the canvas
+  const auto rect1 = cv::Rect(40, 30, 200, 30);
+  history.markDirty(rect1);
+  Paint(canvas, rect1 & cv::Rect(0, 0, 200, 150), 0.25);
+  history.commit();
+  const auto state2 = Copy(canvas);
+
+  EXPECT_EQ(2UL, history.size());
+  EXPECT_TRUE(history.canUndo());
+
+  EXPECT_TRUE(history.undo());
+  EXPECT_TRUE(Equals(canvas, state1));
+
+  // the tiles covered by the second stroke, 6 x 2 of 32 pixels
+  auto restored = cv::Rect();
+  for (const auto& region : history.getRestoredRegions()) {
+    restored |= region;
+  }
+  EXPECT_EQ(12UL, history.getRestoredRegions().size());
+  EXPECT_EQ(cv::Rect(32, 0, 168, 64), restored);
+
+  EXPECT_TRUE(history.undo());
+  EXPECT_TRUE(Equals(canvas, state0));
+  EXPECT_FALSE(history.undo());
+
+  EXPECT_TRUE(history.redo());
+  EXPECT_TRUE(Equals(canvas, state1));
+  EXPECT_TRUE(history.redo());
+  EXPECT_TRUE(Equals(canvas, state2));
+  EXPECT_FALSE(history.redo());
+
+  // a new step discards the redo steps
+  EXPECT_TRUE(history.undo());
+  history.markDirty(std::vector<painty::vec2>{{100.0, 100.0}}, 5.0);
+  Paint(canvas, cv::Rect(95, 95, 11, 11), 0.75);
+  history.commit();
+  EXPECT_EQ(2UL, history.size());
+  EXPECT_FALSE(history.canRedo());
+
+  EXPECT_TRUE(history.undo());
+  EXPECT_TRUE(Equals(canvas, state1));
+}
+
+TEST(CanvasHistoryTest, SharedSnapshots) {
+  auto canvas  = painty::Canvas<painty::vec3>(64, 64);
+  auto history = painty::CanvasHistory<painty::vec3>(
+    canvas, painty::CanvasHistory<painty::vec3>::DefaultMemoryBudget, 64);
+
+  const auto rect = cv::Rect(0, 0, 64, 64);
+  history.markDirty(rect);
+  Paint(canvas, rect, 0.5);
+  history.commit();
+  const auto oneStep = history.getMemoryUsage();
+  EXPECT_GT(oneStep, 0UL);
+
+  // the state before the second step is the one after the first
+  history.markDirty(rect);
+  Paint(canvas, rect, 0.25);
+  history.commit();
+  EXPECT_EQ(history.getMemoryUsage(), (oneStep * 3UL) / 2UL);
+
+  history.clear();
+  EXPECT_EQ(0UL, history.getMemoryUsage());
+}
+
+TEST(CanvasHistoryTest, MemoryBudget) {
+  auto canvas  = painty::Canvas<painty::vec3>(64, 64);
+  auto history = painty::CanvasHistory<painty::vec3>(
+    canvas, painty::CanvasHistory<painty::vec3>::DefaultMemoryBudget, 64);
+
+  const auto rect = cv::Rect(0, 0, 64, 64);
+  history.markDirty(rect);
+  Paint(canvas, rect, 0.5);
+  history.commit();
+  const auto tileBytes = history.getMemoryUsage() / 2UL;
+
+  history.setMemoryBudget(tileBytes * 5UL);
+  for (auto i = 0; i < 10; i++) {
+    history.markDirty(rect);
+    Paint(canvas, rect, 0.1 * static_cast<double>(i));
+    history.commit();
+    EXPECT_LE(history.getMemoryUsage(), history.getMemoryBudget());
+  }
+  EXPECT_EQ(4UL, history.size());
+
+  auto undos = 0U;
+  while (history.undo()) {
+    undos++;
+  }
+  EXPECT_EQ(4U, undos);
+}
+
+TEST(CanvasHistoryTest, StepExceedingBudget) {
+  auto canvas  = painty::Canvas<painty::vec3>(128, 128);
+  auto history = painty::CanvasHistory<painty::vec3>(
+    canvas, painty::CanvasHistory<painty::vec3>::DefaultMemoryBudget, 64);
+
+  const auto tile = cv::Rect(0, 0, 64, 64);
+  history.markDirty(tile);
+  Paint(canvas, tile, 0.5);
+  EXPECT_TRUE(history.commit());
+  const auto tileBytes = history.getMemoryUsage() / 2UL;
+
+  // holds one tile step, but not one of all four tiles
+  history.setMemoryBudget(tileBytes * 5UL);
+  EXPECT_EQ(1UL, history.size());
+
+  const auto all = cv::Rect(0, 0, 128, 128);
+  history.markDirty(tile);
+  history.markDirty(all);
+  EXPECT_LE(history.getMemoryUsage(), history.getMemoryBudget());
+  EXPECT_FALSE(history.canUndo());
+  Paint(canvas, all, 0.25);
+  EXPECT_FALSE(history.commit());
+
+  // nothing can be undone across the unrecorded step
+  EXPECT_EQ(0UL, history.size());
+  EXPECT_EQ(0UL, history.getMemoryUsage());
+  EXPECT_FALSE(history.undo());
+
+  // recording continues with the next step that fits
+  const auto state = Copy(canvas);
+  history.markDirty(tile);
+  Paint(canvas, tile, 0.75);
+  EXPECT_TRUE(history.commit());
+  EXPECT_EQ(1UL, history.size());
+  EXPECT_LE(history.getMemoryUsage(), history.getMemoryBudget());
+  EXPECT_TRUE(history.undo());
+  EXPECT_TRUE(Equals(canvas, state));
+}
@@ -0,0 +1,97 @@
+/**
+ * @file CanvasPyramidTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-11
+ *
+ */
+
+#include "gtest/gtest.h"
+#include "painty/renderer/CanvasPyramid.hxx"
+#include "painty/renderer/Renderer.hxx"
+
+namespace {
+constexpr auto Rows = 150;
+constexpr auto Cols = 203;
+
+void Paint(painty::Canvas<painty::vec3>& canvas, const cv::Rect& rect) {
+  for (auto y = rect.y; y < (rect.y + rect.height); y++) {
+    for (auto x = rect.x; x < (rect.x + rect.width); x++) {
+      canvas.getPaintLayer().set(y, x, {0.5, 1.0, 2.0}, {0.3, 0.2, 0.1}, 0.5);
+    }
+  }
+}
+
+auto MaxDifference(const painty::Mat<painty::vec3>& a,
+                   const painty::Mat<painty::vec3>& b) -> double {
+  auto d = 0.0;
+  for (auto i = 0; i < static_cast<int32_t>(a.total()); i++) {
+    d = std::max(d, (a(i) - b(i)).cwiseAbs().maxCoeff());
+  }
+  return d;
+}
+}  // namespace
+
+TEST(CanvasPyramidTest, Levels) {
+  painty::Canvas<painty::vec3> canvas(Rows, Cols);
+  painty::CanvasPyramid<painty::vec3> pyramid(canvas, 32);
+
+  // 203x150 -> 102x75 -> 51x38 -> 26x19
+  EXPECT_EQ(pyramid.getLevelCount(), 4);
+  EXPECT_EQ(pyramid.getLevel(1).cols, 102);
+  EXPECT_EQ(pyramid.getLevel(1).rows, 75);
+  EXPECT_EQ(pyramid.getLevel(3).cols, 26);
+  EXPECT_EQ(pyramid.getLevel(3).rows, 19);
+
+  EXPECT_EQ(pyramid.getLevelForScale(2.0), 0);
+  EXPECT_EQ(pyramid.getLevelForScale(0.6), 0);
+  EXPECT_EQ(pyramid.getLevelForScale(0.5), 1);
+  EXPECT_EQ(pyramid.getLevelForScale(0.3), 1);
+  EXPECT_EQ(pyramid.getLevelForScale(0.01), 3);
+
+  EXPECT_THROW(painty::CanvasPyramid<painty::vec3>(canvas, 0),
+               std::invalid_argument);
+}
+
+TEST(CanvasPyramidTest, IncrementalUpdate) {
+  painty::Canvas<painty::vec3> canvas(Rows, Cols);
+  painty::CanvasPyramid<painty::vec3> pyramid(canvas, 32);
+  pyramid.update();
+  EXPECT_EQ(pyramid.takeUpdatedRegion(0), cv::Rect(0, 0, Cols, Rows));
+  EXPECT_EQ(pyramid.takeUpdatedRegion(0), cv::Rect());
+  for (auto l = 1; l < pyramid.getLevelCount(); l++) {
+    pyramid.takeUpdatedRegion(l);
+  }
+
+  const cv::Rect region(70, 40, 20, 10);
+  Paint(canvas, region);
+  pyramid.markDirty(region);
+  pyramid.update();
+
+  painty::Renderer<painty::vec3> renderer;
+  EXPECT_LT(MaxDifference(pyramid.getLevel(0), renderer.compose(canvas)),
+            1e-12);
+
+  // only the tiles covering the region got recomputed
+  EXPECT_EQ(pyramid.takeUpdatedRegion(0), cv::Rect(64, 32, 32, 32));
+  EXPECT_EQ(pyramid.takeUpdatedRegion(1), cv::Rect(32, 0, 32, 32));
+
+  // every level is the box filtered previous one
+  for (auto l = 1; l < pyramid.getLevelCount(); l++) {
+    const auto& finer   = pyramid.getLevel(l - 1);
+    const auto& coarser = pyramid.getLevel(l);
+    for (auto y = 0; y < coarser.rows; y++) {
+      for (auto x = 0; x < coarser.cols; x++) {
+        const auto y1 = std::min(2 * y + 1, finer.rows - 1);
+        const auto x1 = std::min(2 * x + 1, finer.cols - 1);
+        const painty::vec3 expected =
+          (finer(2 * y, 2 * x) + finer(2 * y, x1) + finer(y1, 2 * x) +
+           finer(y1, x1)) *
+          0.25;
+        EXPECT_LT((coarser(y, x) - expected).cwiseAbs().maxCoeff(), 1e-12);
+      }
+    }
+  }
+}
@@ -0,0 +1,133 @@
+/**
+ * @file StrokeLogTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-12
+ *
+ */
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "painty/renderer/SbrRenderThread.hxx"
+#include "painty/renderer/StrokeLog.hxx"
+
+namespace {
+const std::array<painty::vec3, 2UL> PaintA = {painty::vec3{0.2, 0.3, 0.4},
+                                              painty::vec3{0.1, 0.23, 0.14}};
+const std::array<painty::vec3, 2UL> PaintB = {painty::vec3{0.9, 0.1, 0.5},
+                                              painty::vec3{0.3, 0.3, 0.3}};
+}  // namespace
+
+TEST(StrokeLogTest, RoundTrip) {
+  std::stringstream stream;
+  const std::vector<painty::vec2> path = {
+    {10.3, 20.7}, {11.123456, 25.5}, {9.0, 120.01}, {-3.25, 119.0}};
+  {
+    painty::StrokeLogWriter writer(stream, {640U, 480U});
+    writer.setSeed(1234U);
+    writer.setThicknessScale(2.5);
+    writer.enableSmudge(true);
+    writer.addStroke(path, 12.5, PaintA);
+    writer.addStroke(path, 8.0, PaintB);
+    writer.dry(0.01F);
+    writer.addStroke(path, 4.0, PaintA);
+    EXPECT_EQ(writer.getStrokeCount(), 3UL);
+  }
+
+  painty::StrokeLogReader reader(stream);
+  EXPECT_EQ(reader.getCanvasSize().width, 640U);
+  EXPECT_EQ(reader.getCanvasSize().height, 480U);
+
+  painty::StrokeLogRecord record;
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.type, painty::StrokeLogRecord::Type::Seed);
+  EXPECT_EQ(record.value, 1234.0);
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.type, painty::StrokeLogRecord::Type::ThicknessScale);
+  EXPECT_EQ(record.value, 2.5);
+  ASSERT_TRUE(reader.next(record));
+  EXPECT_EQ(record.type, painty::StrokeLogRecord::Type::Smudge);
+  EXPECT_EQ(record.value, 1.0);
+
+  const std::vector<std::pair<double, std::array<painty::vec3, 2UL>>>
+    expected = {{12.5, PaintA}, {8.0, PaintB}, {4.0, PaintA}};
+  for (auto i = 0UL; i < expected.size(); i++) {
+    if (i == 2UL) {
+      ASSERT_TRUE(reader.next(record));
+      EXPECT_EQ(record.type, painty::StrokeLogRecord::Type::Dry);
+      EXPECT_NEAR(record.value, 0.01, 1e-6);
+    }
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.type, painty::StrokeLogRecord::Type::Stroke);
+    EXPECT_NEAR(record.radius, expected[i].first, 1e-6);
+    EXPECT_EQ(record.ks, expected[i].second);
+    ASSERT_EQ(record.path.size(), path.size());
+    for (auto j = 0UL; j < path.size(); j++) {
+      EXPECT_LE((record.path[j] - path[j]).cwiseAbs().maxCoeff(),
+                0.5 / painty::StrokeLogWriter::Quantization);
+    }
+  }
+  EXPECT_FALSE(reader.next(record));
+  EXPECT_FALSE(reader.isTruncated());
+}
+
+TEST(StrokeLogTest, Truncated) {
+  std::stringstream stream;
+  const std::vector<painty::vec2> path = {{10.0, 20.0}, {100.0, 200.0}};
+  {
+    painty::StrokeLogWriter writer(stream, {640U, 480U});
+    writer.addStroke(path, 12.5, PaintA);
+    writer.addStroke(path, 8.0, PaintA);
+  }
+  auto data = stream.str();
+  data.resize(data.size() - 1UL);
+
+  std::stringstream cut(data);
+  painty::StrokeLogReader reader(cut);
+  painty::StrokeLogRecord record;
+  EXPECT_TRUE(reader.next(record));
+  EXPECT_FALSE(reader.next(record));
+  EXPECT_TRUE(reader.isTruncated());
+}
+
+TEST(StrokeLogTest, Invalid) {
+  std::stringstream stream("PAINTYCK and something else");
+  EXPECT_THROW(painty::StrokeLogReader reader(stream), std::runtime_error);
+
+  EXPECT_THROW(painty::StrokeLogReader reader("does_not_exist.log"),
+               std::ios_base::failure);
+}
+
+TEST(StrokeLogTest, Replay) {
+  std::stringstream stream;
+  {
+    painty::SbrRenderThread renderThread(painty::Size{320U, 240U});
+    renderThread.setStrokeLog(std::make_shared<painty::StrokeLogWriter>(
+      stream, painty::Size{320U, 240U}));
+    renderThread.setBrushThicknessScale(1.0);
+    renderThread.render({{20.0, 120.0}, {300.0, 120.0}}, 15.0, PaintA);
+    renderThread.render({{160.0, 20.0}, {160.0, 220.0}}, 10.0, PaintB);
+    renderThread.setStrokeLog(nullptr);
+    renderThread.dryCanvas().wait();
+  }
+  const auto data = stream.str();
+
+  // the same log replayed twice gives the same result
+  std::vector<painty::Mat3d> images;
+  for (auto i = 0; i < 2; i++) {
+    std::stringstream in(data);
+    painty::StrokeLogReader reader(in);
+    painty::SbrRenderThread renderThread(painty::Size{640U, 480U});
+    renderThread.enableAutoDrying(false);
+    EXPECT_EQ(painty::ReplayStrokeLog(reader, renderThread), 2UL);
+    EXPECT_FALSE(renderThread.isAutoDryingEnabled());
+    renderThread.dryCanvas().wait();
+    images.push_back(renderThread.getLinearRgbImage().get());
+  }
+  EXPECT_EQ(images[0U].cols, 640);
+  EXPECT_EQ(images[0U].rows, 480);
+  EXPECT_EQ(cv::norm(images[0U], images[1U], cv::NORM_INF), 0.0);
+}
@@ -0,0 +1,103 @@
+/**
+ * @file TextureBrushDictionaryTest.cxx
+ * @author thomas lindemeier
+ *
+ * @brief
+ *
+ * @date 2020-11-13
+ *
+ */
+
+#include <filesystem>
+#include <future>
+
+#include "gtest/gtest.h"
+#include "painty/io/ImageIO.hxx"
+#include "painty/renderer/TextureBrushDictionary.hxx"
+
+namespace {
+const std::string Folder = "texture_brush_dictionary_test";
+
+void WriteTexture(const std::string& name, const int32_t rows,
+                  const int32_t cols) {
+  painty::Mat1d texture(rows, cols);
+  for (auto y = 0; y < rows; y++) {
+    for (auto x = 0; x < cols; x++) {
+      texture(y, x) = 0.25 + 0.5 * static_cast<double>(x) / cols;
+    }
+  }
+  painty::io::imSave(Folder + "/" + name, texture, false);
+}
+
+auto StraightPath(const double length) -> std::vector<painty::vec2> {
+  return {{10.0, 10.0}, {10.0 + length * 0.5, 10.0}, {10.0 + length, 10.0}};
+}
+}  // namespace
+
+TEST(TextureBrushDictionaryTest, LookupAndCache) {
+  const auto cacheFile =
+    painty::TextureBrushDictionary::GetCacheFile(Folder + "/");
+  EXPECT_EQ(cacheFile, Folder + ".cache");
+  std::filesystem::remove_all(Folder);
+  std::filesystem::remove(cacheFile);
+  std::filesystem::create_directory(Folder);
+
+  for (const auto id : {"01", "02"}) {
+    WriteTexture(std::string("10_0_") + id + ".png", 20, 30);
+    WriteTexture(std::string("10_1_") + id + ".png", 20, 80);
+    WriteTexture(std::string("40_0_") + id + ".png", 80, 100);
+    WriteTexture(std::string("40_1_") + id + ".png", 80, 300);
+  }
+
+  painty::TextureBrushDictionary dictionary(false, Folder);
+  EXPECT_EQ(dictionary.getTextureCount(), 8UL);
+  EXPECT_TRUE(std::filesystem::exists(cacheFile));
+
+  dictionary.setSeed(7U);
+  auto entry = dictionary.lookup(StraightPath(75.0), 21.0);
+  EXPECT_EQ(entry.texHost.rows, 20);
+  EXPECT_EQ(entry.texHost.cols, 80);
+  EXPECT_EQ(entry.texGpu, nullptr);
+  double minValue = 0.0;
+  double maxValue = 0.0;
+  cv::minMaxLoc(entry.texHost, &minValue, &maxValue);
+  EXPECT_NEAR(minValue, 0.0, 1e-6);
+  EXPECT_NEAR(maxValue, 1.0, 1e-6);
+
+  entry = dictionary.lookup(StraightPath(1000.0), 70.0);
+  EXPECT_EQ(entry.texHost.rows, 80);
+  EXPECT_EQ(entry.texHost.cols, 300);
+  entry = dictionary.lookup(StraightPath(0.0), 1.0);
+  EXPECT_EQ(entry.texHost.rows, 20);
+  EXPECT_EQ(entry.texHost.cols, 30);
+
+  // served from the cache, equal seeds select equal textures
+  painty::TextureBrushDictionary cached(false, Folder);
+  dictionary.setSeed(3U);
+  cached.setSeed(3U);
+  for (auto i = 0; i < 10; i++) {
+    const auto a = dictionary.lookup(StraightPath(290.0), 90.0).texHost;
+    const auto b = cached.lookup(StraightPath(290.0), 90.0).texHost;
+    ASSERT_EQ(a.size(), b.size());
+    EXPECT_EQ(cv::norm(a, b, cv::NORM_INF), 0.0);
+  }
+
+  // a modified folder invalidates the cache
+  WriteTexture("10_0_03.png", 20, 30);
+  painty::TextureBrushDictionary updated(false, Folder);
+  EXPECT_EQ(updated.getTextureCount(), 9UL);
+
+  // concurrent lookups load the textures on first use
+  std::vector<std::future<cv::Size>> sizes;
+  for (auto i = 0; i < 8; i++) {
+    sizes.push_back(std::async(std::launch::async, [&updated]() {
+      return updated.lookup(StraightPath(290.0), 90.0).texHost.size();
+    }));
+  }
+  for (auto& size : sizes) {
+    EXPECT_EQ(size.get(), cv::Size(300, 80));
+  }
+
+  std::filesystem::remove_all(Folder);
+  std::filesystem::remove(cacheFile);
+}
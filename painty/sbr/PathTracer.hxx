@@ -8,12 +8,25 @@
  */
 #pragma once
 
+#include <functional>
 #include <vector>
 
 #include "painty/core/Vec.hxx"
 #include "painty/image/Mat.hxx"
 
 namespace painty {
+/**
+ * @brief The minor eigenvectors of a structure tensor field, scaled by the
+ * anisotropy (the difference of the eigenvalues) so that interpolating them
+ * weights the neighbors like interpolating the tensors. The sign of each
+ * vector is chosen so that it points into the upper half plane, zero where
+ * the tensor is isotropic.
+ *
+ * @param tensors structure tensor field
+ * @return Mat<vec2f>
+ */
+auto ComputeMinorEigenvectorField(const Mat3d& tensors) -> Mat<vec2f>;
+
 class PathTracer {
   struct Stepper {
     vec2 p    = vec2::Zero();
@@ -29,12 +42,57 @@ class PathTracer {
     PATH_STOP_NOW
   };
 
+  /**
+   * @brief Evaluate a position of the path traced from a seed of a batch.
+   *
+   */
+  using BatchEvaluatePositionFun =
+    std::function<NextAction(size_t seedIndex, const vec2& position)>;
+
+  /**
+   * @brief The paths of a batch in one buffer, the points of path i are
+   * [pathBegin(i), pathEnd(i)).
+   *
+   */
+  struct PathBuffer {
+    std::vector<vec2> points    = {};
+    std::vector<size_t> offsets = {0UL};
+
+    auto size() const -> size_t;
+
+    auto pathBegin(size_t i) const -> const vec2*;
+
+    auto pathEnd(size_t i) const -> const vec2*;
+  };
+
   PathTracer(const Mat3d& tensor_field);
 
+  /**
+   * @brief Trace along a precomputed minor eigenvector field, see
+   * ComputeMinorEigenvectorField().
+   *
+   */
+  explicit PathTracer(const Mat<vec2f>& directions);
+
   std::vector<vec2> trace(const vec2& seed);
 
+  /**
+   * @brief Trace the paths of all seeds in parallel. The evaluation function
+   * is called concurrently for different seeds, but for each seed only from
+   * one thread.
+   *
+   * @param seeds the seeds of the paths
+   * @param evaluate the constraints of the paths
+   * @return PathBuffer the path of each seed in the order of the seeds
+   */
+  auto traceBatch(const std::vector<vec2>& seeds,
+                  const BatchEvaluatePositionFun& evaluate) const
+    -> PathBuffer;
+
   void setTensorField(const Mat3d& tensors);
 
+  void setDirectionField(const Mat<vec2f>& directions);
+
   uint32_t getMaxLen() const;
 
   void setMaxLen(uint32_t maxLen);
@@ -58,7 +116,11 @@ class PathTracer {
   void setEvaluatePositionFun(std::function<NextAction(const vec2&)> fun);
 
  private:
-  Mat3d _tensor_field = {};
+  /**
+   * @brief Normalized minor eigenvectors of the structure tensors.
+   *
+   */
+  Mat<vec2f> _directions = {};
 
   /**
    * @brief hard constraint for maximum numbers of points in the traced path.
@@ -96,6 +158,22 @@ class PathTracer {
    */
   std::function<NextAction(const vec2&)> _evaluatePositionFun = {};
 
+  /**
+   * @brief Trace a path from a seed, constrained by evaluate.
+   *
+   */
+  auto tracePath(const vec2& seed,
+                 const std::function<NextAction(const vec2&)>& evaluate) const
+    -> std::vector<vec2>;
+
+  /**
+   * @brief Bilinearly interpolated direction at p. The four neighboring
+   * vectors are flipped to the side of reference before blending, so the
+   * undirected eigenvectors do not cancel out.
+   *
+   */
+  vec2 direction(const vec2& p, const vec2& reference) const;
+
   /**
    * @brief Advance in the path by setting the Stepper helper struct.
    *
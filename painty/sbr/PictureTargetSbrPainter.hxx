@@ -9,8 +9,10 @@
 
 #include <memory>
 
+#include "painty/image/Convolution.hxx"
 #include "painty/image/Superpixel.hxx"
 #include "painty/mixer/PaintMixer.hxx"
+#include "painty/mixer/PaletteReflectanceLut.hxx"
 #include "painty/renderer/SbrRenderThread.hxx"
 
 namespace painty {
@@ -22,6 +24,8 @@ class PictureTargetSbrPainter {
     double sigmaSpatial       = 3.0;   // bilateral filter spatial sigma
     double sigmaColor         = 4.25;  // bilateral filter color sigma
     uint32_t smoothIterations = 5U;    // bilateral filter color sigma
+    SmoothingFilter smoothingFilter =
+      SmoothingFilter::OrientationAligned;  // bilateral grid for large inputs
     uint32_t nrColors         = 6U;
     double thinningVolume     = 2.0;
     double alphaDiff =
@@ -64,12 +68,24 @@ class PictureTargetSbrPainter {
     bool useDiffWeights = true;
     SuperpixelSegmentation::ExtractionStrategy extractionStrategy =
       SuperpixelSegmentation::ExtractionStrategy::SLICO_POISSON_WEIGHTED;
+    bool warmStart =
+      true;  // continue the segmentation of the previous iteration of a brush
+    double warmStartMinChange =
+      0.5;  // mean change of the difference that re-segments a superpixel
   };
 
   PictureTargetSbrPainter(
     const std::shared_ptr<GpuTaskQueue>& gpuTaskQueue, const Size& rendererSize,
     const std::shared_ptr<PaintMixer>& basePigmentsMixerPtr);
 
+  /**
+   * @brief Paint headless using the cpu render backend.
+   *
+   */
+  PictureTargetSbrPainter(
+    const Size& rendererSize,
+    const std::shared_ptr<PaintMixer>& basePigmentsMixerPtr);
+
   auto paint() -> Mat3d;
 
   PictureTargetSbrPainter() = delete;
@@ -77,6 +93,13 @@ class PictureTargetSbrPainter {
   void enableCoatCanvas(bool enable);
   void enableSmudge(bool enable);
 
+  /**
+   * @brief Record the strokes rendered from now on for later replay.
+   *
+   * @param strokeLog nullptr stops the recording.
+   */
+  void setStrokeLog(const std::shared_ptr<StrokeLogWriter>& strokeLog);
+
   ParamsInput _paramsInput;
   ParamsOrientations _paramsOrientations;
   ParamsStroke _paramsStroke;
@@ -97,7 +120,8 @@ class PictureTargetSbrPainter {
 
   using ColorIndexBrushStrokeMap = std::map<size_t, std::vector<BrushStroke>>;
 
-  auto extractRegions(const Mat3d& target_Lab, const Mat1d& difference,
+  auto extractRegions(SuperpixelSegmentation& seg, bool warmStart,
+                      const Mat3d& target_Lab, const Mat1d& difference,
                       double brushSize) const
     -> std::pair<Mat<int32_t>, std::map<int32_t, ImageRegion>>;
 
@@ -110,14 +134,12 @@ class PictureTargetSbrPainter {
                             const Mat3d& target_Lab,
                             const Mat3d& canvasCurrentLab,
                             const Mat1d& difference, double brushRadius,
-                            const Palette& palette, const Mat<int32_t>& labels,
-                            const Mat1d& mask, const Mat3d& tensors) const
+                            const Palette& palette,
+                            const PaletteReflectanceLut& paletteLut,
+                            const Mat<int32_t>& labels, const Mat1d& mask,
+                            const Mat<vec2f>& directions) const
     -> ColorIndexBrushStrokeMap;
 
-  auto findBestPaintIndex(const vec3& R_target, const vec3& R0,
-                          const Palette& palette) const
-    -> std::optional<size_t>;
-
   void paintCoatCanvas(const PaintCoeff& paint);
 
   auto computeDifference(const Mat3d& target_Lab, const Mat3d& canvasCurrentLab,
@@ -8,14 +8,74 @@
  */
 #include "painty/sbr/PathTracer.hxx"
 
+#include <algorithm>
+#include <cmath>
 #include <deque>
 
+#include "painty/core/ThreadPool.hxx"
 #include "painty/image/EdgeTangentFlow.hxx"
 
 namespace painty {
+namespace {
+/**
+ * @brief Seeds per task of a batch.
+ *
+ */
+constexpr auto BatchChunkSize = 8;
+}  // namespace
+
+auto ComputeMinorEigenvectorField(const Mat3d& tensors) -> Mat<vec2f> {
+  Mat<vec2f> directions(tensors.size());
+  for (auto y = 0; y < tensors.rows; y++) {
+    for (auto x = 0; x < tensors.cols; x++) {
+      const auto& T = tensors(y, x);
+      const auto E  = T[0U];
+      const auto F  = T[1U];
+      const auto G  = T[2U];
+
+      // difference of the eigenvalues
+      const auto anisotropy = std::sqrt((E - G) * (E - G) + 4.0 * F * F);
+
+      // both rows of the eigen system give the eigenvector, the one of the
+      // larger norm does not vanish for axis aligned tensors
+      vec2 t       = tensor::GetMinEigenVector(T);
+      const vec2 u = {G - E + anisotropy, -2.0 * F};
+      if (u.squaredNorm() > t.squaredNorm()) {
+        t = u;
+      }
+      const auto m = t.norm();
+      if (m > 0.0) {
+        t *= anisotropy / m;
+        if ((t[1] < 0.0) || ((t[1] <= 0.0) && (t[0] < 0.0))) {
+          t *= -1.0;
+        }
+      } else {
+        t = {0.0, 0.0};
+      }
+      directions(y, x) = t.cast<float>();
+    }
+  }
+  return directions;
+}
+
+auto PathTracer::PathBuffer::size() const -> size_t {
+  return offsets.size() - 1UL;
+}
+
+auto PathTracer::PathBuffer::pathBegin(const size_t i) const -> const vec2* {
+  return points.data() + offsets[i];
+}
+
+auto PathTracer::PathBuffer::pathEnd(const size_t i) const -> const vec2* {
+  return points.data() + offsets[i + 1UL];
+}
+
 PathTracer::PathTracer(const Mat3d& tensor_field)
-    : _tensor_field(tensor_field),
-      _frame(0, 0, tensor_field.cols, tensor_field.rows) {
+    : PathTracer(ComputeMinorEigenvectorField(tensor_field)) {}
+
+PathTracer::PathTracer(const Mat<vec2f>& directions)
+    : _directions(directions),
+      _frame(0, 0, directions.cols, directions.rows) {
   _evaluatePositionFun = [this](const vec2& cPos) -> NextAction {
     if (insideFrame(cPos)) {
       return NextAction::PATH_CONTINUE;
@@ -25,6 +85,50 @@ PathTracer::PathTracer(const Mat3d& tensor_field)
 }
 
 auto PathTracer::trace(const vec2& seed) -> std::vector<vec2> {
+  return tracePath(seed, _evaluatePositionFun);
+}
+
+auto PathTracer::traceBatch(const std::vector<vec2>& seeds,
+                            const BatchEvaluatePositionFun& evaluate) const
+  -> PathBuffer {
+  // each task writes its paths into its own buffer, the buffers are
+  // concatenated in seed order afterwards
+  const auto seedCount = static_cast<int32_t>(seeds.size());
+  std::vector<std::vector<vec2>> chunks(
+    static_cast<size_t>((seedCount + BatchChunkSize - 1) / BatchChunkSize));
+  std::vector<size_t> lengths(seeds.size(), 0UL);
+  auto& pool = DefaultThreadPool();
+  ParallelFor(
+    pool, 0, seedCount, BatchChunkSize,
+    [&](const int32_t begin, const int32_t end) {
+      auto& chunk = chunks[static_cast<size_t>(begin / BatchChunkSize)];
+      for (auto i = begin; i < end; i++) {
+        const auto index = static_cast<size_t>(i);
+        const auto path =
+          tracePath(seeds[index], [&evaluate, index](const vec2& p) {
+            return evaluate(index, p);
+          });
+        chunk.insert(chunk.end(), path.cbegin(), path.cend());
+        lengths[index] = path.size();
+      }
+    });
+
+  PathBuffer buffer;
+  buffer.offsets.reserve(seeds.size() + 1UL);
+  for (const auto length : lengths) {
+    buffer.offsets.push_back(buffer.offsets.back() + length);
+  }
+  buffer.points.reserve(buffer.offsets.back());
+  for (const auto& chunk : chunks) {
+    buffer.points.insert(buffer.points.end(), chunk.cbegin(), chunk.cend());
+  }
+  return buffer;
+}
+
+auto PathTracer::tracePath(
+  const vec2& seed,
+  const std::function<NextAction(const vec2&)>& evaluate) const
+  -> std::vector<vec2> {
   std::vector<vec2> path;
 
   Stepper forward;
@@ -32,15 +136,13 @@ auto PathTracer::trace(const vec2& seed) -> std::vector<vec2> {
   forward.p[0] = backward.p[0] = seed[0];
   forward.p[1] = backward.p[1] = seed[1];
 
-  const auto minEv =
-    tensor::GetMinEigenVector(Interpolate(_tensor_field, seed));
-  vec2 t(minEv[0], minEv[1]);
-  const auto m = t.norm();
-  if (m > 0.0) {
-    t.normalize();
-  } else {
-    t = {0.0, 1.0};
-  }
+  // the stored vector of the pixel of the seed orients the interpolation
+  const auto& nearest = _directions(
+    std::clamp(static_cast<int32_t>(std::floor(seed[1])), 0,
+               _directions.rows - 1),
+    std::clamp(static_cast<int32_t>(std::floor(seed[0])), 0,
+               _directions.cols - 1));
+  const auto t = direction(seed, nearest.cast<double>());
   backward.t = forward.t = t;
   backward.t *= -1.0;
   forward.w = backward.w = 0.0;
@@ -52,7 +154,7 @@ auto PathTracer::trace(const vec2& seed) -> std::vector<vec2> {
 
   // push first point
   if ((((forward.w + backward.w) / _step) >= _minLen) &&
-      (_evaluatePositionFun(seed) != NextAction::PATH_CONTINUE)) {
+      (evaluate(seed) != NextAction::PATH_CONTINUE)) {
     growF = growB = false;
   } else {
     pathDeq.push_back(seed);
@@ -63,7 +165,7 @@ auto PathTracer::trace(const vec2& seed) -> std::vector<vec2> {
     // grow forwards
     if (growF) {
       if (stepNext(forward) && insideFrame(forward.p)) {
-        const auto st = _evaluatePositionFun(forward.p);
+        const auto st = evaluate(forward.p);
         if (st == NextAction::PATH_STOP_NOW) {
           growF = false;
         } else {
@@ -84,7 +186,7 @@ auto PathTracer::trace(const vec2& seed) -> std::vector<vec2> {
     // grow backwards
     if (growB) {
       if (stepNext(backward) && insideFrame(backward.p)) {
-        const auto st = _evaluatePositionFun(backward.p);
+        const auto st = evaluate(backward.p);
         if (st == NextAction::PATH_STOP_NOW) {
           growF = false;
         } else {
@@ -109,7 +211,11 @@ auto PathTracer::trace(const vec2& seed) -> std::vector<vec2> {
 }
 
 void PathTracer::setTensorField(const Mat3d& tensor_field) {
-  _tensor_field = tensor_field;
+  _directions = ComputeMinorEigenvectorField(tensor_field);
+}
+
+void PathTracer::setDirectionField(const Mat<vec2f>& directions) {
+  _directions = directions;
 }
 
 uint32_t PathTracer::getMaxLen() const {
@@ -157,42 +263,56 @@ void PathTracer::setEvaluatePositionFun(
   _evaluatePositionFun = fun;
 }
 
-bool PathTracer::stepNext(Stepper& s) const {
-  vec3 ten = Interpolate(_tensor_field, s.p);
-
-  vec2 minEv = ::painty::tensor::GetMinEigenVector(ten);
-
-  vec2 t(minEv[0], minEv[1]);
-  double m = t.norm();
-
+vec2 PathTracer::direction(const vec2& p, const vec2& reference) const {
+  const auto x = static_cast<int32_t>(std::floor(p[0]));
+  const auto y = static_cast<int32_t>(std::floor(p[1]));
+
+  const auto cols = _directions.cols;
+  const auto rows = _directions.rows;
+  const auto x0   = cv::borderInterpolate(x, cols, cv::BORDER_REFLECT);
+  const auto x1   = cv::borderInterpolate(x + 1, cols, cv::BORDER_REFLECT);
+  const auto y0   = cv::borderInterpolate(y, rows, cv::BORDER_REFLECT);
+  const auto y1   = cv::borderInterpolate(y + 1, rows, cv::BORDER_REFLECT);
+
+  // the stored vectors are scaled by the anisotropy, so strong edges pull
+  // harder than weak or isotropic neighbors as when interpolating tensors
+  const auto aligned = [&reference](const vec2f& v) -> vec2 {
+    const vec2 d = v.cast<double>();
+    return (d.dot(reference) < 0.0) ? vec2(-d) : d;
+  };
+  const auto a = p[0] - static_cast<double>(x);
+  const auto c = p[1] - static_cast<double>(y);
+  const vec2 t = ((1.0 - a) * aligned(_directions(y0, x0)) +
+                  a * aligned(_directions(y0, x1))) *
+                   (1.0 - c) +
+                 ((1.0 - a) * aligned(_directions(y1, x0)) +
+                  a * aligned(_directions(y1, x1))) *
+                   c;
+  const auto m = t.norm();
   if (m > 0.0) {
-    t.normalize();
-  } else {
-    t = {0.0, 1.0};
+    return t / m;
   }
+  return {0.0, 1.0};
+}
 
-  vec2 t_last = s.t;
-
-  double dot = t.dot(t_last);
+bool PathTracer::stepNext(Stepper& s) const {
+  vec2 t = direction(s.p, s.t);
 
   // reverse if direction points backwards
-  if (dot < 0.0) {
+  if (t.dot(s.t) < 0.0) {
     t *= -1.0;
   }
 
   // filter with previous direction
   if (_fc < 1.0) {
-    double dx = t[0];
-    double dy = t[1];
-    dx        = _fc * dx + (1.0 - _fc) * (t_last[0]);
-    dy        = _fc * dy + (1.0 - _fc) * (t_last[1]);
-    t[0]      = dx / std::pow(dx * dx + dy * dy, 0.5);
-    t[1]      = dy / std::pow(dx * dx + dy * dy, 0.5);
-    t.normalize();
+    const vec2 filtered = _fc * t + (1.0 - _fc) * s.t;
+    const auto m        = filtered.norm();
+    if (m > 0.0) {
+      t = filtered / m;
+    }
   }
 
-  s.t[0] = t[0];
-  s.t[1] = t[1];
+  s.t = t;
 
   if (_step <= 1.0) {
     s.dw =
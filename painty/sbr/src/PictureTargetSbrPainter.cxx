@@ -7,24 +7,44 @@
  */
 #include "painty/sbr/PictureTargetSbrPainter.hxx"
 
+#include <algorithm>
 #include <future>
 #include <random>
 
 #include "painty/core/Color.hxx"
+#include "painty/core/ThreadPool.hxx"
 #include "painty/image/Convolution.hxx"
 #include "painty/image/EdgeTangentFlow.hxx"
+#include "painty/image/RegionStatistics.hxx"
+#include "painty/image/TensorScaleSpace.hxx"
 #include "painty/io/ImageIO.hxx"
 #include "painty/mixer/Serialization.hxx"
 #include "painty/renderer/Renderer.hxx"
 #include "painty/sbr/PathTracer.hxx"
 
 namespace painty {
+namespace {
+/**
+ * @brief The number of labels of regions keyed by label.
+ *
+ */
+auto LabelCount(const std::map<int32_t, ImageRegion>& regions) -> int32_t {
+  return regions.empty() ? 0 : (regions.rbegin()->first + 1);
+}
+}  // namespace
+
 PictureTargetSbrPainter::PictureTargetSbrPainter(
   const std::shared_ptr<GpuTaskQueue>& gpuTaskQueue, const Size& rendererSize,
   const std::shared_ptr<PaintMixer>& basePigmentsMixerPtr)
     : _renderThread(gpuTaskQueue, rendererSize),
       _basePigmentsMixerPtr(basePigmentsMixerPtr) {}
 
+PictureTargetSbrPainter::PictureTargetSbrPainter(
+  const Size& rendererSize,
+  const std::shared_ptr<PaintMixer>& basePigmentsMixerPtr)
+    : _renderThread(rendererSize),
+      _basePigmentsMixerPtr(basePigmentsMixerPtr) {}
+
 void PictureTargetSbrPainter::enableCoatCanvas(bool enable) {
   _coatCanvas = enable;
 }
@@ -33,7 +53,14 @@ void PictureTargetSbrPainter::enableSmudge(bool enable) {
   _renderThread.enableSmudge(enable);
 }
 
-auto PictureTargetSbrPainter::extractRegions(const Mat3d& target_Lab,
+void PictureTargetSbrPainter::setStrokeLog(
+  const std::shared_ptr<StrokeLogWriter>& strokeLog) {
+  _renderThread.setStrokeLog(strokeLog);
+}
+
+auto PictureTargetSbrPainter::extractRegions(SuperpixelSegmentation& seg,
+                                             const bool warmStart,
+                                             const Mat3d& target_Lab,
                                              const Mat1d& difference,
                                              double brushSize) const
   -> std::pair<Mat<int32_t>, std::map<int32_t, ImageRegion>> {
@@ -42,11 +69,14 @@ auto PictureTargetSbrPainter::extractRegions(const Mat3d& target_Lab,
   std::map<int32_t, ImageRegion> regions;
   Mat<int32_t> labels;
 
-  SuperpixelSegmentation seg;
-  seg.setUseDiffWeight(_paramsRegionExtraction.useDiffWeights);
-  seg.setExtractionStrategy(_paramsRegionExtraction.extractionStrategy);
-  seg.extractWithDiff(target_Lab, difference, _paramsInput.mask,
-                      static_cast<int32_t>(brushSize));
+  if (warmStart) {
+    seg.updateWithDiff(difference, _paramsRegionExtraction.warmStartMinChange);
+  } else {
+    seg.setUseDiffWeight(_paramsRegionExtraction.useDiffWeights);
+    seg.setExtractionStrategy(_paramsRegionExtraction.extractionStrategy);
+    seg.extractWithDiff(target_Lab, difference, _paramsInput.mask,
+                        static_cast<int32_t>(brushSize));
+  }
   labels = seg.getRegions(regions);
   for (auto j = 0; j < static_cast<int32_t>(segDiffImage.total()); ++j) {
     segDiffImage(j)[0] = difference(j);
@@ -68,8 +98,9 @@ auto PictureTargetSbrPainter::checkConvergence(
   std::cout << "filtering evaluation regions for finished regions" << std::endl;
   auto nrActiveRegions = 0UL;
   const auto localRms  = epsFac * _paramsConvergence.rms_local;
+  const RegionStatistics stats(labels, LabelCount(regions), {difference});
   for (auto iter = regions.begin(); iter != regions.end(); iter++) {
-    auto rms = iter->second.computeRms(difference);
+    auto rms = stats.rms(0U, iter->first);
 
     if (rms >= localRms) {
       iter->second.setActive(true);
@@ -93,10 +124,11 @@ auto PictureTargetSbrPainter::checkConvergence(
 auto PictureTargetSbrPainter::generateBrushStrokes(
   std::map<int32_t, ImageRegion>& regions, const Mat3d& target_Lab,
   const Mat3d& canvasCurrentLab, const Mat1d& /*difference*/,
-  const double brushRadius, const Palette& palette, const Mat<int32_t>& labels,
-  const Mat1d& mask, const Mat3d& tensors) const
+  const double brushRadius, const Palette& palette,
+  const PaletteReflectanceLut& paletteLut, const Mat<int32_t>& labels,
+  const Mat1d& mask, const Mat<vec2f>& directions) const
   -> PictureTargetSbrPainter::ColorIndexBrushStrokeMap {
-  PathTracer tracer(tensors);
+  PathTracer tracer(directions);
   tracer.setMinLen(_paramsStroke.minLen);
   tracer.setMaxLen(_paramsStroke.maxLen);
   tracer.setStep((_paramsStroke.stepSize <= 0.0) ? (brushRadius * 0.25)
@@ -106,17 +138,53 @@ auto PictureTargetSbrPainter::generateBrushStrokes(
 
   ColorIndexBrushStrokeMap brushStrokes;
 
+  // the inscribed circles and color means of all regions from one pass each
+  const auto labelCount = LabelCount(regions);
+  const auto circles    = ComputeInscribedCircles(labels, labelCount);
+  const RegionStatistics stats(labels, labelCount,
+                               {target_Lab, canvasCurrentLab});
+
+  // per label tables of the target and canvas means, the canvas mean also as
+  // reflectance to predict the color after a stroke
+  const auto tableSize = static_cast<size_t>(labelCount);
+  std::vector<vec3> targetMeans(tableSize);
+  std::vector<vec3> canvasMeans(tableSize);
+  std::vector<vec3> canvasReflectances(tableSize);
+  {
+    ColorConverter<double> con;
+    for (auto label = 0; label < labelCount; label++) {
+      const auto i   = static_cast<size_t>(label);
+      targetMeans[i] = stats.mean<3>(0U, label);
+      canvasMeans[i] = stats.mean<3>(1U, label);
+      con.lab2rgb(canvasMeans[i], canvasReflectances[i]);
+    }
+  }
+  const auto thickness =
+    AssumedAvgThickness * _renderThread.getBrushThicknessScale();
+
+  // a stroke for every active region, strokes starting in a region that an
+  // earlier stroke visited are dropped afterwards, so that all strokes can be
+  // fitted and traced in parallel
+  struct Candidate {
+    int32_t label     = 0;
+    vec2 seed         = vec2::Zero();
+    double radius     = 0.0;
+    PaintCoeff paint  = {};
+    size_t paintIndex = 0UL;
+  };
+  std::vector<Candidate> candidates;
+
   std::cout << "Iterating through all active regions" << std::endl;
   for (auto reg : regions) {
     auto& region = reg.second;
 
-    if (!region.isActive()) {
+    if (!region.isActive() || region.empty()) {
       continue;
     }
 
-    vec2 incenter    = {100, 100};
-    auto usedRadius  = region.getInscribedCircle(incenter);
-    const auto width = usedRadius * 2.0;
+    const auto& circle = circles[static_cast<size_t>(reg.first)];
+    auto usedRadius    = circle.radius;
+    const auto width   = usedRadius * 2.0;
 
     // TODO clamp is bad for strokes whose minsize is larger than inscribed circle radius.
     if (_paramsStroke.clampBrushRadius) {
@@ -130,19 +198,42 @@ auto PictureTargetSbrPainter::generateBrushStrokes(
         usedRadius = std::min(width, BrushMaxSize) / 2.0;
       }
     }
+    candidates.push_back({reg.first, circle.center, usedRadius, {}, 0UL});
+  }
 
-    vec3 Rt = region.computeMean(target_Lab);
-    vec3 R0 = region.computeMean(canvasCurrentLab);
-    ColorConverter<double> con;
-    con.lab2rgb(R0, R0);
-    con.lab2rgb(Rt, Rt);
-    const auto closestPaint = PaintMixer(palette).mixClosestFit(R0, Rt);
-    auto currentPaintIndex  = findBestPaintIndex(Rt, R0, palette);
-    if (!currentPaintIndex) {
-      currentPaintIndex = 0;
-    }
+  auto& pool = DefaultThreadPool();
+  ParallelFor(
+    pool, 0, static_cast<int32_t>(candidates.size()), 1,
+    [&](const int32_t begin, const int32_t end) {
+      for (auto i = begin; i < end; i++) {
+        auto& candidate  = candidates[static_cast<size_t>(i)];
+        const auto label = static_cast<size_t>(candidate.label);
+        vec3 Rt;
+        ColorConverter<double> con;
+        con.lab2rgb(targetMeans[label], Rt);
+        const auto& R0  = canvasReflectances[label];
+        // runs on the pool already, one thread per solve
+        candidate.paint = PaintMixer(palette, 1U).mixClosestFit(R0, Rt);
+        candidate.paintIndex =
+          paletteLut
+            .findBestPaintIndex(targetMeans[label], R0, canvasMeans[label])
+            .value_or(0UL);
+      }
+    });
+
+  std::vector<vec2> seeds;
+  seeds.reserve(candidates.size());
+  for (const auto& candidate : candidates) {
+    seeds.push_back(candidate.seed);
+  }
 
-    tracer.setEvaluatePositionFun([&](const vec2& p) -> PathTracer::NextAction {
+  // whether the paint of a stroke improves a region, evaluated at the first
+  // visit of the region by that stroke
+  std::vector<std::vector<std::pair<int32_t, PathTracer::NextAction>>>
+    decisions(candidates.size());
+  const auto paths = tracer.traceBatch(
+    seeds,
+    [&](const size_t stroke, const vec2& p) -> PathTracer::NextAction {
       if ((static_cast<int32_t>(p[0U]) < 0) ||
           (static_cast<int32_t>(p[1U]) < 0) ||
           (static_cast<int32_t>(p[0U]) >= labels.cols) ||
@@ -155,33 +246,46 @@ auto PictureTargetSbrPainter::generateBrushStrokes(
       if ((clabel < 0) ||
           ((!mask.empty()) && (mask(static_cast<int32_t>(p[1U]),
                                     static_cast<int32_t>(p[0U])) < 1.0)) ||
-          (regions.count(clabel) == 0u)) {
+          (clabel >= labelCount)) {
         return PathTracer::NextAction::PATH_STOP_NOW;
       }
 
-      vec3 LabCanvas = regions[clabel].computeMean(canvasCurrentLab);
-      vec3 LabSource = regions[clabel].computeMean(target_Lab);
-      ColorConverter<double> converter;
-      vec3 R0_test;
-      converter.lab2rgb(LabCanvas, R0_test);
-      const auto R1 = ComputeReflectance(
-        closestPaint.K, closestPaint.S, R0_test,
-        AssumedAvgThickness * _renderThread.getBrushThicknessScale());
+      auto& visited    = decisions[stroke];
+      const auto known = std::find_if(
+        visited.cbegin(), visited.cend(),
+        [clabel](const auto& decision) { return decision.first == clabel; });
+      if (known != visited.cend()) {
+        return known->second;
+      }
 
+      const auto i          = static_cast<size_t>(clabel);
+      const auto& paint     = candidates[stroke].paint;
+      const auto& LabCanvas = canvasMeans[i];
+      const auto& LabSource = targetMeans[i];
+      const auto R1 =
+        ComputeReflectance(paint.K, paint.S, canvasReflectances[i], thickness);
+
+      ColorConverter<double> converter;
       vec3 Lab1;
       converter.rgb2lab(R1, Lab1);
 
-      if ((Lab1 - LabSource).squaredNorm() <
-          (LabSource - LabCanvas).squaredNorm()) {
-        return PathTracer::NextAction::PATH_CONTINUE;
-      }
-      return PathTracer::NextAction::PATH_STOP_NEXT;
+      const auto decision = ((Lab1 - LabSource).squaredNorm() <
+                             (LabSource - LabCanvas).squaredNorm())
+                              ? PathTracer::NextAction::PATH_CONTINUE
+                              : PathTracer::NextAction::PATH_STOP_NEXT;
+      visited.emplace_back(clabel, decision);
+      return decision;
     });
 
-    // std::cout << "Generating path at: " << incenter.transpose() << std::endl;
-    auto path = tracer.trace(incenter);
+  // std::cout << "Adding valid strokes and sort by paint" << std::endl;
+  for (size_t k = 0UL; k < candidates.size(); k++) {
+    const auto& candidate = candidates[k];
+    // the region has been visited by an earlier stroke
+    if (!regions[candidate.label].isActive()) {
+      continue;
+    }
 
-    // std::cout << "Adding valid strokes and sort by paint" << std::endl;
+    const std::vector<vec2> path(paths.pathBegin(k), paths.pathEnd(k));
     if (_paramsStroke.blockVisitedRegions) {
       for (const auto& p : path) {
         if ((static_cast<int32_t>(p[0U]) < 0) ||
@@ -197,47 +301,13 @@ auto PictureTargetSbrPainter::generateBrushStrokes(
     }
 
     if (!path.empty()) {
-      PaintMixer mixer(palette);
-      brushStrokes[currentPaintIndex.value()].push_back(
-        {path, usedRadius, closestPaint});
+      brushStrokes[candidate.paintIndex].push_back(
+        {path, candidate.radius, candidate.paint});
     }
   }
   return brushStrokes;
 }
 
-auto PictureTargetSbrPainter::findBestPaintIndex(const vec3& R_target,
-                                                 const vec3& R0,
-                                                 const Palette& palette) const
-  -> std::optional<size_t> {
-  ColorConverter<double> con;
-  vec3 R_target_Lab;
-  vec3 R0_Lab;
-  con.rgb2lab(R_target, R_target_Lab);
-  con.rgb2lab(R0, R0_Lab);
-
-  auto d = (R0_Lab - R_target_Lab).squaredNorm();
-
-  size_t bestIndex = std::numeric_limits<size_t>::max();
-
-  for (size_t i = 0UL; (i < palette.size()); i++) {
-    vec3 R_Lab;
-    con.rgb2lab(ComputeReflectance(
-                  palette[i].K, palette[i].S, R0,
-                  AssumedAvgThickness * _renderThread.getBrushThicknessScale()),
-                R_Lab);
-
-    const auto ld = (R_Lab - R_target_Lab).squaredNorm();
-    if (ld < d) {
-      d         = ld;
-      bestIndex = i;
-    }
-  }
-
-  return (bestIndex == std::numeric_limits<size_t>::max())
-           ? std::nullopt
-           : std::optional<size_t>(bestIndex);
-}
-
 auto PictureTargetSbrPainter::computeDifference(const Mat3d& target_Lab,
                                                 const Mat3d& canvasCurrentLab,
                                                 const double brushRadius) const
@@ -270,7 +340,8 @@ auto PictureTargetSbrPainter::paint() -> Mat3d {
     convertColor(_paramsInput.inputSRGB,
                  ColorConverter<double>::Conversion::srgb_2_CIELab),
     Mat1d(), _paramsInput.sigmaSpatial, _paramsInput.sigmaColor,
-    _paramsOrientations.outerBlurScale, _paramsInput.smoothIterations);
+    _paramsOrientations.outerBlurScale, _paramsInput.smoothIterations,
+    _paramsInput.smoothingFilter);
 
   painty::io::imSave(
     "/tmp/targetImage.jpg",
@@ -298,6 +369,20 @@ auto PictureTargetSbrPainter::paint() -> Mat3d {
     paintCoatCanvas(palette[1U]);
   }
 
+  // the tensors of all brush sizes are blurred from each other if the
+  // gradients are not blurred
+  std::unique_ptr<TensorScaleSpace> tensorScaleSpace = nullptr;
+  if (_paramsOrientations.innerBlurScale <= 0.0) {
+    std::cout << "Computing structure tensor scale space" << std::endl;
+    tensorScaleSpace =
+      std::make_unique<TensorScaleSpace>(target_Lab, _paramsInput.mask);
+    std::vector<double> sigmas;
+    for (const auto brushSize : _paramsStroke.brushSizes) {
+      sigmas.push_back(brushSize / 2.0 * _paramsOrientations.outerBlurScale);
+    }
+    tensorScaleSpace->addLevels(sigmas);
+  }
+
   // for every brush
   auto itBrush = 1;
   for (const auto brushSize : _paramsStroke.brushSizes) {
@@ -305,13 +390,21 @@ auto PictureTargetSbrPainter::paint() -> Mat3d {
     const double brushRadius = brushSize / 2.0;
 
     _renderThread.setBrushThicknessScale(_paramsStroke.thicknessScale);
+    const PaletteReflectanceLut paletteLut(
+      palette, AssumedAvgThickness * _renderThread.getBrushThicknessScale());
 
     std::cout << "Computing structure tensor field" << std::endl;
     // compute structure tensor field
     const auto tensors =
-      tensor::ComputeTensors(target_Lab, _paramsInput.mask,
-                             brushRadius * _paramsOrientations.innerBlurScale,
-                             brushRadius * _paramsOrientations.outerBlurScale);
+      tensorScaleSpace
+        ? tensorScaleSpace->getTensors(brushRadius *
+                                       _paramsOrientations.outerBlurScale)
+        : tensor::ComputeTensors(
+            target_Lab, _paramsInput.mask,
+            brushRadius * _paramsOrientations.innerBlurScale,
+            brushRadius * _paramsOrientations.outerBlurScale);
+
+    const auto directions = ComputeMinorEigenvectorField(tensors);
 
     const auto future = std::async(std::launch::async, [tensors]() {
       painty::io::imSave("/tmp/targetImageOrientation.jpg",
@@ -321,6 +414,9 @@ auto PictureTargetSbrPainter::paint() -> Mat3d {
 
     std::cout << "Iterating layers" << std::endl;
 
+    // the target does not change, later iterations continue the segmentation
+    SuperpixelSegmentation segmentation;
+
     for (uint32_t iteration = 0U; iteration < _paramsConvergence.maxIterations;
          iteration++) {
       std::cout << "Iteration: " << iteration << std::endl;
@@ -347,8 +443,9 @@ auto PictureTargetSbrPainter::paint() -> Mat3d {
       std::cout << "Extracting superpixels" << std::endl;
       std::map<int32_t, ImageRegion> regions;
       Mat<int32_t> labels;
-      std::tie(labels, regions) =
-        extractRegions(target_Lab, difference, brushSize);
+      std::tie(labels, regions) = extractRegions(
+        segmentation, _paramsRegionExtraction.warmStart && (iteration > 0U),
+        target_Lab, difference, brushSize);
 
       // discard already close enough regions
       if (checkConvergence(difference, regions, labels, epsFac)) {
@@ -357,7 +454,7 @@ auto PictureTargetSbrPainter::paint() -> Mat3d {
 
       auto brushStrokeMap = generateBrushStrokes(
         regions, target_Lab, canvasCurrentLab, difference, brushRadius, palette,
-        labels, _paramsInput.mask, tensors);
+        paletteLut, labels, _paramsInput.mask, directions);
       std::cout << "Rendering strokes" << std::endl;
       const auto xs = static_cast<double>(_renderThread.getSize().width) /
                       static_cast<double>(target_Lab.cols);
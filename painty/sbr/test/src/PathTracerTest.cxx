@@ -8,6 +8,8 @@
  *
  */
 
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "painty/sbr/PathTracer.hxx"
 
@@ -51,3 +53,82 @@ TEST(PathTracerTest, Construct) {
     EXPECT_EQ(path.size(), len);
   }
 }
+
+TEST(PathTracerTest, TraceBatch) {
+  // circular flow around the center, between the pixels so that no tensor
+  // is axis aligned
+  const painty::vec2 center(100.5, 100.5);
+  painty::Mat3d tensors(200, 200);
+  for (auto y = 0; y < tensors.rows; y++) {
+    for (auto x = 0; x < tensors.cols; x++) {
+      const auto dx = x - center[0U];
+      const auto dy = y - center[1U];
+      tensors(y, x) = {dx * dx, dx * dy, dy * dy};
+    }
+  }
+  const auto directions = painty::ComputeMinorEigenvectorField(tensors);
+  const painty::vec2f right = directions(100, 150).normalized();
+  const painty::vec2f below = directions(150, 100).normalized();
+  EXPECT_NEAR(right[0U], 0.0F, 0.02F);
+  EXPECT_NEAR(right[1U], 1.0F, 0.02F);
+  EXPECT_NEAR(below[0U], 1.0F, 0.02F);
+  EXPECT_NEAR(below[1U], 0.0F, 0.02F);
+  // scaled by the anisotropy, the trace of these rank one tensors
+  EXPECT_NEAR(directions(100, 150).norm(), 2450.5F, 0.01F);
+
+  {
+    painty::Mat3d single(1, 2);
+    single(0, 0) = {2.0, 0.0, 2.0};
+    single(0, 1) = {1.0, 0.0, 4.0};
+    const auto d = painty::ComputeMinorEigenvectorField(single);
+    // isotropic
+    EXPECT_NEAR(d(0, 0).norm(), 0.0F, 1e-6F);
+    // axis aligned with the minor eigenvector along x
+    EXPECT_NEAR(d(0, 1)[0U], 3.0F, 1e-6F);
+    EXPECT_NEAR(d(0, 1)[1U], 0.0F, 1e-6F);
+  }
+
+  auto tracer = painty::PathTracer(directions);
+  tracer.setMinLen(3);
+  tracer.setMaxLen(15U);
+  tracer.setStep(3);
+
+  std::vector<painty::vec2> seeds;
+  for (auto i = 0; i < 50; i++) {
+    seeds.emplace_back(20.0 + 3.0 * i, 30.0 + 2.0 * i);
+  }
+  const auto evaluate = [&center](const painty::vec2& p) {
+    return ((p - center).norm() < 90.0)
+             ? painty::PathTracer::NextAction::PATH_CONTINUE
+             : painty::PathTracer::NextAction::PATH_STOP_NOW;
+  };
+  std::vector<int32_t> calls(seeds.size(), 0);
+  const auto paths = tracer.traceBatch(
+    seeds, [&calls, &evaluate](const size_t i, const painty::vec2& p) {
+      calls[i]++;
+      return evaluate(p);
+    });
+  tracer.setEvaluatePositionFun(evaluate);
+
+  ASSERT_EQ(paths.size(), seeds.size());
+  for (size_t i = 0; i < seeds.size(); i++) {
+    const std::vector<painty::vec2> path(paths.pathBegin(i),
+                                         paths.pathEnd(i));
+    EXPECT_GT(calls[i], 0);
+
+    // the same path as a single trace with the same constraints
+    const auto single = tracer.trace(seeds[i]);
+    ASSERT_EQ(path.size(), single.size());
+    for (size_t j = 0; j < path.size(); j++) {
+      EXPECT_NEAR((path[j] - single[j]).norm(), 0.0, 1e-12);
+    }
+
+    // the path follows the circles around the center
+    const auto radius = (seeds[i] - center).norm();
+    if ((radius > 30.0) && (radius < 80.0)) {
+      for (const auto& p : path) {
+        EXPECT_NEAR((p - center).norm(), radius, 0.1 * radius);
+      }
+    }
+  }
+}